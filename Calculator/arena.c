@@ -0,0 +1,92 @@
+// Justin Chen
+// Bump-pointer arena for memory that is freed all at once
+
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <stdalign.h> // Alignment (alignof())
+#include "arena.h"
+
+// Size of the first block, unless arenaReserve() chose another one
+#define ARENA_MIN_BLOCK 65536
+
+// Alignment of every allocation (suitable for any type)
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+// Allocates a block with room for at least capacity bytes
+static ArenaBlock *newBlock(size_t capacity, ArenaBlock *previous) {
+  ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+  if (block != NULL) {
+    block->previous = previous;
+    block->capacity = capacity;
+    block->used = 0;
+  }
+  return block;
+}
+
+void *arenaAllocate(Arena *arena, size_t size) {
+  // Round up so that the next allocation stays aligned
+  size = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+
+  ArenaBlock *block = arena->block;
+  if (block == NULL || block->capacity - block->used < size) {
+    // Grow geometrically so that the number of blocks stays logarithmic in the memory used
+    size_t capacity = block == NULL ? ARENA_MIN_BLOCK : block->capacity * 2;
+    while (capacity < size) {
+      capacity *= 2;
+    }
+    block = newBlock(capacity, block);
+    if (block == NULL) {
+      return NULL;
+    }
+    arena->block = block;
+  }
+
+  void *memory = block->memory + block->used;
+  block->used += size;
+  arena->used += size;
+  if (arena->used > arena->highWaterMark) {
+    arena->highWaterMark = arena->used;
+  }
+  return memory;
+}
+
+bool arenaReserve(Arena *arena, size_t capacity) {
+  if (arena->block == NULL) {
+    arena->block = newBlock(capacity, NULL);
+  }
+  return arena->block != NULL;
+}
+
+size_t arenaCapacity(const Arena *arena) {
+  size_t capacity = 0;
+  for (const ArenaBlock *block = arena->block; block != NULL; block = block->previous) {
+    capacity += sizeof(ArenaBlock) + block->capacity;
+  }
+  return capacity;
+}
+
+void arenaReset(Arena *arena) {
+  ArenaBlock *block = arena->block;
+  if (block != NULL && block->previous != NULL) {
+    // Replace the chain of blocks with one block that fits everything allocated since the last reset
+    size_t capacity = block->capacity;
+    while (capacity < arena->used) {
+      capacity *= 2;
+    }
+    arenaRelease(arena);
+    arena->block = newBlock(capacity, NULL);
+  } else if (block != NULL) {
+    block->used = 0;
+  }
+  arena->used = 0;
+}
+
+void arenaRelease(Arena *arena) {
+  ArenaBlock *block = arena->block;
+  while (block != NULL) {
+    ArenaBlock *previous = block->previous;
+    free(block);
+    block = previous;
+  }
+  arena->block = NULL;
+  arena->used = 0;
+}
@@ -0,0 +1,52 @@
+// Justin Chen
+// Bump-pointer arena for memory that is freed all at once
+
+#ifndef CALCULATOR_ARENA_H
+#define CALCULATOR_ARENA_H
+
+#include <stddef.h>   // Sizes (size_t, max_align_t)
+#include <stdalign.h> // Alignment (alignas())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+
+// Define struct ArenaBlock
+// A block of memory that allocations are carved out of, front to back.
+// When a block is full, a larger one is chained in front of it.
+typedef struct ArenaBlock {
+    struct ArenaBlock *previous;  // Block that was full before this one was added
+    size_t capacity;              // Number of bytes in memory
+    size_t used;                  // Number of bytes of memory handed out
+    alignas(max_align_t) unsigned char memory[]; // Aligned like the allocations (the header alone isn't)
+} ArenaBlock;
+
+// Define struct Arena
+// Serves allocations that are all freed at the same time. A compiled expression keeps
+// everything it needs in one (its text, tokens, tree and code, see calc.c), released by
+// calcFree(); the command line calculator keeps what it prints in another, which is reset
+// before each evaluation and takes constant time once it has grown to fit the largest one.
+// Nothing is freed on its own. A zero-initialized Arena is empty and ready to use.
+typedef struct Arena {
+    ArenaBlock *block;      // Block allocations are currently made from (NULL if none yet)
+    size_t used;            // Number of bytes allocated since the last reset
+    size_t highWaterMark;   // Largest number of bytes allocated between two resets
+} Arena;
+
+// Returns size bytes of memory (aligned for any type) that stay valid until the next reset,
+// or NULL if out of memory.
+void *arenaAllocate(Arena *arena, size_t size);
+
+// Gives an empty arena a first block of capacity bytes instead of the default size, for
+// callers that know roughly how much they will allocate. Returns false if out of memory.
+bool arenaReserve(Arena *arena, size_t capacity);
+
+// Returns the number of bytes the arena has reserved (its blocks, whether used or not)
+size_t arenaCapacity(const Arena *arena);
+
+// Makes all the memory of the arena available again.
+// If the last evaluation needed more than one block, they are replaced by a single block
+// large enough for all of it, so that later resets are constant time.
+void arenaReset(Arena *arena);
+
+// Frees all the memory of the arena
+void arenaRelease(Arena *arena);
+
+#endif // CALCULATOR_ARENA_H
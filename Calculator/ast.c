@@ -0,0 +1,134 @@
+// Justin Chen
+// Syntax trees of expressions and their tree-walking evaluator
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"
+#include "operations.h"  // Operators and functions (applyOperator(), applyFused(), applyReduction(), applyFunction(), factorial())
+
+int astAddNode(Ast *ast, Symbol type, int left, int right, uint32_t position) {
+  AstNode *node = &ast->nodes[ast->numNodes];
+  node->type = (unsigned char) type;
+  node->left = left;
+  node->right = right;
+  ast->positions[ast->numNodes] = position;
+  return ast->numNodes++;
+}
+
+// Work items of the stacks in evaluateAst() and astPostOrder() are node indices, doubled, with the
+// lowest bit set once the node's operands have been pushed
+#define VISIT(index) ((index) * 2)
+#define FINISH(index) ((index) * 2 + 1)
+
+// Pushes the work items of a node: finishing it after visiting its operands (the left operand
+// is pushed last, so it is visited first)
+static int pushOperands(const AstNode *node, int index, int32_t *work, int numWork) {
+  work[numWork++] = FINISH(index);
+  if (astHasRightOperand(node)) {
+    work[numWork++] = VISIT(node->right);
+  }
+  if (astHasLeftOperand(node)) {
+    work[numWork++] = VISIT(node->left);
+  }
+  return numWork;
+}
+
+double evaluateAst(const Ast *ast, int index, const AstEvaluation *evaluation) {
+  int32_t *work = evaluation->work;
+  double *values = evaluation->values;
+  int numWork = 0;
+  int numValues = 0;
+
+  // Walk the tree depth-first with explicit stacks: a node is visited (its operands are pushed),
+  // then once they are evaluated, it is finished (its operation is applied to their values)
+  work[numWork++] = VISIT(index);
+  while (numWork > 0) {
+    int32_t item = work[--numWork];
+    index = item / 2;
+    const AstNode *node = &ast->nodes[index];
+    Symbol type = node->type;
+    switch (type) { // Check the type of the node
+      case NUMBER: // Value converted during tokenization
+        values[numValues++] = ast->literals[node->left];
+        continue;
+      case MATH_PI: // π
+        values[numValues++] = M_PI;
+        continue;
+      case MATH_E:  // exp
+        values[numValues++] = M_E;
+        continue;
+      case RAND_NUM: // returns random number
+        values[numValues++] = randomNumber(evaluation->randomState);
+        continue;
+      case LOAD_SHARED: // Value of a repeated subexpression, evaluated before
+        values[numValues++] = evaluation->shared[node->right];
+        continue;
+      default:
+        break;
+    }
+
+    if (item == VISIT(index)) { // Evaluate the operands first
+      numWork = pushOperands(node, index, work, numWork);
+      continue;
+    }
+
+    double *top = &values[numValues - 1];
+    switch (type) {
+      case NEGATE: // Negation
+        *top = -*top;
+        break;
+      case STORE_SHARED: // Save the value for the LOAD_SHARED nodes after it
+        evaluation->shared[node->right] = *top;
+        break;
+      case INTEGER_POWER: // Powers with constant exponents
+        *top = integerPower(*top, node->right);
+        break;
+      case ROOT_POWER:
+        *top = rootPower(*top, node->right);
+        break;
+      case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER: case HYPOT:
+        // The left operand was evaluated first, as it is when parsing
+        top[-1] = applyOperator(type, top[-1], top[0]);
+        numValues--;
+        break;
+      case OPERAND_PAIR: // Both values are left for the fused operation (or the sum)
+        break;
+      case SUM: case COMPENSATED_SUM: case PRODUCT: // The terms are the top right values
+        numValues -= node->right - 1;
+        values[numValues - 1] = applyReduction(type, &values[numValues - 1], node->right);
+        break;
+      case FUSED_MULTIPLY_ADD: case FUSED_MULTIPLY_SUBTRACT: case FUSED_ADD_MULTIPLY: case FUSED_SUBTRACT_MULTIPLY:
+        top[-2] = applyFused(type, top[-2], top[-1], top[0]);
+        numValues -= 2;
+        break;
+      case FACTORIAL: // Factorials
+        if (*top < 0) {
+          evaluation->domainError(evaluation->context, ast->positions[index]);
+          *top = 0;
+        } else {
+          *top = factorial(*top);
+        }
+        break;
+      default: // Functions
+        *top = applyFunction(type, *top);
+        break;
+    }
+  }
+  return values[0];
+}
+
+int astPostOrder(const Ast *ast, int index, int32_t *order, int32_t *work) {
+  int numWork = 0;
+  int numOrder = 0;
+  work[numWork++] = VISIT(index);
+  while (numWork > 0) {
+    int32_t item = work[--numWork];
+    index = item / 2;
+    const AstNode *node = &ast->nodes[index];
+    if (item == VISIT(index) && astHasLeftOperand(node)) {
+      numWork = pushOperands(node, index, work, numWork);
+    } else {
+      order[numOrder++] = index;
+    }
+  }
+  return numOrder;
+}
@@ -0,0 +1,97 @@
+// Justin Chen
+// Syntax trees of expressions, so that an expression parsed once can be evaluated many times
+
+#ifndef CALCULATOR_AST_H
+#define CALCULATOR_AST_H
+
+#include <stdint.h>   // Fixed-width integers (uint32_t, uint64_t)
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "symbol.h"   // Node types (Symbol)
+
+// Marks a missing operand
+#define NO_NODE (-1)
+
+// Define struct AstNode
+// An operation and the indices of its operands in Ast.nodes.
+// Operands always come before the node that uses them, so the last node is the root and the
+// nodes are in the order a left-to-right evaluation finishes them.
+// - NUMBER: left is the index of its value in Ast.literals
+// - MATH_PI, MATH_E, RAND_NUM: no operands
+// - NEGATE, FACTORIAL and functions: left is the operand
+// - ADD, MINUS, MULTIPLY, DIVIDE, MODULO, POWER: left and right operands
+// - STORE_SHARED: left is the operand, whose value is saved in slot right of AstEvaluation.shared
+//   (and is also the node's value)
+// - LOAD_SHARED: no operands, the value is the one saved in slot right
+// - INTEGER_POWER: left is the base, right is the exponent itself (see integerPower())
+// - ROOT_POWER: left is the base, right is the root, 2 or 3 (see rootPower())
+// - OPERAND_PAIR: left and right operands, whose values are both left for the node that uses it
+// - FUSED_MULTIPLY_ADD, FUSED_MULTIPLY_SUBTRACT: left is an OPERAND_PAIR of x and y, right is z
+// - FUSED_ADD_MULTIPLY, FUSED_SUBTRACT_MULTIPLY: left is x, right is an OPERAND_PAIR of y and z
+// - HYPOT: left and right operands; LOG1P, EXPM1: left is the operand
+// - SUM, COMPENSATED_SUM, PRODUCT: left is the list of the terms, a left-deep chain of OPERAND_PAIR
+//   nodes (whose values are all left for it, in order), and right is the number of terms
+typedef struct AstNode {
+    unsigned char type;  // Symbol of the operation
+    int32_t left;
+    int32_t right;
+} AstNode;
+
+// Returns whether the left field of a node is an operand (a NUMBER keeps the index of its value there)
+// Defined here so that it is inlined into the passes and the tree walker, which call it on every node.
+static inline bool astHasLeftOperand(const AstNode *node) {
+  return node->left != NO_NODE && node->type != NUMBER;
+}
+
+// Returns whether the right field of a node is an operand (the nodes listed here keep a number
+// there instead, see above)
+static inline bool astHasRightOperand(const AstNode *node) {
+  switch (node->type) {
+    case STORE_SHARED: case LOAD_SHARED: case INTEGER_POWER: case ROOT_POWER:
+    case SUM: case COMPENSATED_SUM: case PRODUCT:
+      return false;
+    default:
+      return node->right != NO_NODE;
+  }
+}
+
+// Define struct Ast
+// A syntax tree stored as a contiguous array of nodes that refer to each other by index.
+// The arrays are allocated by whoever builds the tree (see calcCompile()); add nodes with astAddNode().
+typedef struct Ast {
+    AstNode *nodes;
+    uint32_t *positions;   // Index of the character each node's token starts at (for error messages)
+    int numNodes;
+    const double *literals; // Values of the NUMBER nodes
+    int numShared;          // Number of slots of STORE_SHARED and LOAD_SHARED nodes
+} Ast;
+
+// Appends a node to a tree and returns its index
+int astAddNode(Ast *ast, Symbol type, int left, int right, uint32_t position);
+
+// Define struct AstEvaluation
+// The state of evaluating a tree: where 'rand' numbers come from, who is told about errors, and
+// the stacks used to walk the tree (so that deep trees, e.g., of long sums, don't overflow the
+// call stack).
+typedef struct AstEvaluation {
+    int32_t *work;      // Nodes left to visit, at least 2 * numNodes of them (see evaluateAst())
+    double *values;     // Values of visited subtrees, at least numNodes of them
+    double *shared;     // Values saved by STORE_SHARED nodes, numShared of them
+    uint64_t *randomState;
+    // Called for each operation that isn't defined for its operand (e.g., '(-1)!'), with the
+    // position of its token
+    void (*domainError)(void *context, uint32_t position);
+    void *context;
+} AstEvaluation;
+
+// Evaluates the tree with its root at index.
+// Operands are evaluated left to right, so the result (and the random numbers) are the same as
+// evaluating the expression while parsing it.
+double evaluateAst(const Ast *ast, int index, const AstEvaluation *evaluation);
+
+// Stores the indices of the nodes of the tree with its root at index in order, so that operands
+// come before the operations that use them and left operands come before right ones (the order
+// evaluateAst() finishes them in). work needs space for 2 * numNodes indices.
+// Returns the number of nodes stored.
+int astPostOrder(const Ast *ast, int index, int32_t *order, int32_t *work);
+
+#endif // CALCULATOR_AST_H
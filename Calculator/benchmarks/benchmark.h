@@ -0,0 +1,40 @@
+// Justin Chen
+// Timing and error measurements shared by the benchmarks
+// Errors are measured in units in the last place (ulps) of exact results that the benchmarks
+// compute in long double, so they are only meaningful where long double is more precise than
+// double (e.g., x86-64, but not MSVC or ARM64 macOS, where they are the same).
+
+#ifndef CALCULATOR_BENCHMARK_H
+#define CALCULATOR_BENCHMARK_H
+
+#include <float.h>    // Limits of doubles (DBL_TRUE_MIN, DBL_MANT_DIG)
+#include <math.h>     // Math library (fabsl(), ldexp(), ilogb())
+#include <time.h>     // Timing (clock())
+#include "../calc.h"
+
+// Returns the number of seconds since the program started (of processor time)
+static inline double now(void) {
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+// Returns the error of a result in ulps of the exact value (∞ if the result isn't finite)
+static inline double errorInUlps(double result, long double exact) {
+  if (!isfinite(result)) {
+    return INFINITY;
+  }
+  double rounded = (double) exact;
+  double ulp = rounded == 0 ? DBL_TRUE_MIN : ldexp(1, ilogb(rounded) - (DBL_MANT_DIG - 1));
+  return (double) (fabsl(result - exact) / ulp);
+}
+
+// Evaluates a compiled expression count times and returns the time per evaluation in seconds,
+// and stores the result of the last evaluation
+static inline double timeEvaluations(CalcExpression *compiled, int count, double *result) {
+  double begin = now();
+  for (int i = 0; i < count; i++) {
+    calcEvaluate(compiled, result, NULL);
+  }
+  return (now() - begin) / count;
+}
+
+#endif // CALCULATOR_BENCHMARK_H
@@ -0,0 +1,279 @@
+// Justin Chen
+// Evaluator benchmark
+// Compares evaluating expressions with each backend of libcalc against compiling (tokenizing
+// and parsing) them again for every evaluation, like the calculator did before expressions
+// could be compiled once. The expressions are the lines of tests.txt and large generated ones.
+// The native backend is checked on its own, on constants that fold into NaN and ±∞.
+// Usage: evaluatorBenchmark [path of tests.txt, default tests.txt]
+
+#define _DEFAULT_SOURCE  // Temporary directories (mkdtemp())
+
+#include <stdio.h>    // I/O functions (printf(), fopen(), fgets())
+#include <stdlib.h>   // Standard library (malloc(), free(), rand(), mkdtemp())
+#include <string.h>   // String functions (strlen(), strcspn(), memcpy(), strcmp())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <math.h>     // Math library (isnan(), signbit())
+#include <dirent.h>   // Directories (opendir(), readdir())
+#include <unistd.h>   // Files (unlink(), rmdir())
+#include "benchmark.h"
+
+// Number of expressions from tests.txt that are kept
+#define MAX_EXPRESSIONS 256
+
+// Disables every optimization pass
+#define NO_PASSES (~0u)
+
+// Ways of evaluating that are compared (the first is the reference the others are checked against)
+// The backends are compared on the whole expression (without optimization passes), then the
+// bytecode is measured with repeated subexpressions evaluated once (and nothing else), and the
+// default backend with every pass.
+static const CalcOptions configurations[] = {
+    {CALC_BACKEND_TREE, NO_PASSES}, {CALC_BACKEND_BYTECODE, NO_PASSES}, {CALC_BACKEND_REGISTER, NO_PASSES},
+    {CALC_BACKEND_JIT, NO_PASSES}, {CALC_BACKEND_BYTECODE, ~(unsigned) CALC_PASS_SHARE}, {CALC_BACKEND_DEFAULT, 0},
+};
+static const char *configurationNames[] = {"tree walk", "bytecode", "registers", "machine code", "shared", "optimized"};
+#define NUM_CONFIGURATIONS ((int) (sizeof(configurations) / sizeof(configurations[0])))
+
+// Expression fragments that the generated inputs are built from
+// Arithmetic: operators and numbers only
+static const char *arithmeticFragments[] = {
+    "12.5 * 3 + ", "2^10 - ", "7 % 3 * 4 + ", "(1 + 2) (3 + 4) - ", "1.25 / 0.5 + ", "-3 * -2 - ",
+};
+
+// Functions: mostly calls of functions
+static const char *functionFragments[] = {
+    "sin(30) * cos(60) + ", "sqrt(144) - cbrt(27) + ", "ln(e^2) * log(100) - ", "degtorad(radtodeg(1.25)) + ",
+    "abs(-3)^2 - ", "exp(1) * inv(4) + ", "floor(2.5) + ceil(2.5) - round(2.5) + ",
+};
+
+// Simple polynomials, the kind of expression that is evaluated over and over
+static char *polynomials[] = {
+    "3.5^3 - 2 * 3.5^2 + 7 * 3.5 - 1", "0.25 * 1.5^2 + 1.5 + 4", "(2.75 - 1) (2.75 + 1) (2.75 - 3)",
+    "-4.5^2 + 9 * 4.5 - 16", "1 + 0.5 + 0.5^2 / 2 + 0.5^3 / 6 + 0.5^4 / 24",
+};
+
+// Polynomials and roots of random numbers, which can't be folded into a constant
+static char *randomPolynomials[] = {
+    "rand^3 - 2 rand^2 + 7 rand - 1", "(rand + 1)^4 - (rand - 1)^4", "rand^0.5 + rand^(1/3)",
+    "(2 rand)^5 / 120 - (2 rand)^3 / 6 + 2 rand", "(rand + 1)^-2 - (rand + 2)^-1",
+};
+
+// Random numbers written in roundabout ways, which simplifying rewrites into cheaper forms
+static char *redundantRandoms[] = {
+    "rand * 1 + --rand - -rand / 1", "-rand * -rand + rand / 4", "abs(-abs(rand)) + floor(ceil(rand * 8))",
+    "(rand - 2)^1 * 1 / 8 + -(-rand)", "-rand / 2 + -rand / 16 - -(rand - 1)",
+};
+
+// Expressions with constants that fold into NaNs (of both signs) and ±∞, which the native backend
+// has to write out as C constants
+static const char *specialConstants[] = {
+    "rand + sqrt(-1)", "rand + -sqrt(-1)", "rand * -(0/0)", "rand + 10^400", "rand - 10^400",
+};
+#define NUM_SPECIAL_CONSTANTS ((int) (sizeof(specialConstants) / sizeof(specialConstants[0])))
+
+// Builds an expression of about length characters out of randomly chosen fragments, ending with
+// a number (a fixed seed keeps the input the same between runs)
+static char *buildInput(const char **fragments, int numFragments, int length) {
+  char *exp = malloc(length + 64);
+  int filled = 0;
+  srand(2021);
+  while (filled < length) {
+    const char *fragment = fragments[rand() % numFragments];
+    int fragmentLength = (int) strlen(fragment);
+    memcpy(exp + filled, fragment, fragmentLength);
+    filled += fragmentLength;
+  }
+  strcpy(exp + filled, "1");
+  return exp;
+}
+
+// Builds an expression of depth nested parentheses, e.g., '(1 + (1 + (1)))'
+static char *buildNested(int depth) {
+  char *exp = malloc(6 * depth + 2);
+  int filled = 0;
+  for (int i = 0; i < depth; i++) {
+    memcpy(exp + filled, "(1 + ", 5);
+    filled += 5;
+  }
+  exp[filled++] = '1';
+  for (int i = 0; i < depth; i++) {
+    exp[filled++] = ')';
+  }
+  exp[filled] = '\0';
+  return exp;
+}
+
+// Whether two results are the same (NaNs are the same as each other)
+static bool sameResult(double a, double b) {
+  return a == b || (isnan(a) && isnan(b));
+}
+
+// Times evaluating a set of expressions rounds times with every configuration, and compiling and
+// evaluating them every time. Prints the time per evaluation of each.
+// Returns false if the configurations don't give the same results.
+static bool runBenchmark(const char *name, char **expressions, int numExpressions, int rounds) {
+  printf("%s: %d expression(s), %d round(s)\n", name, numExpressions, rounds);
+
+  // Compile and evaluate every time (with the tree walker, as before)
+  CalcOptions treeOptions = {CALC_BACKEND_TREE, NO_PASSES};
+  double begin = now();
+  for (int round = 0; round < rounds; round++) {
+    for (int i = 0; i < numExpressions; i++) {
+      double result;
+      CalcExpression *compiled = calcCompileWithOptions(expressions[i], &treeOptions, NULL);
+      calcEvaluate(compiled, &result, NULL);
+      calcFree(compiled);
+    }
+  }
+  double reparseTime = (now() - begin) / rounds / numExpressions;
+  printf("  compile + evaluate: %12.1f ns/evaluation\n", reparseTime * 1e9);
+
+  double *reference = malloc(numExpressions * sizeof(double));
+  bool passed = true;
+  for (int configuration = 0; configuration < NUM_CONFIGURATIONS; configuration++) {
+    CalcExpression **compiled = malloc(numExpressions * sizeof(CalcExpression *));
+    for (int i = 0; i < numExpressions; i++) {
+      compiled[i] = calcCompileWithOptions(expressions[i], &configurations[configuration], NULL);
+    }
+
+    double result = 0;
+    begin = now();
+    for (int round = 0; round < rounds; round++) {
+      for (int i = 0; i < numExpressions; i++) {
+        calcEvaluate(compiled[i], &result, NULL);
+      }
+    }
+    double time = (now() - begin) / rounds / numExpressions;
+    printf("  %-18s  %12.1f ns/evaluation (%.1fx)\n", configurationNames[configuration], time * 1e9, reparseTime / time);
+
+    // Check the results against the first configuration's (each compiled expression's random numbers
+    // start from the same seed, so they agree too)
+    for (int i = 0; i < numExpressions; i++) {
+      calcEvaluate(compiled[i], &result, NULL);
+      if (configuration == 0) {
+        reference[i] = result;
+      } else if (!sameResult(result, reference[i])) {
+        printf("Error: %s gives %.17g instead of %.17g for '%.60s'\n", configurationNames[configuration], result, reference[i],
+               expressions[i]);
+        passed = false;
+      }
+      calcFree(compiled[i]);
+    }
+    free(compiled);
+  }
+  printf("\n");
+  free(reference);
+  return passed;
+}
+
+// Returns the number of shared objects in a directory, removing every file in it if remove is set
+static int countSharedObjects(const char *directory, bool remove) {
+  DIR *dir = opendir(directory);
+  if (dir == NULL) {
+    return 0;
+  }
+  int count = 0;
+  struct dirent *entry;
+  char path[1024];
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    size_t length = strlen(entry->d_name);
+    count += length > 3 && strcmp(entry->d_name + length - 3, ".so") == 0;
+    if (remove) {
+      snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dir);
+  return count;
+}
+
+// Checks the native backend against the tree walker on specialConstants, both when it builds a
+// shared object and when it loads it from the cache, and that each expression was built into one
+// (if its C code doesn't compile, the bytecode is used instead, which gives the same results but
+// runs the C compiler again on every compile)
+// Returns false if they differ in any bit (including the sign of a NaN) or any wasn't built.
+static bool checkNative(void) {
+  char directory[] = "/tmp/evaluatorBenchmarkXXXXXX";
+  if (mkdtemp(directory) == NULL) {
+    printf("Error: couldn't create a cache directory for the native backend\n");
+    return false;
+  }
+  printf("Native backend on special constants: %d expression(s)\n", NUM_SPECIAL_CONSTANTS);
+  CalcOptions treeOptions = {CALC_BACKEND_TREE}, nativeOptions = {CALC_BACKEND_NATIVE, 0, directory};
+  bool passed = true;
+  for (int i = 0; i < NUM_SPECIAL_CONSTANTS; i++) {
+    CalcExpression *compiled[3] = {calcCompileWithOptions(specialConstants[i], &treeOptions, NULL),
+                                   calcCompileWithOptions(specialConstants[i], &nativeOptions, NULL),
+                                   calcCompileWithOptions(specialConstants[i], &nativeOptions, NULL)};
+    double results[3];
+    for (int j = 0; j < 3; j++) {
+      calcEvaluate(compiled[j], &results[j], NULL);
+      if (j > 0 && (!sameResult(results[j], results[0]) || signbit(results[j]) != signbit(results[0]))) {
+        printf("Error: native (%s) gives %.17g instead of %.17g for '%s'\n", j == 1 ? "built" : "cached",
+               results[j], results[0], specialConstants[i]);
+        passed = false;
+      }
+      calcFree(compiled[j]);
+    }
+  }
+  int numBuilt = countSharedObjects(directory, true);
+  rmdir(directory);
+  if (numBuilt != NUM_SPECIAL_CONSTANTS) {
+    printf("Error: %d of %d expression(s) were built into shared objects\n", numBuilt, NUM_SPECIAL_CONSTANTS);
+    passed = false;
+  }
+  printf("\n");
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "tests.txt";
+  bool passed = true;
+
+  // Expressions of tests.txt (the ones that are valid)
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("Unable to open '%s'.\n", path);
+    return 1;
+  }
+  char *corpus[MAX_EXPRESSIONS];
+  int numCorpus = 0;
+  char line[1024];
+  while (numCorpus < MAX_EXPRESSIONS && fgets(line, sizeof(line), file) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    CalcExpression *compiled = calcCompile(line, NULL);
+    if (compiled != NULL) {
+      corpus[numCorpus] = malloc(strlen(line) + 1);
+      strcpy(corpus[numCorpus++], line);
+    }
+    calcFree(compiled);
+  }
+  fclose(file);
+  passed = runBenchmark("tests.txt", corpus, numCorpus, 20000) && passed;
+  for (int i = 0; i < numCorpus; i++) {
+    free(corpus[i]);
+  }
+
+  passed = runBenchmark("Polynomials", polynomials, sizeof(polynomials) / sizeof(polynomials[0]), 400000) && passed;
+  passed = runBenchmark("Polynomials of rand", randomPolynomials, sizeof(randomPolynomials) / sizeof(randomPolynomials[0]),
+                        400000) && passed;
+  passed = runBenchmark("Redundant forms of rand", redundantRandoms, sizeof(redundantRandoms) / sizeof(redundantRandoms[0]),
+                        400000) && passed;
+
+  passed = checkNative() && passed;
+
+  // Large generated expressions
+  char *arithmetic = buildInput(arithmeticFragments, sizeof(arithmeticFragments) / sizeof(arithmeticFragments[0]), 1 << 20);
+  char *functions = buildInput(functionFragments, sizeof(functionFragments) / sizeof(functionFragments[0]), 1 << 20);
+  char *nested = buildNested(10000);
+  passed = runBenchmark("Arithmetic (1 MB)", &arithmetic, 1, 20) && passed;
+  passed = runBenchmark("Functions (1 MB)", &functions, 1, 20) && passed;
+  passed = runBenchmark("Nested parentheses (depth 10000)", &nested, 1, 2000) && passed;
+  free(arithmetic);
+  free(functions);
+  free(nested);
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Justin Chen
+// Fused operation benchmark
+// Compares expressions that CALC_PASS_FUSE rewrites into fma(), log1p(), expm1() and hypot()
+// against the same expressions computed unfused (CalcOptions.fastMath with the pass disabled):
+// the time per evaluation with the bytecode and machine code backends, and the error of the
+// results in ulps of the exact ones, computed from the same random numbers.
+// Usage: fusionBenchmark
+
+#include <stdio.h>    // I/O functions (printf())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <math.h>     // Math library (ldexpl(), log1pl(), expm1l(), sqrtl())
+#include "benchmark.h"
+
+// Number of evaluations timed and checked for each expression
+#define NUM_EVALUATIONS 1000000
+
+// Largest number of 'rand' identifiers in an expression
+#define MAX_RANDOMS 4
+
+// Define struct FusionCase
+// An expression with a pattern that is fused, and its exact value for the random numbers it draws
+typedef struct FusionCase {
+    const char *name;
+    const char *expression;
+    int numRandoms;
+    long double (*exact)(const long double *random);
+} FusionCase;
+
+static long double exactMultiplyAdd(const long double *u) { return u[0] * u[1] + u[2]; }
+static long double exactDifferenceOfProducts(const long double *u) { return u[0] * u[1] - u[2] * u[3]; }
+static long double exactLog1p(const long double *u) { return log1pl(u[0] / 1048576); }
+static long double exactExpm1(const long double *u) { return expm1l(u[0] / 1048576); }
+static long double exactHypot(const long double *u) { return sqrtl(u[0] * u[0] + u[1] * u[1]); }
+static long double exactLargeHypot(const long double *u) {
+  long double x = ldexpl(u[0], 600), y = ldexpl(u[1], 600);
+  return sqrtl(x * x + y * y);
+}
+
+static const FusionCase cases[] = {
+    {"Multiply-add", "rand * rand + rand", 3, exactMultiplyAdd},
+    {"Difference of products", "rand * rand - rand * rand", 4, exactDifferenceOfProducts},
+    {"ln(1 + x) of a small x", "ln(1 + rand / 1048576)", 1, exactLog1p},
+    {"e^x - 1 of a small x", "exp(rand / 1048576) - 1", 1, exactExpm1},
+    {"sqrt(x^2 + y^2)", "sqrt(rand^2 + rand^2)", 2, exactHypot},
+    {"sqrt(x^2 + y^2) of large x and y", "sqrt((rand * 2^600)^2 + (rand * 2^600)^2)", 2, exactLargeHypot},
+};
+#define NUM_CASES ((int) (sizeof(cases) / sizeof(cases[0])))
+
+// Times evaluating an expression with a backend and returns the time per evaluation in seconds
+// Returns a negative time if it couldn't be compiled.
+static double timeEvaluation(const FusionCase *fusionCase, CalcBackend backend, unsigned disabledPasses) {
+  CalcOptions options = {backend, disabledPasses, NULL, true};
+  CalcExpression *compiled = calcCompileWithOptions(fusionCase->expression, &options, NULL);
+  if (compiled == NULL) {
+    return -1;
+  }
+  double result;
+  double time = timeEvaluations(compiled, NUM_EVALUATIONS, &result);
+  calcFree(compiled);
+  return time;
+}
+
+// Measures the mean and largest error of an expression's results
+// The random numbers it draws are drawn again by a compiled 'rand', which starts from the same
+// seed, so the exact value is computed from the same numbers.
+// Returns false if it couldn't be compiled.
+static bool measureError(const FusionCase *fusionCase, unsigned disabledPasses, double *meanError, double *maxError) {
+  CalcOptions options = {CALC_BACKEND_DEFAULT, disabledPasses, NULL, true};
+  CalcExpression *compiled = calcCompileWithOptions(fusionCase->expression, &options, NULL);
+  CalcExpression *random = calcCompile("rand", NULL);
+  if (compiled == NULL || random == NULL) {
+    calcFree(compiled);
+    calcFree(random);
+    return false;
+  }
+  *meanError = 0;
+  *maxError = 0;
+  for (int i = 0; i < NUM_EVALUATIONS; i++) {
+    long double u[MAX_RANDOMS];
+    for (int j = 0; j < fusionCase->numRandoms; j++) {
+      double value;
+      calcEvaluate(random, &value, NULL);
+      u[j] = value;
+    }
+    double result;
+    calcEvaluate(compiled, &result, NULL);
+    double error = errorInUlps(result, fusionCase->exact(u));
+    *meanError += error / NUM_EVALUATIONS;
+    if (error > *maxError) {
+      *maxError = error;
+    }
+  }
+  calcFree(compiled);
+  calcFree(random);
+  return true;
+}
+
+int main() {
+  bool passed = true;
+  for (int i = 0; i < NUM_CASES; i++) {
+    const FusionCase *fusionCase = &cases[i];
+    printf("%s: '%s', %d evaluations\n", fusionCase->name, fusionCase->expression, NUM_EVALUATIONS);
+    for (int fused = 0; fused < 2; fused++) {
+      unsigned disabledPasses = fused ? 0 : CALC_PASS_FUSE;
+      double bytecodeTime = timeEvaluation(fusionCase, CALC_BACKEND_BYTECODE, disabledPasses);
+      double machineCodeTime = timeEvaluation(fusionCase, CALC_BACKEND_JIT, disabledPasses);
+      double meanError, maxError;
+      if (bytecodeTime < 0 || machineCodeTime < 0 || !measureError(fusionCase, disabledPasses, &meanError, &maxError)) {
+        printf("Error: '%s' couldn't be compiled\n", fusionCase->expression);
+        passed = false;
+        break;
+      }
+      printf("  %-8s  bytecode %8.1f ns, machine code %8.1f ns, error %8.3f ulp mean, %8.3f ulp max\n",
+             fused ? "fused" : "unfused", bytecodeTime * 1e9, machineCodeTime * 1e9, meanError, maxError);
+    }
+    printf("\n");
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Justin Chen
+// Lexer microbenchmark
+// Compares finding token boundaries one character at a time (like tokenize() used to with
+// isNumeric()/isAlpha()) against finding them with the character class masks from classify.c.
+// Usage: lexerBenchmark [megabytes of input, default 16]
+
+#include <stdio.h>    // I/O functions (printf())
+#include <stdlib.h>   // Standard library (malloc(), free(), atoi(), rand())
+#include <string.h>   // String functions (strlen(), memcpy())
+#include <ctype.h>    // Lowercase character function tolower()
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "../classify.h"
+#include "benchmark.h"
+
+// Expression fragments that the benchmark inputs are built from
+// Dense input: short tokens with little whitespace (typed expressions)
+static const char *denseFragments[] = {
+    "12.5 * sin(30) + ", "pi^2 - ", "4!/(7 % 3) + ", "sqrt(144)cbrt(27) - ", "\t2pi * e + ",
+    "degtorad(radtodeg(1.25)) * ", "(1 + 2) (3 + 4) - ", "123456789.987654321 / ", "abs(-3)^2 + ",
+};
+
+// Padded input: long literals and identifiers, aligned with runs of whitespace (generated formulas)
+static const char *paddedFragments[] = {
+    "        0.000000000000000000012345678901234567890 *     ",
+    "    degtorad(    radtodeg(      1234567890.0987654321    ))   +   ",
+    "\t\t\t\t31415926535897932384626433832795028841971   -        ",
+    "   atanh(  0.50000000000000000000000000000000000000001  )      /    ",
+    "                                        12345678901234567890          +   ",
+};
+
+// Counts tokens by classifying one character at a time
+static long countTokensScalar(const char *exp, int length) {
+  long numTokens = 0;
+  int current = 0;
+  while (current < length) {
+    char c = exp[current];
+    if (c >= '0' && c <= '9') {
+      while (current + 1 < length && exp[current + 1] >= '0' && exp[current + 1] <= '9') current++;
+      if (current + 1 < length && exp[current + 1] == '.') {
+        current++;
+        while (current + 1 < length && exp[current + 1] >= '0' && exp[current + 1] <= '9') current++;
+      }
+      numTokens++;
+    } else if (tolower(c) >= 'a' && tolower(c) <= 'z') {
+      while (current + 1 < length && tolower(exp[current + 1]) >= 'a' && tolower(exp[current + 1]) <= 'z') current++;
+      numTokens++;
+    } else if (c != ' ' && c != '\t') {
+      numTokens++;
+    }
+    current++;
+  }
+  return numTokens;
+}
+
+// Counts tokens by skipping runs of characters with the class masks
+static long countTokensMasks(const char *exp, int length, CharClasses classes) {
+  long numTokens = 0;
+  int current = 0;
+  while (current < length) {
+    if (inClass(classes.digits, current)) {
+      current = skipClass(classes.digits, current + 1, length);
+      if (current < length && exp[current] == '.') {
+        current = skipClass(classes.digits, current + 1, length);
+      }
+      numTokens++;
+    } else if (inClass(classes.letters, current)) {
+      current = skipClass(classes.letters, current + 1, length);
+      numTokens++;
+    } else if (inClass(classes.spaces, current)) {
+      current = skipClass(classes.spaces, current + 1, length);
+    } else {
+      numTokens++;
+      current++;
+    }
+  }
+  return numTokens;
+}
+
+// Builds an input of length characters out of randomly chosen fragments
+// (a fixed seed keeps the input the same between runs)
+static char *buildInput(const char **fragments, int numFragments, int length) {
+  char *exp = malloc(length + 1);
+  int filled = 0;
+  srand(2021);
+  while (filled < length) {
+    const char *fragment = fragments[rand() % numFragments];
+    int fragmentLength = (int) strlen(fragment);
+    if (fragmentLength > length - filled) fragmentLength = length - filled;
+    memcpy(exp + filled, fragment, fragmentLength);
+    filled += fragmentLength;
+  }
+  exp[length] = '\0';
+  return exp;
+}
+
+// Times each way of lexing an input and prints the results
+// Returns false if they don't find the same number of tokens
+static bool runBenchmark(const char *name, const char *exp, int length, CharClasses classes) {
+  const int rounds = 5;
+
+  // Character at a time
+  double begin = now();
+  long scalarTokens = 0;
+  for (int round = 0; round < rounds; round++) {
+    scalarTokens = countTokensScalar(exp, length);
+  }
+  double scalarTime = (now() - begin) / rounds;
+
+  // Scalar classification followed by skipping runs
+  begin = now();
+  long scalarMaskTokens = 0;
+  for (int round = 0; round < rounds; round++) {
+    classifyCharactersScalar(exp, length, classes);
+    scalarMaskTokens = countTokensMasks(exp, length, classes);
+  }
+  double scalarMaskTime = (now() - begin) / rounds;
+
+  // Vectorized classification followed by skipping runs
+  begin = now();
+  long maskTokens = 0;
+  for (int round = 0; round < rounds; round++) {
+    classifyCharacters(exp, length, classes);
+    maskTokens = countTokensMasks(exp, length, classes);
+  }
+  double maskTime = (now() - begin) / rounds;
+
+  double megabytes = length / (1024.0 * 1024.0);
+  printf("%s input: %.0f MB, %ld tokens\n", name, megabytes, scalarTokens);
+  printf("  character at a time:      %8.2f ms (%7.1f MB/s)\n", scalarTime * 1000, megabytes / scalarTime);
+  printf("  scalar masks + skipping:  %8.2f ms (%7.1f MB/s)\n", scalarMaskTime * 1000, megabytes / scalarMaskTime);
+  printf("  vector masks + skipping:  %8.2f ms (%7.1f MB/s)\n", maskTime * 1000, megabytes / maskTime);
+  printf("  speedup: %.2fx\n\n", scalarTime / maskTime);
+
+  if (scalarTokens != maskTokens || scalarTokens != scalarMaskTokens) {
+    printf("Error: token counts differ (%ld, %ld, %ld)\n", scalarTokens, scalarMaskTokens, maskTokens);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int megabytes = argc > 1 ? atoi(argv[1]) : 16;
+  int length = megabytes * 1024 * 1024;
+
+  CharClasses classes = {
+      malloc(MASK_WORDS(length) * sizeof(uint64_t)), malloc(MASK_WORDS(length) * sizeof(uint64_t)),
+      malloc(MASK_WORDS(length) * sizeof(uint64_t)), malloc(MASK_WORDS(length) * sizeof(uint64_t)),
+  };
+
+  char *dense = buildInput(denseFragments, sizeof(denseFragments) / sizeof(denseFragments[0]), length);
+  char *padded = buildInput(paddedFragments, sizeof(paddedFragments) / sizeof(paddedFragments[0]), length);
+  bool passed = runBenchmark("Dense", dense, length, classes) && runBenchmark("Padded", padded, length, classes);
+
+  free(dense);
+  free(padded);
+  free(classes.digits);
+  free(classes.letters);
+  free(classes.operators);
+  free(classes.spaces);
+  return passed ? 0 : 1;
+}
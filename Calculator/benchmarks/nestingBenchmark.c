@@ -0,0 +1,131 @@
+// Justin Chen
+// Nesting benchmark
+// Compiles and evaluates expressions nested NUM_LEVELS levels deep (parentheses, negations, a
+// tower of powers, functions of functions and sums nested on the right), which a recursive
+// parser could only handle with that many stack frames: the time to compile them with every
+// pass and with none (mostly parsing), the memory of the compiled expression per level (see
+// calcMemoryUsage()), and the time per evaluation with each backend. The backends are checked
+// against the tree walker, as each compiled expression starts from the same random seed.
+// Usage: nestingBenchmark
+
+#include <stdio.h>    // I/O functions (printf())
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <string.h>   // String functions (strlen(), memcpy())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "benchmark.h"
+
+// Number of levels of each expression, and evaluations timed for each backend
+#define NUM_LEVELS 100000
+#define NUM_EVALUATIONS 100
+
+// Passes that are disabled to time the parser (and the backend's compiler) on its own
+#define ALL_PASSES (CALC_PASS_FOLD | CALC_PASS_SHARE | CALC_PASS_POWERS | CALC_PASS_SIMPLIFY | CALC_PASS_FUSE | \
+                    CALC_PASS_FLATTEN | CALC_PASS_POLYNOMIALS)
+
+// Define struct NestingCase
+// An expression made of a prefix repeated NUM_LEVELS times, an innermost operand, and a suffix
+// repeated NUM_LEVELS times
+typedef struct NestingCase {
+    const char *name;
+    const char *prefix;
+    const char *operand;
+    const char *suffix;
+} NestingCase;
+
+static const NestingCase cases[] = {
+    {"Parentheses", "(", "rand", ")"},
+    {"Negations", "-", "rand", ""},
+    {"Tower of powers", "rand^", "rand", ""},
+    {"Functions of functions", "abs(", "rand", ")"},
+    {"Sums nested on the right", "rand + (", "rand", ")"},
+};
+#define NUM_CASES ((int) (sizeof(cases) / sizeof(cases[0])))
+
+static const CalcBackend backends[] = {CALC_BACKEND_TREE, CALC_BACKEND_BYTECODE, CALC_BACKEND_REGISTER,
+                                       CALC_BACKEND_JIT};
+static const char *backendNames[] = {"tree", "bytecode", "registers", "machine code"};
+#define NUM_BACKENDS ((int) (sizeof(backends) / sizeof(backends[0])))
+
+// Returns the expression of a case (NULL if out of memory)
+static char *buildExpression(const NestingCase *nestingCase) {
+  size_t prefixLength = strlen(nestingCase->prefix), suffixLength = strlen(nestingCase->suffix);
+  size_t operandLength = strlen(nestingCase->operand);
+  char *expression = malloc(NUM_LEVELS * (prefixLength + suffixLength) + operandLength + 1);
+  if (expression == NULL) {
+    return NULL;
+  }
+  char *end = expression;
+  for (int i = 0; i < NUM_LEVELS; i++) {
+    memcpy(end, nestingCase->prefix, prefixLength);
+    end += prefixLength;
+  }
+  memcpy(end, nestingCase->operand, operandLength);
+  end += operandLength;
+  for (int i = 0; i < NUM_LEVELS; i++) {
+    memcpy(end, nestingCase->suffix, suffixLength);
+    end += suffixLength;
+  }
+  *end = '\0';
+  return expression;
+}
+
+// Compiles an expression with a backend and passes disabled, and stores the time it took in seconds
+static CalcExpression *compile(const char *expression, CalcBackend backend, unsigned disabledPasses,
+                               double *compileTime) {
+  CalcOptions options = {backend, disabledPasses, NULL, false};
+  double begin = now();
+  CalcExpression *compiled = calcCompileWithOptions(expression, &options, NULL);
+  *compileTime = now() - begin;
+  return compiled;
+}
+
+// Times evaluating a compiled expression and returns the time per evaluation in seconds, and
+// stores the result of its first evaluation
+static double timeEvaluation(CalcExpression *compiled, double *result) {
+  calcEvaluate(compiled, result, NULL);
+  double value;
+  return timeEvaluations(compiled, NUM_EVALUATIONS, &value);
+}
+
+int main() {
+  bool passed = true;
+  for (int i = 0; i < NUM_CASES && passed; i++) {
+    const NestingCase *nestingCase = &cases[i];
+    char *expression = buildExpression(nestingCase);
+    if (expression == NULL) {
+      printf("Error: out of memory\n");
+      return 1;
+    }
+    printf("%s: '%s%s...%s%s...', %d levels, %d evaluations\n", nestingCase->name, nestingCase->prefix,
+           nestingCase->prefix, nestingCase->operand, nestingCase->suffix, NUM_LEVELS, NUM_EVALUATIONS);
+
+    double expected = 0;
+    for (int j = 0; j < NUM_BACKENDS; j++) {
+      double compileTime, parseTime, result;
+      CalcExpression *compiled = compile(expression, backends[j], 0, &compileTime);
+      CalcExpression *parsed = compile(expression, backends[j], ALL_PASSES, &parseTime);
+      if (compiled == NULL || parsed == NULL) {
+        printf("Error: '%s%s...' couldn't be compiled\n", nestingCase->prefix, nestingCase->prefix);
+        calcFree(compiled);
+        calcFree(parsed);
+        passed = false;
+        break;
+      }
+      double evaluationTime = timeEvaluation(compiled, &result);
+      if (j == 0) {
+        expected = result;
+      } else if (result != expected) {
+        printf("Error: %s computed %.17g instead of %.17g\n", backendNames[j], result, expected);
+        passed = false;
+      }
+      printf("  %-12s  compile %7.2f ms (no passes %7.2f ms), %6.1f bytes per level, evaluation %8.1f us\n",
+             backendNames[j], compileTime * 1e3, parseTime * 1e3,
+             (double) calcMemoryUsage(compiled) / NUM_LEVELS, evaluationTime * 1e6);
+      calcFree(compiled);
+      calcFree(parsed);
+    }
+    printf("\n");
+    free(expression);
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Justin Chen
+// Polynomial benchmark
+// Compares polynomials in a repeated subexpression, 'c_0 + c_1 x + c_2 x^2 + ...' with x = pi / 4,
+// computed term by term as parsed against the same polynomials rewritten by CALC_PASS_POLYNOMIALS
+// (Horner's rule, or Estrin's scheme from degree 8): the time per evaluation with the bytecode and
+// machine code backends, and the error of the result in ulps of the exact one. Both are compiled
+// with CalcOptions.fastMath (so both are fused), and without constant folding and simplification,
+// which would otherwise compute the whole polynomial once.
+// Usage: polynomialBenchmark
+
+#include <stdio.h>    // I/O functions (printf(), snprintf())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <math.h>     // Math library (fabs(), M_PI)
+#include "benchmark.h"
+
+// Number of evaluations timed for each expression
+#define NUM_EVALUATIONS 1000000
+
+// Highest degree of a polynomial, and the most characters of its expression
+#define MAX_DEGREE 24
+#define MAX_LENGTH 1024
+
+// The variable, and its value
+#define VARIABLE "(pi/4)"
+#define VARIABLE_VALUE (M_PI / 4)
+
+// Passes that are disabled for both ways of computing the polynomials
+#define DISABLED_PASSES (CALC_PASS_FOLD | CALC_PASS_SIMPLIFY)
+
+static const int degrees[] = {3, 5, 7, 12, 24};
+#define NUM_CASES ((int) (sizeof(degrees) / sizeof(degrees[0])))
+
+// Returns the coefficient of a power of the variable (halves and quarters of small numbers of
+// alternating sign, so that they are written out exactly)
+static double coefficientOf(int degree) {
+  return (degree % 2 == 0 ? 1 : -1) * ((degree * 5) % 9 + 1) / 4.0;
+}
+
+// Writes out the polynomial of a degree (e.g., '0.25 - 1.5(pi/4) + 0.75(pi/4)^2') and returns its
+// exact value
+static long double buildExpression(int degree, char *expression) {
+  long double exact = 0, power = 1;
+  int length = 0;
+  for (int i = 0; i <= degree; i++) {
+    double coefficient = coefficientOf(i);
+    exact += coefficient * power;
+    power *= (long double) VARIABLE_VALUE;
+    const char *sign = i == 0 ? (coefficient < 0 ? "-" : "") : (coefficient < 0 ? " - " : " + ");
+    if (i == 0) {
+      length += snprintf(expression + length, MAX_LENGTH - length, "%s%g", sign, fabs(coefficient));
+    } else if (i == 1) {
+      length += snprintf(expression + length, MAX_LENGTH - length, "%s%g%s", sign, fabs(coefficient), VARIABLE);
+    } else {
+      length += snprintf(expression + length, MAX_LENGTH - length, "%s%g%s^%d", sign, fabs(coefficient), VARIABLE, i);
+    }
+  }
+  return exact;
+}
+
+// Times evaluating an expression with a backend and returns the time per evaluation in seconds,
+// and stores its result. Returns a negative time if it couldn't be compiled.
+static double timeEvaluation(const char *expression, CalcBackend backend, unsigned disabledPasses, double *result) {
+  CalcOptions options = {backend, disabledPasses, NULL, true};
+  CalcExpression *compiled = calcCompileWithOptions(expression, &options, NULL);
+  if (compiled == NULL) {
+    return -1;
+  }
+  double time = timeEvaluations(compiled, NUM_EVALUATIONS, result);
+  calcFree(compiled);
+  return time;
+}
+
+int main() {
+  bool passed = true;
+  for (int i = 0; i < NUM_CASES && passed; i++) {
+    char expression[MAX_LENGTH];
+    long double exact = buildExpression(degrees[i], expression);
+    printf("Degree %d: '%s', %d evaluations\n", degrees[i], expression, NUM_EVALUATIONS);
+    for (int rewritten = 0; rewritten < 2; rewritten++) {
+      unsigned disabledPasses = rewritten ? DISABLED_PASSES : DISABLED_PASSES | CALC_PASS_POLYNOMIALS;
+      double result;
+      double bytecodeTime = timeEvaluation(expression, CALC_BACKEND_BYTECODE, disabledPasses, &result);
+      double machineCodeTime = timeEvaluation(expression, CALC_BACKEND_JIT, disabledPasses, &result);
+      if (bytecodeTime < 0 || machineCodeTime < 0) {
+        printf("Error: '%s' couldn't be compiled\n", expression);
+        passed = false;
+        break;
+      }
+      const char *name = !rewritten ? "as parsed" : degrees[i] >= 8 ? "Estrin" : "Horner";
+      printf("  %-9s  bytecode %8.1f ns, machine code %8.1f ns, error %8.3f ulp\n", name, bytecodeTime * 1e9,
+             machineCodeTime * 1e9, errorInUlps(result, exact));
+    }
+    printf("\n");
+  }
+  return passed ? 0 : 1;
+}
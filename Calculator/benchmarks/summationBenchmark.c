@@ -0,0 +1,185 @@
+// Justin Chen
+// Summation benchmark
+// Compares long sums and products ('rand + rand + ...' with NUM_TERMS terms) added in order (as
+// parsed), pairwise (CalcOptions.fastMath, see CALC_PASS_FLATTEN) and with compensated summation
+// (CalcOptions.compensatedSums): the time to compile them, the time per evaluation with the
+// bytecode and machine code backends, and the error of the results in ulps of the exact ones,
+// computed from the same random numbers (compensated sums, and pairwise products).
+// Usage: summationBenchmark
+
+#include <stdio.h>    // I/O functions (printf())
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <string.h>   // String functions (strlen(), memcpy())
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <math.h>     // Math library (fabsl())
+#include "benchmark.h"
+
+// Number of terms of each expression, and evaluations timed and checked for each
+#define NUM_TERMS 10000
+#define NUM_EVALUATIONS 1000
+
+// Define struct SummationCase
+// A term repeated NUM_TERMS times, the operator between them, and the exact value of a term and
+// of the whole expression for the random numbers it draws (one per term)
+typedef struct SummationCase {
+    const char *name;
+    const char *term;
+    const char *operator;
+    long double (*exactTerm)(long double random);
+    long double (*exact)(const long double *terms, int count);
+} SummationCase;
+
+// Define struct Configuration
+// How the expressions are compiled
+typedef struct Configuration {
+    const char *name;
+    bool fastMath;
+    bool compensatedSums;
+} Configuration;
+
+static long double randomTerm(long double u) { return u; }
+static long double centeredTerm(long double u) { return u - 0.5L; }
+static long double factorTerm(long double u) { return 1 + u / 10000; }
+
+// Returns the sum of terms with compensated summation (in long double, close enough to exact)
+static long double exactSum(const long double *terms, int count) {
+  long double sum = 0, compensation = 0;
+  for (int i = 0; i < count; i++) {
+    long double next = sum + terms[i];
+    compensation += fabsl(sum) >= fabsl(terms[i]) ? (sum - next) + terms[i] : (terms[i] - next) + sum;
+    sum = next;
+  }
+  return sum + compensation;
+}
+
+// Returns the product of terms multiplied pairwise (in long double, close enough to exact)
+static long double exactProduct(const long double *terms, int count) {
+  if (count == 1) {
+    return terms[0];
+  }
+  return exactProduct(terms, count / 2) * exactProduct(terms + count / 2, count - count / 2);
+}
+
+static const SummationCase cases[] = {
+    {"Sum of random numbers", "rand", " + ", randomTerm, exactSum},
+    {"Sum of terms that cancel", "(rand - 0.5)", " + ", centeredTerm, exactSum},
+    {"Product of factors close to 1", "(1 + rand / 10000)", " * ", factorTerm, exactProduct},
+};
+#define NUM_CASES ((int) (sizeof(cases) / sizeof(cases[0])))
+
+static const Configuration configurations[] = {
+    {"in order", false, false},
+    {"pairwise", true, false},
+    {"compensated", false, true},
+};
+#define NUM_CONFIGURATIONS ((int) (sizeof(configurations) / sizeof(configurations[0])))
+
+// Returns the expression of a case (NULL if out of memory)
+static char *buildExpression(const SummationCase *summationCase) {
+  size_t termLength = strlen(summationCase->term), operatorLength = strlen(summationCase->operator);
+  char *expression = malloc(NUM_TERMS * (termLength + operatorLength) + 1);
+  if (expression == NULL) {
+    return NULL;
+  }
+  char *end = expression;
+  for (int i = 0; i < NUM_TERMS; i++) {
+    if (i > 0) {
+      memcpy(end, summationCase->operator, operatorLength);
+      end += operatorLength;
+    }
+    memcpy(end, summationCase->term, termLength);
+    end += termLength;
+  }
+  *end = '\0';
+  return expression;
+}
+
+// Compiles an expression with a backend and configuration, and stores the time it took in seconds
+static CalcExpression *compile(const char *expression, CalcBackend backend, const Configuration *configuration,
+                               double *compileTime) {
+  CalcOptions options = {backend, 0, NULL, configuration->fastMath, configuration->compensatedSums};
+  double begin = now();
+  CalcExpression *compiled = calcCompileWithOptions(expression, &options, NULL);
+  *compileTime = now() - begin;
+  return compiled;
+}
+
+// Times evaluating an expression with a backend and returns the time per evaluation in seconds
+// Returns a negative time if it couldn't be compiled.
+static double timeEvaluation(const char *expression, CalcBackend backend, const Configuration *configuration,
+                             double *compileTime) {
+  CalcExpression *compiled = compile(expression, backend, configuration, compileTime);
+  if (compiled == NULL) {
+    return -1;
+  }
+  double result;
+  double time = timeEvaluations(compiled, NUM_EVALUATIONS, &result);
+  calcFree(compiled);
+  return time;
+}
+
+// Measures the mean and largest error of an expression's results
+// The random numbers it draws are drawn again by a compiled 'rand', which starts from the same
+// seed, so the exact value is computed from the same numbers.
+// Returns false if it couldn't be compiled.
+static bool measureError(const SummationCase *summationCase, const char *expression,
+                         const Configuration *configuration, double *meanError, double *maxError) {
+  double compileTime;
+  CalcExpression *compiled = compile(expression, CALC_BACKEND_DEFAULT, configuration, &compileTime);
+  CalcExpression *random = calcCompile("rand", NULL);
+  long double *terms = malloc(NUM_TERMS * sizeof(long double));
+  bool measured = compiled != NULL && random != NULL && terms != NULL;
+  *meanError = 0;
+  *maxError = 0;
+  for (int i = 0; measured && i < NUM_EVALUATIONS; i++) {
+    for (int j = 0; j < NUM_TERMS; j++) {
+      double value;
+      calcEvaluate(random, &value, NULL);
+      terms[j] = summationCase->exactTerm(value);
+    }
+    double result;
+    calcEvaluate(compiled, &result, NULL);
+    double error = errorInUlps(result, summationCase->exact(terms, NUM_TERMS));
+    *meanError += error / NUM_EVALUATIONS;
+    if (error > *maxError) {
+      *maxError = error;
+    }
+  }
+  calcFree(compiled);
+  calcFree(random);
+  free(terms);
+  return measured;
+}
+
+int main() {
+  bool passed = true;
+  for (int i = 0; i < NUM_CASES && passed; i++) {
+    const SummationCase *summationCase = &cases[i];
+    char *expression = buildExpression(summationCase);
+    if (expression == NULL) {
+      printf("Error: out of memory\n");
+      return 1;
+    }
+    printf("%s: '%s%s%s...', %d terms, %d evaluations\n", summationCase->name, summationCase->term,
+           summationCase->operator, summationCase->term, NUM_TERMS, NUM_EVALUATIONS);
+    for (int j = 0; j < NUM_CONFIGURATIONS; j++) {
+      const Configuration *configuration = &configurations[j];
+      double compileTime, unusedTime;
+      double bytecodeTime = timeEvaluation(expression, CALC_BACKEND_BYTECODE, configuration, &compileTime);
+      double machineCodeTime = timeEvaluation(expression, CALC_BACKEND_JIT, configuration, &unusedTime);
+      double meanError, maxError;
+      if (bytecodeTime < 0 || machineCodeTime < 0 ||
+          !measureError(summationCase, expression, configuration, &meanError, &maxError)) {
+        printf("Error: '%s%s...' couldn't be compiled\n", summationCase->term, summationCase->operator);
+        passed = false;
+        break;
+      }
+      printf("  %-11s  compile %7.2f ms, bytecode %8.1f us, machine code %8.1f us, error %9.3f ulp mean, "
+             "%9.3f ulp max\n", configuration->name, compileTime * 1e3, bytecodeTime * 1e6, machineCodeTime * 1e6,
+             meanError, maxError);
+    }
+    printf("\n");
+    free(expression);
+  }
+  return passed ? 0 : 1;
+}
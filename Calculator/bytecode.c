@@ -0,0 +1,289 @@
+// Justin Chen
+// Stack-machine bytecode compiled from syntax trees, and its interpreter
+// The interpreter dispatches with computed goto (a table of label addresses, indexed by the next
+// opcode) where the compiler supports it, which gives each instruction its own indirect branch
+// instead of sending them all through the one branch of a switch. Elsewhere it uses a switch.
+
+#include <math.h>     // Math library (pow(), fmod(), sqrt(), sin(), ...)
+#include "bytecode.h"
+#include "operations.h"  // Powers, factorials, conversions and random numbers (power(), factorial(), degtorad())
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTED_GOTO
+#endif
+
+// State of compiling a tree
+typedef struct Compiler {
+    const Ast *ast;
+    Bytecode *bytecode;
+    int depth;             // Number of values on the stack after the instructions so far
+} Compiler;
+
+// Appends an instruction, changing the depth of the stack by depthChange
+static void emit(Compiler *compiler, Opcode opcode, uint32_t position, int depthChange) {
+  Bytecode *bytecode = compiler->bytecode;
+  bytecode->code[bytecode->length] = (unsigned char) opcode;
+  bytecode->positions[bytecode->length] = position;
+  bytecode->length++;
+  compiler->depth += depthChange;
+  if (compiler->depth > bytecode->maxDepth) {
+    bytecode->maxDepth = compiler->depth;
+  }
+}
+
+// Appends an instruction that pushes a constant
+static void emitConstant(Compiler *compiler, double value, uint32_t position) {
+  compiler->bytecode->constants[compiler->bytecode->numConstants++] = value;
+  emit(compiler, OP_CONSTANT, position, 1);
+}
+
+// Appends an instruction that saves or loads a shared slot
+static void emitSlot(Compiler *compiler, Opcode opcode, int slot, uint32_t position) {
+  compiler->bytecode->slots[compiler->bytecode->numSlots++] = (uint32_t) slot;
+  emit(compiler, opcode, position, opcode == OP_LOAD ? 1 : 0);
+}
+
+// Returns the opcode of a binary operator or function
+static Opcode opcodeOf(Symbol type) {
+  switch (type) {
+    case ADD: return OP_ADD;
+    case MINUS: return OP_SUBTRACT;
+    case MULTIPLY: return OP_MULTIPLY;
+    case DIVIDE: return OP_DIVIDE;
+    case MODULO: return OP_MODULO;
+    case POWER: return OP_POWER;
+    case HYPOT: return OP_HYPOT;
+    case FUSED_MULTIPLY_ADD: return OP_FUSED_MULTIPLY_ADD;
+    case FUSED_MULTIPLY_SUBTRACT: return OP_FUSED_MULTIPLY_SUBTRACT;
+    case FUSED_ADD_MULTIPLY: return OP_FUSED_ADD_MULTIPLY;
+    case FUSED_SUBTRACT_MULTIPLY: return OP_FUSED_SUBTRACT_MULTIPLY;
+    case SUM: return OP_SUM;
+    case COMPENSATED_SUM: return OP_COMPENSATED_SUM;
+    case PRODUCT: return OP_PRODUCT;
+    case NEGATE: return OP_NEGATE;
+    case FACTORIAL: return OP_FACTORIAL;
+    case SQRT: return OP_SQRT;
+    case CBRT: return OP_CBRT;
+    case LOG: return OP_LOG;
+    case LN: return OP_LN;
+    case SIN: return OP_SIN;
+    case COS: return OP_COS;
+    case TAN: return OP_TAN;
+    case ASIN: return OP_ASIN;
+    case ACOS: return OP_ACOS;
+    case ATAN: return OP_ATAN;
+    case SINH: return OP_SINH;
+    case COSH: return OP_COSH;
+    case TANH: return OP_TANH;
+    case ASINH: return OP_ASINH;
+    case ACOSH: return OP_ACOSH;
+    case ATANH: return OP_ATANH;
+    case ABS: return OP_ABS;
+    case DEGTORAD: return OP_DEGTORAD;
+    case RADTODEG: return OP_RADTODEG;
+    case FLOOR: return OP_FLOOR;
+    case CEIL: return OP_CEIL;
+    case ROUND: return OP_ROUND;
+    case INV: return OP_INV;
+    case LOG1P: return OP_LOG1P;
+    case EXPM1: return OP_EXPM1;
+    default: return OP_EXP;
+  }
+}
+
+// Appends the instruction of a node (its operands' instructions have to be appended already)
+static void compileNode(Compiler *compiler, int index) {
+  const AstNode *node = &compiler->ast->nodes[index];
+  uint32_t position = compiler->ast->positions[index];
+  switch (node->type) {
+    case NUMBER:
+      emitConstant(compiler, compiler->ast->literals[node->left], position);
+      break;
+    case MATH_PI:
+      emitConstant(compiler, M_PI, position);
+      break;
+    case MATH_E:
+      emitConstant(compiler, M_E, position);
+      break;
+    case RAND_NUM:
+      emit(compiler, OP_RANDOM, position, 1);
+      break;
+    case STORE_SHARED:
+      emitSlot(compiler, OP_STORE, node->right, position);
+      break;
+    case LOAD_SHARED:
+      emitSlot(compiler, OP_LOAD, node->right, position);
+      break;
+    case INTEGER_POWER:
+      if (node->right == 2) { // x^2 is x * x (see integerPower())
+        emit(compiler, OP_SQUARE, position, 0);
+      } else {
+        compiler->bytecode->constants[compiler->bytecode->numConstants++] = node->right;
+        emit(compiler, OP_INTEGER_POWER, position, 0);
+      }
+      break;
+    case ROOT_POWER:
+      emit(compiler, node->right == 2 ? OP_SQRT_POWER : OP_CBRT_POWER, position, 0);
+      break;
+    case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER: case HYPOT:
+      emit(compiler, opcodeOf(node->type), position, -1);
+      break;
+    case OPERAND_PAIR: // Both values stay on the stack for the fused operation (or the sum)
+      break;
+    case FUSED_MULTIPLY_ADD: case FUSED_MULTIPLY_SUBTRACT: case FUSED_ADD_MULTIPLY: case FUSED_SUBTRACT_MULTIPLY:
+      emit(compiler, opcodeOf(node->type), position, -2);
+      break;
+    case SUM: case COMPENSATED_SUM: case PRODUCT:
+      compiler->bytecode->constants[compiler->bytecode->numConstants++] = node->right;
+      emit(compiler, opcodeOf(node->type), position, 1 - node->right);
+      break;
+    default: // Unary operators and functions
+      emit(compiler, opcodeOf(node->type), position, 0);
+      break;
+  }
+}
+
+bool compileBytecode(const Ast *ast, int root, Bytecode *bytecode, Arena *arena) {
+  // Each node produces at most one instruction (and at most one constant or slot), plus the OP_RETURN
+  bytecode->code = arenaAllocate(arena, ast->numNodes + 1);
+  bytecode->positions = arenaAllocate(arena, (ast->numNodes + 1) * sizeof(uint32_t));
+  bytecode->constants = arenaAllocate(arena, ast->numNodes * sizeof(double));
+  bytecode->slots = arenaAllocate(arena, ast->numNodes * sizeof(uint32_t));
+  int32_t *order = arenaAllocate(arena, ast->numNodes * sizeof(int32_t));
+  int32_t *work = arenaAllocate(arena, 2 * ast->numNodes * sizeof(int32_t));
+  bytecode->length = 0;
+  bytecode->numConstants = 0;
+  bytecode->numSlots = 0;
+  bytecode->maxDepth = 0;
+  if (bytecode->code == NULL || bytecode->positions == NULL || bytecode->constants == NULL ||
+      bytecode->slots == NULL || order == NULL || work == NULL) {
+    return false;
+  }
+
+  // Operands come before the operations that use them (left to right), which is the order the
+  // stack machine needs
+  Compiler compiler = {ast, bytecode, 0};
+  int numNodes = astPostOrder(ast, root, order, work);
+  for (int i = 0; i < numNodes; i++) {
+    compileNode(&compiler, order[i]);
+  }
+  emit(&compiler, OP_RETURN, ast->positions[root], -1);
+  return true;
+}
+
+double runBytecode(const Bytecode *bytecode, double *stack, const AstEvaluation *evaluation) {
+  const unsigned char *ip = bytecode->code;        // Next instruction
+  const double *constant = bytecode->constants;   // Next constant
+  const uint32_t *slot = bytecode->slots;         // Next shared slot
+  double *top = stack - 1;                         // Value on the top of the stack
+
+#ifdef COMPUTED_GOTO
+  static const void *labels[] = {
+      [OP_CONSTANT] = &&op_CONSTANT, [OP_RANDOM] = &&op_RANDOM,
+      [OP_STORE] = &&op_STORE, [OP_LOAD] = &&op_LOAD,
+      [OP_ADD] = &&op_ADD, [OP_SUBTRACT] = &&op_SUBTRACT, [OP_MULTIPLY] = &&op_MULTIPLY,
+      [OP_DIVIDE] = &&op_DIVIDE, [OP_MODULO] = &&op_MODULO, [OP_POWER] = &&op_POWER,
+      [OP_NEGATE] = &&op_NEGATE, [OP_FACTORIAL] = &&op_FACTORIAL,
+      [OP_SQUARE] = &&op_SQUARE, [OP_INTEGER_POWER] = &&op_INTEGER_POWER, [OP_SQRT_POWER] = &&op_SQRT_POWER, [OP_CBRT_POWER] = &&op_CBRT_POWER,
+      [OP_FUSED_MULTIPLY_ADD] = &&op_FUSED_MULTIPLY_ADD, [OP_FUSED_MULTIPLY_SUBTRACT] = &&op_FUSED_MULTIPLY_SUBTRACT,
+      [OP_FUSED_ADD_MULTIPLY] = &&op_FUSED_ADD_MULTIPLY, [OP_FUSED_SUBTRACT_MULTIPLY] = &&op_FUSED_SUBTRACT_MULTIPLY,
+      [OP_HYPOT] = &&op_HYPOT,
+      [OP_SUM] = &&op_SUM, [OP_COMPENSATED_SUM] = &&op_COMPENSATED_SUM, [OP_PRODUCT] = &&op_PRODUCT,
+      [OP_SQRT] = &&op_SQRT, [OP_CBRT] = &&op_CBRT, [OP_LOG] = &&op_LOG, [OP_LN] = &&op_LN,
+      [OP_SIN] = &&op_SIN, [OP_COS] = &&op_COS, [OP_TAN] = &&op_TAN,
+      [OP_ASIN] = &&op_ASIN, [OP_ACOS] = &&op_ACOS, [OP_ATAN] = &&op_ATAN,
+      [OP_SINH] = &&op_SINH, [OP_COSH] = &&op_COSH, [OP_TANH] = &&op_TANH,
+      [OP_ASINH] = &&op_ASINH, [OP_ACOSH] = &&op_ACOSH, [OP_ATANH] = &&op_ATANH,
+      [OP_ABS] = &&op_ABS, [OP_DEGTORAD] = &&op_DEGTORAD, [OP_RADTODEG] = &&op_RADTODEG,
+      [OP_FLOOR] = &&op_FLOOR, [OP_CEIL] = &&op_CEIL, [OP_ROUND] = &&op_ROUND,
+      [OP_INV] = &&op_INV, [OP_EXP] = &&op_EXP, [OP_LOG1P] = &&op_LOG1P, [OP_EXPM1] = &&op_EXPM1,
+      [OP_RETURN] = &&op_RETURN,
+  };
+#define CASE(opcode) op_##opcode:
+#define DISPATCH() goto *labels[*ip++]
+  DISPATCH();
+#else
+#define CASE(opcode) case OP_##opcode:
+#define DISPATCH() continue
+  for (;;) {
+    switch (*ip++) {
+#endif
+
+  // Values
+  CASE(CONSTANT) *++top = *constant++; DISPATCH();
+  CASE(RANDOM) *++top = randomNumber(evaluation->randomState); DISPATCH();
+  CASE(STORE) evaluation->shared[*slot++] = *top; DISPATCH();
+  CASE(LOAD) *++top = evaluation->shared[*slot++]; DISPATCH();
+
+  // Binary operators (the same operations as applyOperator())
+  CASE(ADD) top[-1] = top[-1] + top[0]; top--; DISPATCH();
+  CASE(SUBTRACT) top[-1] = top[-1] - top[0]; top--; DISPATCH();
+  CASE(MULTIPLY) top[-1] = top[-1] * top[0]; top--; DISPATCH();
+  CASE(DIVIDE) top[-1] = top[-1] / top[0]; top--; DISPATCH();
+  CASE(MODULO) top[-1] = fmod(top[-1], top[0]); top--; DISPATCH();
+  CASE(POWER) top[-1] = power(top[-1], top[0]); top--; DISPATCH();
+  CASE(HYPOT) top[-1] = hypot(top[-1], top[0]); top--; DISPATCH();
+
+  // Fused operations (the same operations as applyFused(), on x, y and z from the bottom up)
+  CASE(FUSED_MULTIPLY_ADD) top[-2] = fma(top[-2], top[-1], top[0]); top -= 2; DISPATCH();
+  CASE(FUSED_MULTIPLY_SUBTRACT) top[-2] = fma(top[-2], top[-1], -top[0]); top -= 2; DISPATCH();
+  CASE(FUSED_ADD_MULTIPLY) top[-2] = fma(top[-1], top[0], top[-2]); top -= 2; DISPATCH();
+  CASE(FUSED_SUBTRACT_MULTIPLY) top[-2] = fma(-top[-1], top[0], top[-2]); top -= 2; DISPATCH();
+
+  // Sums and products (the same operations as applyReduction(), on the terms from the bottom up)
+  CASE(SUM) top -= (int) *constant - 1; *top = sumTerms(top, (int) *constant++); DISPATCH();
+  CASE(COMPENSATED_SUM) top -= (int) *constant - 1; *top = compensatedSum(top, (int) *constant++); DISPATCH();
+  CASE(PRODUCT) top -= (int) *constant - 1; *top = multiplyTerms(top, (int) *constant++); DISPATCH();
+
+  // Unary operators
+  CASE(NEGATE) *top = -*top; DISPATCH();
+  CASE(SQUARE) *top = *top * *top; DISPATCH();
+  CASE(INTEGER_POWER) *top = integerPower(*top, (int) *constant++); DISPATCH();
+  CASE(SQRT_POWER) *top = rootPower(*top, 2); DISPATCH();
+  CASE(CBRT_POWER) *top = rootPower(*top, 3); DISPATCH();
+  CASE(FACTORIAL)
+    if (*top < 0) {
+      evaluation->domainError(evaluation->context, bytecode->positions[ip - 1 - bytecode->code]);
+      *top = 0;
+    } else {
+      *top = factorial(*top);
+    }
+    DISPATCH();
+
+  // Functions (the same operations as applyFunction())
+  CASE(SQRT) *top = sqrt(*top); DISPATCH();
+  CASE(CBRT) *top = cbrt(*top); DISPATCH();
+  CASE(LOG) *top = log10(*top); DISPATCH();
+  CASE(LN) *top = log(*top); DISPATCH();
+  CASE(SIN) *top = sin(degtorad(*top)); DISPATCH();
+  CASE(COS) *top = cos(degtorad(*top)); DISPATCH();
+  CASE(TAN) *top = tan(degtorad(*top)); DISPATCH();
+  CASE(ASIN) *top = radtodeg(asin(*top)); DISPATCH();
+  CASE(ACOS) *top = radtodeg(acos(*top)); DISPATCH();
+  CASE(ATAN) *top = radtodeg(atan(*top)); DISPATCH();
+  CASE(SINH) *top = radtodeg(sinh(degtorad(*top))); DISPATCH();
+  CASE(COSH) *top = radtodeg(cosh(degtorad(*top))); DISPATCH();
+  CASE(TANH) *top = radtodeg(tanh(degtorad(*top))); DISPATCH();
+  CASE(ASINH) *top = radtodeg(asinh(degtorad(*top))); DISPATCH();
+  CASE(ACOSH) *top = radtodeg(acosh(degtorad(*top))); DISPATCH();
+  CASE(ATANH) *top = radtodeg(atanh(degtorad(*top))); DISPATCH();
+  CASE(ABS) *top = fabs(*top); DISPATCH();
+  CASE(DEGTORAD) *top = degtorad(*top); DISPATCH();
+  CASE(RADTODEG) *top = radtodeg(*top); DISPATCH();
+  CASE(FLOOR) *top = floor(*top); DISPATCH();
+  CASE(CEIL) *top = ceil(*top); DISPATCH();
+  CASE(ROUND) *top = round(*top); DISPATCH();
+  CASE(INV) *top = 1.0 / *top; DISPATCH();
+  CASE(EXP) *top = exp(*top); DISPATCH();
+  CASE(LOG1P) *top = log1p(*top); DISPATCH();
+  CASE(EXPM1) *top = expm1(*top); DISPATCH();
+
+  CASE(RETURN) return *top;
+
+#ifndef COMPUTED_GOTO
+    }
+  }
+#endif
+#undef CASE
+#undef DISPATCH
+}
@@ -0,0 +1,59 @@
+// Justin Chen
+// Stack-machine bytecode compiled from syntax trees, and its interpreter
+
+#ifndef CALCULATOR_BYTECODE_H
+#define CALCULATOR_BYTECODE_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <stdint.h>   // Fixed-width integers (uint32_t)
+#include "ast.h"      // Syntax trees (Ast, AstEvaluation)
+#include "arena.h"    // Memory of the bytecode (Arena)
+
+// Define enumeration of instructions
+// Each instruction is one byte. Operands are taken from the top of the stack and the result is
+// pushed back on it.
+typedef enum Opcode {
+    OP_CONSTANT,                // Push the next constant (constants are used in order, so no index is needed)
+    OP_RANDOM,                  // Push a random number ('rand')
+    OP_STORE,                   // Save the top of the stack in the next shared slot (slots are also used in order)
+    OP_LOAD,                    // Push the value saved in the next shared slot
+    OP_ADD, OP_SUBTRACT,        // Binary operators: pop the right operand, then replace the left one
+    OP_MULTIPLY, OP_DIVIDE,
+    OP_MODULO, OP_POWER, OP_HYPOT,
+    OP_NEGATE, OP_FACTORIAL,    // Unary operators: replace the top of the stack
+    OP_SQUARE,                  // Square the top of the stack (an exponent of 2)
+    OP_INTEGER_POWER,           // Raise the top of the stack to the next constant (an integer exponent)
+    OP_SQRT_POWER, OP_CBRT_POWER, // Raise the top of the stack to 0.5 or 1/3 (see rootPower())
+    OP_FUSED_MULTIPLY_ADD,      // Fused operations: pop z and y, then replace x (see applyFused())
+    OP_FUSED_MULTIPLY_SUBTRACT, OP_FUSED_ADD_MULTIPLY, OP_FUSED_SUBTRACT_MULTIPLY,
+    OP_SUM, OP_COMPENSATED_SUM, OP_PRODUCT, // Replace the next constant's number of terms by their sum or product
+    OP_SQRT, OP_CBRT, OP_LOG, OP_LN,       // Functions: replace the top of the stack
+    OP_SIN, OP_COS, OP_TAN, OP_ASIN, OP_ACOS, OP_ATAN,
+    OP_SINH, OP_COSH, OP_TANH, OP_ASINH, OP_ACOSH, OP_ATANH,
+    OP_ABS, OP_DEGTORAD, OP_RADTODEG, OP_FLOOR, OP_CEIL, OP_ROUND, OP_INV, OP_EXP, OP_LOG1P, OP_EXPM1,
+    OP_RETURN                   // Return the top of the stack
+} Opcode;
+
+// Define struct Bytecode
+// A compiled expression for the stack machine. The arrays are allocated from an arena.
+typedef struct Bytecode {
+    unsigned char *code;   // Instructions (Opcode), ending with OP_RETURN
+    uint32_t *positions;   // Position of the token of each instruction (for error messages)
+    int length;            // Number of instructions
+    double *constants;     // Values pushed by OP_CONSTANT (and operands of OP_INTEGER_POWER and OP_SUM, ...), in order
+    int numConstants;
+    uint32_t *slots;       // Slots of AstEvaluation.shared used by OP_STORE and OP_LOAD, in order
+    int numSlots;
+    int maxDepth;          // Largest number of values on the stack at once
+} Bytecode;
+
+// Compiles the tree with its root at index into bytecode allocated from arena.
+// Returns false if out of memory.
+bool compileBytecode(const Ast *ast, int root, Bytecode *bytecode, Arena *arena);
+
+// Runs bytecode with a stack of at least bytecode->maxDepth values and returns the result.
+// The operations are done in the same order as evaluateAst() does them, so the results (and the
+// random numbers) are the same.
+double runBytecode(const Bytecode *bytecode, double *stack, const AstEvaluation *evaluation);
+
+#endif // CALCULATOR_BYTECODE_H
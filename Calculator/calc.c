@@ -0,0 +1,862 @@
+// Justin Chen
+// libcalc - tokenizer, validation and Pratt parser behind calc.h
+// An expression is tokenized and parsed once by calcCompile() into a syntax tree (see ast.h),
+// kept in the compiled expression's arena, and every calcEvaluate() only walks the tree.
+// Errors are recorded in the caller's CalcErrors instead of being printed.
+
+#include <stdio.h>    // I/O functions (snprintf(), vsnprintf())
+#include <stdarg.h>   // Variable arguments (va_list) for error messages
+#include <string.h>   // String functions (strlen(), memcpy(), memset())
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <ctype.h>    // Lowercase character function tolower()
+#include <stdint.h>   // Fixed-width integers (uint32_t, uint64_t, UINT32_MAX)
+#include "calc.h"
+#include "classify.h" // Character classification (classifyCharacters(), skipClass(), findUnmatchedParenthesis())
+#include "number.h"   // Numeric literal conversion (parseNumber())
+#include "symbol.h"   // Token types (Symbol)
+#include "identifiers.h" // Reserved identifiers (lookupIdentifier())
+#include "operations.h"  // Random numbers (RANDOM_SEED)
+#include "ast.h"      // Syntax trees (astAddNode(), evaluateAst())
+#include "fold.h"     // Constant folding (foldConstants())
+#include "simplify.h" // Equality saturation (simplifyExpression())
+#include "share.h"    // Common subexpression elimination (shareSubexpressions())
+#include "polynomial.h" // Horner's rule and Estrin's scheme (rewritePolynomials())
+#include "fuse.h"     // Fused operations (fuseOperations())
+#include "flatten.h"  // Flattening of sums and products (flattenChains())
+#include "powers.h"   // Strength reduction of powers (reducePowers())
+#include "bytecode.h" // Stack-machine bytecode (compileBytecode(), runBytecode())
+#include "registers.h" // Register-machine code (compileRegisters(), runRegisters())
+#include "jit.h"      // Native machine code (compileJit(), runJit(), releaseJit())
+#include "native.h"   // Shared objects built by the C compiler (compileNative(), runNative(), releaseNative())
+#include "stream.h"   // Streaming evaluation (streamEvaluate())
+#include "arena.h"    // Memory of a compiled expression (arenaAllocate(), arenaReserve(), arenaRelease())
+
+// Bytes of the arena that compiling an expression of a length usually takes (measured: fewer
+// than 1 in 5000 expressions need more, and they get another block)
+#define COMPILED_BYTES(length) (512 + 64 * (length))
+
+// Marks tokens that don't appear in the user expression (e.g., the '*' inserted in '2pi')
+#define NO_OFFSET UINT32_MAX
+
+// Define struct Span
+// The view of a token's value in the user expression: the offset of its first character
+// and its length. Only needed to print tokens (e.g., in error messages).
+typedef struct Span {
+    uint32_t offset;
+    uint32_t length;
+} Span;
+
+// Define struct TokenStream
+// Holds the tokens of an expression as parallel arrays (structure of arrays), so that the
+// parser only touches the arrays it needs: one byte per token for its type, plus the values
+// of number tokens, which are kept in their own array in the order the numbers appear
+// (the i-th NUMBER token's value is literals[i]). The spans are only read when printing.
+// Binding powers aren't stored, they are looked up in bindingPowers[] by type.
+// To add a token, call addToken(). To get the text of a token, call tokenText().
+typedef struct TokenStream {
+    unsigned char *types;  // Symbol of each token
+    Span *spans;           // Where each token is in the user expression
+    double *literals;      // Values of the number tokens, converted once during tokenization
+    int numLiterals;
+} TokenStream;
+
+// Define struct Evaluation
+// Holds all the state of compiling and evaluating an expression: the expression, its tokens,
+// the progress of the tokenizer and parser, and where errors go. Every stage takes the
+// Evaluation it works on, so several expressions can be evaluated at once (e.g., on different
+// threads), each with its own Evaluation. Nothing else is shared between evaluations.
+typedef struct Evaluation {
+    // Stores the user's expression (in lowercase, copied into the arena by calcCompile())
+    const char *expression;
+
+    // Stores the length of the expression being tokenized
+    // Computed once at the start of tokenize() instead of calling strlen() on each character.
+    int expLength;
+
+    // Memory for everything the compiled expression needs (its text, tokens, class masks and tree).
+    // It is released by calcFree().
+    Arena arena;
+
+    // Tokens of the user expression (the arrays are allocated from the arena by tokenize())
+    // Each character produces at most one token plus an implicit '*' token inserted in front of it,
+    // and one extra slot holds the END_OF_EXPRESSION sentinel appended by compactTokens().
+    TokenStream tokens;
+
+    // Stores the number of tokens in the token array (recorded by tokenize())
+    int numTokens;
+
+    // Character class bitmasks of the expression (one bit per character, see classify.h)
+    // Allocated from the arena and filled in by tokenize(), so that runs of digits, letters and
+    // whitespace can be skipped at once.
+    CharClasses charClasses;
+
+    // Stores the index of the start of a token
+    int start;
+
+    // Stores the index of the currently being parsed character
+    int current;
+
+    // Stores the index of the token that will be parsed
+    int parseCurrent;
+
+    // Stores the index (in tokens.literals) of the value of the next number token that will be parsed
+    int parseLiteral;
+
+    // Stores whether an error occurred
+    bool hadError;
+
+    // Stores which stage currently in when error occurred
+    // false - before tokenize stage or during parsing stage
+    // true - during tokenize stage
+    bool inTokenizeStage;
+
+    // Syntax tree built by the parser (the nodes are allocated from the arena by calcCompile())
+    // Each token produces at most one node.
+    Ast ast;
+
+    // Index of the root node of the syntax tree
+    int root;
+
+    // How calcEvaluate() evaluates the expression (never CALC_BACKEND_DEFAULT)
+    CalcBackend backend;
+
+    // Bytecode compiled from the syntax tree (for CALC_BACKEND_BYTECODE)
+    Bytecode bytecode;
+
+    // Register-machine code compiled from the syntax tree (for CALC_BACKEND_REGISTER)
+    RegisterProgram registers;
+
+    // Machine code compiled from the syntax tree (for CALC_BACKEND_JIT)
+    JitCode jit;
+
+    // Shared object built from the syntax tree (for CALC_BACKEND_NATIVE)
+    NativeCode native;
+
+    // Stack of values for evaluating, and the tree walker's stack of nodes left to visit
+    double *stack;
+    int32_t *work;
+
+    // Values of repeated subexpressions (see shareSubexpressions())
+    double *shared;
+
+    // Where errors are recorded (NULL if the caller doesn't want them)
+    CalcErrors *errors;
+
+    // State of the random number generator used by 'rand' (see randomNumber())
+    uint64_t randomState;
+} Evaluation;
+
+// Define struct Frame
+// An operator, function or '(' that is waiting for its right operand, together with the binding
+// power that operand is parsed at (the parser's explicit stack, see expression()).
+typedef struct Frame {
+    int32_t token;        // Index of the operator/function/'(' token
+    int32_t left;         // Left operand of binary operators
+    int32_t bindingPower; // Binding power the right operand is parsed at
+    bool binary;          // Whether the frame holds a left operand (binary operators)
+} Frame;
+
+// Returned by nud() and led() when they filled in a frame instead of building a node
+#define WAITING_FOR_OPERAND (-2)
+
+// Define struct CalcExpression
+// A compiled expression: the syntax tree built by calcCompile(), the tokens it refers to and
+// whatever the backend compiled it into.
+struct CalcExpression {
+    Evaluation ev;
+};
+
+// Function prototype declarations.
+// Errors
+static void error(Evaluation *ev, int index, const char *format, ...); // records a syntax error, sets hadError to true
+static void domainError(void *context, uint32_t position);      // records an operation that isn't defined for its operand
+static void addError(Evaluation *ev, CalcErrorType type, const char *str, long long position); // appends to ev->errors
+
+// Helper functions
+static int addToken(Evaluation *ev, uint32_t offset, uint32_t length, Symbol ty); // appends a token and returns its index
+static const char *tokenText(Evaluation *ev, int index);       // returns the text of a token in the user expression
+static long long tokenPosition(Evaluation *ev, int index);     // returns the index of the character a token starts at
+static void advance(Evaluation *ev);                           // advances to the next token, used during expression parsing
+static void omitToken(Evaluation *ev, int index);              // removes token at index + 1 from expression
+static void compactTokens(Evaluation *ev);                     // removes omitted tokens and appends an end sentinel
+
+// Validation functions
+static void checkParenthesesMatch(Evaluation *ev);   // checks if parentheses '()' match throughout expression
+static void checkExpressionValidity(Evaluation *ev); // checks if expression contains *only* valid characters
+
+// Tokenization functions - converts user expression to a list of tokens
+static void tokenize(Evaluation *ev);                   // tokenizes user expression
+static void tokenizeNumber(Evaluation *ev);             // tokenizes a number token
+static void tokenizeAlpha(Evaluation *ev);              // tokenizes an identifier for a constant/function
+static void tokenizeFunction(Evaluation *ev, int index); // tokenizes a function token
+static int findNumberOfTokens(Evaluation *ev);          // returns the number of tokens recorded by tokenize()
+
+// Pratt-parsing specific functions
+static int expression(Evaluation *ev);                          // parses the whole expression
+static int led(Evaluation *ev, int index, int left, Frame *frame); // left-denotation - parses binary expressions
+static int nud(Evaluation *ev, int index, Frame *frame);        // null-denotation - parses unary expressions
+static int applyFrame(Evaluation *ev, const Frame *frame, int operand); // builds the node a frame was waiting for
+
+CalcExpression *calcCompile(const char *text, CalcErrors *errors) {
+  return calcCompileWithOptions(text, NULL, errors);
+}
+
+CalcExpression *calcCompileWithOptions(const char *text, const CalcOptions *options, CalcErrors *errors) {
+  if (errors != NULL) {
+    errors->numErrors = 0;
+  }
+
+  CalcExpression *compiled = calloc(1, sizeof(CalcExpression));
+  if (compiled == NULL) {
+    Evaluation failed = {.errors = errors};
+    addError(&failed, CALC_MEMORY_ERROR, "Out of memory.", -1);
+    return NULL;
+  }
+  Evaluation *ev = &compiled->ev;
+  ev->errors = errors;
+  ev->randomState = RANDOM_SEED;
+
+  // Keep a lowercase copy of the expression, as identifiers are case-insensitive
+  // The arena starts with a block sized for the expression, so that small expressions (the
+  // usual case when many are compiled and kept) don't each hold a block of the default size.
+  size_t length = strlen(text);
+  char *lowercaseText = NULL;
+  if (!arenaReserve(&ev->arena, COMPILED_BYTES(length)) ||
+      (lowercaseText = arenaAllocate(&ev->arena, length + 1)) == NULL) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    calcFree(compiled);
+    return NULL;
+  }
+  for (size_t i = 0; i < length; i++) {
+    lowercaseText[i] = (char) tolower((unsigned char) text[i]);
+  }
+  lowercaseText[length] = '\0';
+  ev->expression = lowercaseText;
+
+  // Check if user expression has matching parentheses (e.g., parentheses are in pairs)
+  ev->inTokenizeStage = true;
+  checkParenthesesMatch(ev);
+
+  // If the expression doesn't have matching parentheses, don't tokenize it
+  if (!ev->hadError) {
+    // Tokenize the user's expression
+    tokenize(ev);
+
+    // Check tokens are valid
+    checkExpressionValidity(ev);
+  }
+
+  if (!ev->hadError) {
+    // Remove the tokens omitted during validation and terminate the token array,
+    // so that advance() only needs to move to the next slot.
+    compactTokens(ev);
+    ev->inTokenizeStage = false;
+
+    if (findNumberOfTokens(ev) == 0) {
+      error(ev, -1, "The expression is empty.");
+    } else {
+      // Parse the tokens into a syntax tree once, so that calcEvaluate() only needs to walk it
+      // (and can't fail because of a syntax error).
+      ev->ast.nodes = arenaAllocate(&ev->arena, findNumberOfTokens(ev) * sizeof(AstNode));
+      ev->ast.positions = arenaAllocate(&ev->arena, findNumberOfTokens(ev) * sizeof(uint32_t));
+      ev->ast.literals = ev->tokens.literals;
+      if (ev->ast.nodes == NULL || ev->ast.positions == NULL) {
+        addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+      } else {
+        ev->root = expression(ev);
+      }
+    }
+  }
+
+  // Optimize the tree
+  unsigned disabledPasses = options != NULL ? options->disabledPasses : 0;
+  if (!ev->hadError && !(disabledPasses & CALC_PASS_FOLD) &&
+      !foldConstants(&ev->ast, ev->tokens.numLiterals, &ev->arena)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && !(disabledPasses & CALC_PASS_SIMPLIFY) &&
+      !simplifyExpression(&ev->ast, &ev->root, options != NULL && options->fastMath, &ev->arena)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && !(disabledPasses & CALC_PASS_SHARE) && !shareSubexpressions(&ev->ast, &ev->root, &ev->arena)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && options != NULL && options->fastMath && !(disabledPasses & CALC_PASS_POLYNOMIALS) &&
+      !rewritePolynomials(&ev->ast, &ev->root, &ev->arena)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && options != NULL && options->fastMath && !(disabledPasses & CALC_PASS_FUSE) &&
+      !fuseOperations(&ev->ast, ev->root)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && options != NULL && (options->fastMath || options->compensatedSums) &&
+      !(disabledPasses & CALC_PASS_FLATTEN) &&
+      !flattenChains(&ev->ast, &ev->root, options->fastMath, options->compensatedSums, &ev->arena)) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+  if (!ev->hadError && !(disabledPasses & CALC_PASS_POWERS)) {
+    reducePowers(&ev->ast);
+  }
+  if (!ev->hadError && (ev->shared = arenaAllocate(&ev->arena, ev->ast.numShared * sizeof(double))) == NULL) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+  }
+
+  // Compile the tree for the backend that will evaluate it
+  ev->backend = options != NULL ? options->backend : CALC_BACKEND_DEFAULT;
+  if (ev->backend == CALC_BACKEND_DEFAULT) {
+    ev->backend = CALC_BACKEND_BYTECODE;
+  }
+  if (!ev->hadError && ev->backend == CALC_BACKEND_JIT && !compileJit(&ev->ast, ev->root, &ev->jit, &ev->arena)) {
+    ev->backend = CALC_BACKEND_BYTECODE; // Not supported here (or out of memory), so fall back to the interpreter
+  }
+  if (!ev->hadError && ev->backend == CALC_BACKEND_NATIVE &&
+      !compileNative(&ev->ast, ev->root, ev->expression, options, &ev->native, &ev->arena)) {
+    ev->backend = CALC_BACKEND_BYTECODE; // No compiler or dlopen() here, so fall back to the interpreter
+  }
+  if (!ev->hadError && ev->backend == CALC_BACKEND_BYTECODE) {
+    if (!compileBytecode(&ev->ast, ev->root, &ev->bytecode, &ev->arena) ||
+        (ev->stack = arenaAllocate(&ev->arena, ev->bytecode.maxDepth * sizeof(double))) == NULL) {
+      addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    }
+  } else if (!ev->hadError && ev->backend == CALC_BACKEND_REGISTER) {
+    if (!compileRegisters(&ev->ast, ev->root, &ev->registers, &ev->arena)) {
+      addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    }
+  } else if (!ev->hadError && ev->backend == CALC_BACKEND_TREE) { // The tree walker's stacks
+    ev->work = arenaAllocate(&ev->arena, 2 * ev->ast.numNodes * sizeof(int32_t));
+    ev->stack = arenaAllocate(&ev->arena, ev->ast.numNodes * sizeof(double));
+    if (ev->work == NULL || ev->stack == NULL) {
+      addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    }
+  }
+
+  ev->errors = NULL;
+  if (ev->hadError) {
+    calcFree(compiled);
+    return NULL;
+  }
+  return compiled;
+}
+
+bool calcEvaluate(CalcExpression *compiled, double *result, CalcErrors *errors) {
+  if (errors != NULL) {
+    errors->numErrors = 0;
+  }
+
+  Evaluation *ev = &compiled->ev;
+  ev->errors = errors;
+  ev->hadError = false;
+
+  AstEvaluation evaluation = {ev->work, ev->stack, ev->shared, &ev->randomState, domainError, ev};
+  switch (ev->backend) {
+    case CALC_BACKEND_BYTECODE: // Run the bytecode
+      *result = runBytecode(&ev->bytecode, ev->stack, &evaluation);
+      break;
+    case CALC_BACKEND_REGISTER: // Run the register-machine code
+      *result = runRegisters(&ev->registers, &evaluation);
+      break;
+    case CALC_BACKEND_JIT: // Call the machine code
+      *result = runJit(&ev->jit, &evaluation);
+      break;
+    case CALC_BACKEND_NATIVE: // Call the shared object's function
+      *result = runNative(&ev->native, &evaluation);
+      break;
+    default: // Walk the syntax tree from its root
+      *result = evaluateAst(&ev->ast, ev->root, &evaluation);
+      break;
+  }
+
+  ev->errors = NULL;
+  return !ev->hadError;
+}
+
+void calcSetSeed(CalcExpression *compiled, unsigned long long seed) {
+  compiled->ev.randomState = RANDOM_SEED + seed;
+}
+
+void calcFree(CalcExpression *compiled) {
+  if (compiled != NULL) {
+    releaseJit(&compiled->ev.jit);
+    releaseNative(&compiled->ev.native);
+    arenaRelease(&compiled->ev.arena);
+    free(compiled);
+  }
+}
+
+size_t calcMemoryUsage(const CalcExpression *compiled) {
+  size_t codeSize = compiled->ev.jit.code != NULL ? compiled->ev.jit.size : 0;
+  return sizeof(CalcExpression) + arenaCapacity(&compiled->ev.arena) + codeSize;
+}
+
+bool calcEvaluateStream(int fd, double *result, CalcErrors *errors) {
+  if (errors != NULL) {
+    errors->numErrors = 0;
+  }
+
+  StreamResult stream;
+  streamEvaluate(fd, &stream);
+  if (stream.hadError) {
+    if (errors != NULL) {
+      errors->numErrors = 1;
+      errors->errors[0].type = stream.errorType;
+      errors->errors[0].position = stream.offset;
+      snprintf(errors->errors[0].message, sizeof(errors->errors[0].message), "%s", stream.message);
+    }
+    return false;
+  }
+
+  *result = stream.value;
+  return true;
+}
+
+// Records a syntax error (formatted like printf()) and sets the hadError flag on.
+// index is a character index during the tokenize stage and a token index during parsing
+// (the error is about the token before it), or -1 if it isn't about a particular place.
+// Note that the message is formatted here rather than by the callers, so that the parsing
+// functions don't need room for it in their stack frames.
+static void error(Evaluation *ev, int index, const char *format, ...) {
+  char message[sizeof(((CalcError *) NULL)->message)];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(message, sizeof(message), format, arguments);
+  va_end(arguments);
+
+  long long position = -1;
+  if (index >= 0) {
+    position = ev->inTokenizeStage ? index : tokenPosition(ev, index - 1);
+  }
+  addError(ev, CALC_SYNTAX_ERROR, message, position);
+}
+
+// Records an operation that isn't defined for its operand (see AstEvaluation)
+static void domainError(void *context, uint32_t position) {
+  // Factorials are the only operations that fail
+  addError(context, CALC_DOMAIN_ERROR, "Factorial is only defined for non-negative numbers.", position);
+}
+
+// Appends an error to the caller's CalcErrors (only the first CALC_MAX_ERRORS are kept)
+static void addError(Evaluation *ev, CalcErrorType type, const char *str, long long position) {
+  ev->hadError = true;
+  if (ev->errors == NULL) {
+    return;
+  }
+  if (ev->errors->numErrors < CALC_MAX_ERRORS) {
+    CalcError *error = &ev->errors->errors[ev->errors->numErrors];
+    error->type = type;
+    error->position = position;
+    snprintf(error->message, sizeof(error->message), "%s", str);
+  }
+  ev->errors->numErrors++;
+}
+
+// Returns the index of the character in the user expression that a token starts at
+// Tokens inserted by the tokenizer (e.g., the '*' in '2pi') aren't in it, so the start of the
+// next token that is (or the end of the expression) is used instead.
+static long long tokenPosition(Evaluation *ev, int index) {
+  if (index < 0) {
+    index = 0;
+  }
+  for (; index < findNumberOfTokens(ev); index++) {
+    if (ev->tokens.spans[index].offset != NO_OFFSET) {
+      return ev->tokens.spans[index].offset;
+    }
+  }
+  return ev->expLength;
+}
+
+// Appends a token to the token stream and returns its index
+// offset and length describe where the token's text is in the user expression
+// (offset is NO_OFFSET for tokens that aren't in it).
+// Note that the value of a number token is added to tokens.literals separately.
+static int addToken(Evaluation *ev, uint32_t offset, uint32_t length, Symbol ty) {
+  ev->tokens.types[ev->numTokens] = (unsigned char) ty;
+  ev->tokens.spans[ev->numTokens].offset = offset;
+  ev->tokens.spans[ev->numTokens].length = length;
+  return ev->numTokens++;
+}
+
+// Returns a pointer to the first character of a token in the user expression
+// Note that the text isn't null-terminated, so only the first tokens.spans[index].length characters
+// belong to the token. Tokens inserted by the tokenizer don't appear in the user expression,
+// so their text is taken from their type instead.
+static const char *tokenText(Evaluation *ev, int index) {
+  if (ev->tokens.spans[index].offset != NO_OFFSET) {
+    return ev->expression + ev->tokens.spans[index].offset;
+  }
+  return ev->tokens.types[index] == MULTIPLY ? "*" : "";
+}
+
+// Fills in a frame that waits for the right operand of a token, parsed at a binding power
+static int waitForOperand(Frame *frame, int index, bool binary, int left, int bindingPower) {
+  frame->token = index;
+  frame->left = left;
+  frame->bindingPower = bindingPower;
+  frame->binary = binary;
+  return WAITING_FOR_OPERAND;
+}
+
+// Left denotation - builds binary expressions
+// Returns the index of the node in ev->ast (or NO_NODE if there is a syntax error), or
+// WAITING_FOR_OPERAND if the operator needs a right operand, which is described by *frame.
+static int led(Evaluation *ev, int index, int left, Frame *frame) {
+  // When expression() calls this, note that it will have already
+  // consumed the left operand and operator.
+  Symbol type = ev->tokens.types[index];
+  uint32_t position = (uint32_t) tokenPosition(ev, index);
+  switch (type) { // Check the type of the operator
+    case ADD: // Addition
+    case MINUS: // Subtraction
+      return waitForOperand(frame, index, true, left, 10);
+    case MULTIPLY: // Multiplication
+    case DIVIDE: // Division
+    case MODULO: // Modulo
+      return waitForOperand(frame, index, true, left, 20);
+    case POWER: // Exponentiation
+      // Note how the binding power is 30 - 1 not 30.
+      // This is because exponents are right-associative, so exponents on the rightmost
+      // need to be evaluated first (thus having higher precedence than binding power 29)
+      return waitForOperand(frame, index, true, left, 30 - 1);
+    case FACTORIAL: // Factorials (whether the operand is negative is checked by evaluateAst())
+      return astAddNode(&ev->ast, FACTORIAL, left, NO_NODE, position);
+    default: // This should never happen, but if it does, handle the error.
+      error(ev, ev->parseCurrent, "Unable to parse expression.");
+      return NO_NODE;
+  }
+}
+
+// Null denotation - builds unary expressions
+// Returns the index of the node in ev->ast (or NO_NODE if there is a syntax error), or
+// WAITING_FOR_OPERAND if the token needs an operand after it, which is described by *frame.
+static int nud(Evaluation *ev, int index, Frame *frame) {
+  Symbol type = ev->tokens.types[index];
+  uint32_t position = (uint32_t) tokenPosition(ev, index);
+  switch (type) { // Check the type of the token
+    case NUMBER: // if it is a number, refer to the value converted during tokenization
+      // Numbers are parsed in the order they appear, so this is the next literal
+      return astAddNode(&ev->ast, NUMBER, ev->parseLiteral++, NO_NODE, position);
+    case MATH_PI: // π
+    case MATH_E:  // exp
+    case RAND_NUM: // random number (drawn when evaluated)
+      return astAddNode(&ev->ast, type, NO_NODE, NO_NODE, position);
+    case MINUS: // Negation
+      // Note that negation has higher precedence than subtraction, and therefore
+      // the binding power is higher.
+      return waitForOperand(frame, index, false, NO_NODE, 25);
+    case START_BRACKET: // Parse expressions in parentheses (they don't need a node of their own)
+      return waitForOperand(frame, index, false, NO_NODE, 0);
+    case END_BRACKET: // Handles expression '()'
+      error(ev, ev->parseCurrent, "Parsed unexpected ')' token.");
+    case SQRT: case CBRT: case LOG: case LN: // Functions take the operand after them
+    case SIN: case COS: case TAN: case ASIN: case ACOS: case ATAN:
+    case SINH: case COSH: case TANH: case ASINH: case ACOSH: case ATANH:
+    case ABS: case FLOOR: case CEIL: case ROUND:
+    case DEGTORAD: case RADTODEG: case INV: case EXP:
+      return waitForOperand(frame, index, false, NO_NODE, 40);
+    default: { // Only happens in invalid (syntax-wise) expressions
+      error(ev, ev->parseCurrent, "Unexpected token '%.*s'.", (int) ev->tokens.spans[index].length, tokenText(ev, index));
+      return NO_NODE;
+    }
+  }
+}
+
+// Builds the node of a frame from its right operand
+// Returns the index of the node in ev->ast (or the operand itself for '(').
+static int applyFrame(Evaluation *ev, const Frame *frame, int operand) {
+  Symbol type = ev->tokens.types[frame->token];
+  uint32_t position = (uint32_t) tokenPosition(ev, frame->token);
+  if (type == START_BRACKET) {
+    if (ev->tokens.types[ev->parseCurrent] != END_BRACKET) {
+      error(ev, ev->parseCurrent, "Expected ending bracket ')'.");
+    }
+    advance(ev); // consume the ')' ending parentheses
+    return operand; // return the expression in the parentheses
+  }
+  if (frame->binary) {
+    return astAddNode(&ev->ast, type, frame->left, operand, position);
+  }
+  return astAddNode(&ev->ast, type == MINUS ? NEGATE : type, operand, NO_NODE, position);
+}
+
+// Move on to the next token
+// Note that the token array is terminated by an END_OF_EXPRESSION sentinel (see compactTokens()),
+// so once the end is reached, parseCurrent stays on the sentinel.
+static void advance(Evaluation *ev) {
+  if (ev->tokens.types[ev->parseCurrent] != END_OF_EXPRESSION) {
+    ev->parseCurrent++;
+  }
+}
+
+// Parse user expression into nodes of ev->ast
+// Algorithm detailed in DF document. The recursion of the usual Pratt parser (each operator,
+// function and '(' parsing its operand with a call of expression() at the operand's binding
+// power) is replaced by an explicit stack of frames, so that the depth of nesting is only
+// limited by memory: a frame is pushed where expression() would have been called, and applied
+// where that call would have returned, i.e. once the next token's binding power is no larger
+// than the frame's. Every frame consumes a token, so the stack never holds more frames than
+// there are tokens, and it is allocated once for that many.
+// Returns the index of the root node (or NO_NODE if there is a syntax error).
+static int expression(Evaluation *ev) {
+  Frame *frames = malloc(findNumberOfTokens(ev) * sizeof(Frame));
+  if (frames == NULL) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    return NO_NODE;
+  }
+  int numFrames = 0;
+
+  while (true) {
+    // Consume an operand, and parse it as a unary expression
+    int t = ev->parseCurrent;
+    advance(ev);
+    int left = nud(ev, t, &frames[numFrames]);
+    if (left == WAITING_FOR_OPERAND) {
+      numFrames++;
+      continue;
+    }
+
+    // Throw exception for input like '1 1'
+    if (ev->tokens.types[t] == NUMBER && ev->tokens.types[ev->parseCurrent] == NUMBER) {
+      error(ev, ev->parseCurrent, "Not expecting a number after a number (with no valid operator in between).");
+    }
+
+    // If the binding power currently is smaller than the binding power of the next token, parse
+    // a binary expression; otherwise, the operand of the frame on top of the stack is complete.
+    while (left != WAITING_FOR_OPERAND) {
+      int bindingPower = numFrames > 0 ? frames[numFrames - 1].bindingPower : 0;
+      if (bindingPower < bindingPowers[ev->tokens.types[ev->parseCurrent]]) {
+        // Consume tokens
+        t = ev->parseCurrent;
+        advance(ev);
+
+        // Parse binary expression
+        left = led(ev, t, left, &frames[numFrames]);
+        if (left == WAITING_FOR_OPERAND) {
+          numFrames++;
+        }
+      } else if (numFrames > 0) {
+        numFrames--;
+        left = applyFrame(ev, &frames[numFrames], left);
+      } else {
+        // Return the node of the whole expression
+        free(frames);
+        return left;
+      }
+    }
+  }
+}
+
+// Tokenize a string expression into an array of tokens
+// The expression is scanned exactly once; implicit '*' tokens are inserted as we go and
+// the final number of tokens is recorded in numTokens.
+static void tokenize(Evaluation *ev) {
+  const char *exp = ev->expression;
+  ev->numTokens = 0;
+  ev->start = 0;
+  ev->current = 0;
+  ev->expLength = (int) strlen(exp);
+
+  // Allocate the token array and class masks for an expression of this length
+  ev->tokens.types = arenaAllocate(&ev->arena, 2 * ev->expLength + 1);
+  ev->tokens.spans = arenaAllocate(&ev->arena, (2 * ev->expLength + 1) * sizeof(Span));
+  ev->tokens.literals = arenaAllocate(&ev->arena, ev->expLength * sizeof(double));
+  ev->tokens.numLiterals = 0;
+  uint64_t *masks = arenaAllocate(&ev->arena, 4 * MASK_WORDS(ev->expLength) * sizeof(uint64_t));
+  if (ev->tokens.types == NULL || ev->tokens.spans == NULL || ev->tokens.literals == NULL || masks == NULL) {
+    addError(ev, CALC_MEMORY_ERROR, "Expression is too long (out of memory).", -1);
+    return;
+  }
+  ev->charClasses.digits = masks;
+  ev->charClasses.letters = masks + MASK_WORDS(ev->expLength);
+  ev->charClasses.operators = masks + 2 * MASK_WORDS(ev->expLength);
+  ev->charClasses.spaces = masks + 3 * MASK_WORDS(ev->expLength);
+
+  // Find the class of every character up front (16-32 characters at a time)
+  classifyCharacters(exp, ev->expLength, ev->charClasses);
+
+  // Go through entire expression token by token
+  while (ev->current < ev->expLength) {
+    char c = exp[ev->current];
+
+    // Type of the previous token (implicit '*' tokens are inserted depending on it)
+    Symbol previous = ev->numTokens > 0 ? ev->tokens.types[ev->numTokens - 1] : END_OF_EXPRESSION;
+
+    if (inClass(ev->charClasses.digits, ev->current)) { // Consume number if program reads a digit
+      if (previous == END_BRACKET || previous == FACTORIAL || previous == IDENTIFIER) { // If we have a number after ')'
+        addToken(ev, NO_OFFSET, 1, MULTIPLY);
+      }
+
+      tokenizeNumber(ev);
+      addToken(ev, ev->start, ev->current + 1 - ev->start, NUMBER);
+      ev->tokens.literals[ev->tokens.numLiterals++] = parseNumber(exp + ev->start, ev->current + 1 - ev->start);
+      ev->current++;
+      ev->start = ev->current;
+      continue; // Continue onwards to the next iteration
+    } else if (inClass(ev->charClasses.letters, ev->current)) {
+      if (previous == END_BRACKET || previous == FACTORIAL || previous == NUMBER || previous == IDENTIFIER) {
+        addToken(ev, NO_OFFSET, 1, MULTIPLY);
+      }
+
+      tokenizeAlpha(ev);
+      addToken(ev, ev->start, ev->current + 1 - ev->start, IDENTIFIER);
+      ev->current++;
+      ev->start = ev->current;
+      continue; // Continue onwards to the next iteration
+    }
+
+    // Check character type if it is not a number
+    switch (c) {
+      case ' ':  // spaces are ignored
+      case '\t': // tabs are ignored
+        // Skip the whole run of whitespace
+        ev->current = skipClass(ev->charClasses.spaces, ev->current, ev->expLength) - 1;
+        break;
+      case '(': // consume '(' as start parentheses
+        // If we have a number before '('
+        // Or we have a factorial term before '(' (e.g., '5!(4)'), or we have ')'
+        if (previous == NUMBER || previous == FACTORIAL || previous == IDENTIFIER || previous == END_BRACKET) {
+          addToken(ev, NO_OFFSET, 1, MULTIPLY);
+        }
+        addToken(ev, ev->current, 1, START_BRACKET);
+        break;
+      case ')': // consume ')' as end parentheses
+        addToken(ev, ev->current, 1, END_BRACKET);
+        break;
+      case '+': // '+' - addition
+        addToken(ev, ev->current, 1, ADD);
+        break;
+      case '-': // '-' - subtraction/negation
+        addToken(ev, ev->current, 1, MINUS);
+        break;
+      case '*': // '*' - multiplication
+        addToken(ev, ev->current, 1, MULTIPLY);
+        break;
+      case '/': // '/' - division
+        addToken(ev, ev->current, 1, DIVIDE);
+        break;
+      case '%': // '%' - modulo
+        addToken(ev, ev->current, 1, MODULO);
+        break;
+      case '^': // '^' - exponentiation
+        addToken(ev, ev->current, 1, POWER);
+        break;
+      case '!': // '!' - factorial
+        addToken(ev, ev->current, 1, FACTORIAL);
+        break;
+      case '.': // '.' - unexpected as we handle '.' in numbers in the tokenizeNumber() function
+        error(ev, -1, "Error: Unexpected '.', please have digits before '.' (e.g., 0.1 instead of .1)");
+        error(ev, ev->current, "       Also, numbers can only have one '.' (e.g., no 1.1.1)");
+        break;
+      default: {
+        // Unknown characters are reported (shouldn't happen as it
+        // happens already in checkExpressionValidity())
+        error(ev, ev->current, "Error: Unknown character: '%c'", c);
+        break;
+      }
+    }
+    ev->current++;
+    ev->start = ev->current; // end of token, the start of the next token must be the next character
+  }
+}
+
+// Returns the number of tokens in the user's expression
+// Note that the count is a by-product of tokenize(), so this must be called after tokenizing.
+static int findNumberOfTokens(Evaluation *ev) {
+  return ev->numTokens;
+}
+
+// Tokenize a function/constant identifier
+static void tokenizeAlpha(Evaluation *ev) {
+  // Consume alphabetical characters
+  // Stop at the last letter before the end of the expression or a character that isn't alphabetical
+  ev->current = skipClass(ev->charClasses.letters, ev->current + 1, ev->expLength) - 1;
+
+  // Note that no token is created here, it is created back in the function tokenize().
+}
+
+// Tokenize a number
+static void tokenizeNumber(Evaluation *ev) {
+  // Consume numeric part
+  // Stop at the last digit before the end of the expression or a character that isn't numeric
+  ev->current = skipClass(ev->charClasses.digits, ev->current + 1, ev->expLength) - 1;
+
+  // If the next character is '.', expect to see more numbers afterwards
+  if (ev->current + 1 < ev->expLength && ev->expression[ev->current + 1] == '.') {
+    ev->current++; // consume the '.'
+    // Consume numbers afterwards
+    ev->current = skipClass(ev->charClasses.digits, ev->current + 1, ev->expLength) - 1;
+  }
+  // Note that no token is created here, it is created back in the function tokenize().
+}
+
+// Validates that parentheses are matching in the expression
+static void checkParenthesesMatch(Evaluation *ev) {
+  // Find the first parenthesis without a partner in a single pass over the expression
+  int unmatched = findUnmatchedParenthesis(ev->expression, (int) strlen(ev->expression));
+
+  // If there is one, then the parentheses are unmatched, an error is thrown
+  // pointing at that parenthesis.
+  if (unmatched >= 0) {
+    error(ev, unmatched, "Unmatched parentheses.");
+  }
+}
+
+// Check if the expression contains only valid characters
+static void checkExpressionValidity(Evaluation *ev) {
+  for (int index = 0; index < findNumberOfTokens(ev); index++) {
+    // Iterate through all the tokens and check if all identifiers are valid
+    // Interpret the values of the identifiers and replace their token types
+    switch (ev->tokens.types[index]) {
+      case IDENTIFIER: // Matches an identifier
+        tokenizeFunction(ev, index);
+        break;
+      default: {
+        break;
+      }
+    }
+  }
+}
+
+static void tokenizeFunction(Evaluation *ev, int index) {
+  int length = (int) ev->tokens.spans[index].length;
+  const Identifier *identifier = lookupIdentifier(tokenText(ev, index), length);
+
+  if (identifier == NULL) { // Some random word that isn't a reserved identifier
+    ev->hadError = true;
+
+    ev->inTokenizeStage = false;
+    error(ev, index + 1, "Unexpected identifier '%.*s'.", length, tokenText(ev, index));
+    omitToken(ev, index + 1);
+    return;
+  }
+
+  // Replace the identifier with a constant/function token
+  ev->tokens.types[index] = identifier->type;
+
+  // Functions take the operand after them, so remove the '*' inserted in between (e.g., 'sin(30)')
+  if (identifier->isFunction) {
+    omitToken(ev, index + 1);
+  }
+}
+
+static void omitToken(Evaluation *ev, int index) {
+  if (index < ev->numTokens && ev->tokens.types[index] == MULTIPLY) {
+    ev->tokens.types[index] = PASS_TOKEN;
+    ev->tokens.spans[index].offset = NO_OFFSET;
+    ev->tokens.spans[index].length = 0;
+  }
+}
+
+// Removes the PASS_TOKEN entries left behind by omitToken() by shifting the remaining
+// tokens down, then appends an END_OF_EXPRESSION token after the last one.
+static void compactTokens(Evaluation *ev) {
+  int kept = 0;
+  for (int index = 0; index < ev->numTokens; index++) {
+    if (ev->tokens.types[index] != PASS_TOKEN) {
+      ev->tokens.types[kept] = ev->tokens.types[index];
+      ev->tokens.spans[kept] = ev->tokens.spans[index];
+      kept++;
+    }
+  }
+  ev->numTokens = kept;
+  addToken(ev, NO_OFFSET, 0, END_OF_EXPRESSION);
+  ev->numTokens--; // The sentinel isn't counted
+}
@@ -0,0 +1,126 @@
+// Justin Chen
+// libcalc - public interface of the calculator library
+// An expression is compiled once with calcCompile() (tokenized and parsed into a syntax tree)
+// and can then be evaluated any number of times with calcEvaluate(), which only walks the tree. Errors are reported as CalcErrors
+// (a message and the position in the expression it is about) instead of being printed.
+//
+// Example:
+//   CalcErrors errors;
+//   CalcExpression *expression = calcCompile("2sin(30) + 1", &errors);
+//   double result;
+//   if (expression != NULL && calcEvaluate(expression, &result, &errors)) {
+//     printf("%g\n", result);
+//   }
+//   calcFree(expression);
+
+#ifndef CALCULATOR_CALC_H
+#define CALCULATOR_CALC_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <stddef.h>   // Sizes (size_t)
+
+// Maximum number of errors kept for one expression (the rest are only counted)
+#define CALC_MAX_ERRORS 5
+
+// Define enumeration of kinds of errors
+typedef enum CalcErrorType {
+    CALC_SYNTAX_ERROR,   // The expression isn't valid (found by calcCompile())
+    CALC_DOMAIN_ERROR,   // An operation isn't defined for its operand, e.g., '(-1)!' (found by calcEvaluate())
+    CALC_MEMORY_ERROR,   // Out of memory
+    CALC_INPUT_ERROR     // The expression couldn't be read (calcEvaluateStream())
+} CalcErrorType;
+
+// Define struct CalcError
+// An error found in an expression
+typedef struct CalcError {
+    CalcErrorType type;
+    long long position;  // Index of the character of the expression the error is about (-1 if none)
+    char message[256];
+} CalcError;
+
+// Define struct CalcErrors
+// The errors found by one call. Only the first CALC_MAX_ERRORS are kept, but all are counted.
+typedef struct CalcErrors {
+    int numErrors;
+    CalcError errors[CALC_MAX_ERRORS];
+} CalcErrors;
+
+// Define enumeration of ways to evaluate a compiled expression
+// They all give the same results.
+typedef enum CalcBackend {
+    CALC_BACKEND_DEFAULT,   // The fastest one available
+    CALC_BACKEND_TREE,      // Walk the syntax tree
+    CALC_BACKEND_BYTECODE,  // Run stack-machine bytecode compiled from the syntax tree
+    CALC_BACKEND_REGISTER,  // Run register-machine code (with superinstructions) compiled from the syntax tree
+    CALC_BACKEND_JIT,       // Call x86-64 machine code compiled from the syntax tree (elsewhere, the bytecode is used)
+    CALC_BACKEND_NATIVE     // Call C code compiled by the system C compiler into a cached shared object
+                            // (see CalcOptions.cacheDirectory; the bytecode is used if it can't be built)
+} CalcBackend;
+
+// Define enumeration of optimization passes run on compiled expressions
+// They are all run unless disabled in CalcOptions.disabledPasses (e.g., to measure a backend on
+// its own). None of them change the results (unless CalcOptions.fastMath or compensatedSums is set).
+typedef enum CalcPass {
+    CALC_PASS_FOLD = 1 << 0,  // Compute the parts of the expression that don't depend on 'rand' once
+    CALC_PASS_SHARE = 1 << 1, // Evaluate repeated subexpressions once per evaluation
+    CALC_PASS_POWERS = 1 << 2,  // Compile powers with constant exponents into multiplications and roots
+    CALC_PASS_SIMPLIFY = 1 << 3, // Rewrite the expression into its cheapest equivalent form (see fastMath)
+    CALC_PASS_FUSE = 1 << 4,    // Use fma(), log1p(), expm1() and hypot() where they fit (only with fastMath)
+    CALC_PASS_FLATTEN = 1 << 5, // Add (or multiply) long chains of terms all at once (only with fastMath or compensatedSums)
+    CALC_PASS_POLYNOMIALS = 1 << 6 // Evaluate polynomials with Horner's rule or Estrin's scheme (only with fastMath)
+} CalcPass;
+
+// Define struct CalcOptions
+// How to compile an expression (a zero-initialized CalcOptions gives the defaults)
+typedef struct CalcOptions {
+    CalcBackend backend;
+    unsigned disabledPasses;  // CalcPass flags of the optimization passes that aren't run
+    // Where CALC_BACKEND_NATIVE keeps the shared objects it builds, named after a hash of the
+    // expression (NULL for $XDG_CACHE_HOME/libcalc or ~/.cache/libcalc)
+    const char *cacheDirectory;
+    // Whether optimizations may change results in the last bits or for special values (NaN, ±∞
+    // and -0), e.g., 'ln(exp(x))' becomes 'x', sums and products are reassociated and 'x * y + z'
+    // is rounded once (see CALC_PASS_FUSE)
+    bool fastMath;
+    // Whether long sums (e.g., 'a + b + c + ...') are added with compensated summation, whose error
+    // doesn't grow with the number of terms, instead of in order (or pairwise, with fastMath).
+    // It is slower, and changes results in the last bits (see CALC_PASS_FLATTEN).
+    bool compensatedSums;
+} CalcOptions;
+
+// A compiled expression (see calcCompile())
+typedef struct CalcExpression CalcExpression;
+
+// Compiles an expression (case-insensitive) so that it can be evaluated with calcEvaluate().
+// Returns NULL and fills in errors if the expression isn't valid (errors may be NULL).
+// The expression is copied, so it doesn't need to outlive the compiled expression.
+CalcExpression *calcCompile(const char *expression, CalcErrors *errors);
+
+// Same as calcCompile(), with options (NULL for the defaults)
+CalcExpression *calcCompileWithOptions(const char *expression, const CalcOptions *options, CalcErrors *errors);
+
+// Evaluates a compiled expression and stores its value in result.
+// Returns false and fills in errors if it couldn't be evaluated (errors may be NULL).
+// Note that results of ±∞ and NaN aren't errors.
+// A compiled expression keeps the state of its 'rand' numbers, so it must not be evaluated by
+// two threads at the same time (different compiled expressions are independent).
+bool calcEvaluate(CalcExpression *expression, double *result, CalcErrors *errors);
+
+// Seeds the random numbers of a compiled expression's 'rand' identifiers
+// Compiled expressions start with the same seed, so the same expression gives the same numbers
+// unless they are seeded differently.
+void calcSetSeed(CalcExpression *expression, unsigned long long seed);
+
+// Frees a compiled expression (does nothing if it is NULL)
+void calcFree(CalcExpression *expression);
+
+// Returns the number of bytes of memory held by a compiled expression (including what is reserved
+// for it but not used, so that it adds up to what the process spends on it)
+size_t calcMemoryUsage(const CalcExpression *expression);
+
+// Reads an expression of any length from a file descriptor until the end of the file and
+// evaluates it without storing it (newlines are treated as whitespace).
+// Returns false and fills in errors if it couldn't be evaluated (errors may be NULL).
+bool calcEvaluateStream(int fd, double *result, CalcErrors *errors);
+
+#endif // CALCULATOR_CALC_H
@@ -0,0 +1,238 @@
+// Justin Chen
+// Character classification for the tokenizer
+// The tokenizer needs to know, for each character of the expression, whether it is a digit,
+// a letter, an operator or whitespace. Instead of testing one character at a time, the classes
+// of 16 (SSE2) or 32 (AVX2) characters are computed at once and stored as bitmasks, so that
+// runs of digits/letters/whitespace can be skipped with a single bit scan.
+
+#include <string.h>   // String functions (memset(), memcpy(), strchr())
+#include "classify.h"
+
+// SIMD is only used with compilers that support x86 intrinsics and function-level target attributes
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CLASSIFY_X86
+#include <immintrin.h>
+#endif
+
+// Number of characters classified per mask word
+#define WORD_BITS 64
+
+// Characters of the operator class
+static const char operatorCharacters[] = "+-*/%^!()";
+
+// Classifies up to 64 characters one at a time and stores their class bits in word index of each mask
+static void classifyWordScalar(const char *str, int count, CharClasses classes, int index) {
+  uint64_t digits = 0, letters = 0, operators = 0, spaces = 0;
+  for (int i = 0; i < count; i++) {
+    char c = str[i];
+    uint64_t bit = (uint64_t) 1 << i;
+    if (c >= '0' && c <= '9') {
+      digits |= bit;
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') { // c | 0x20 is lowercase for letters
+      letters |= bit;
+    } else if (c == ' ' || c == '\t') {
+      spaces |= bit;
+    } else if (c != '\0' && strchr(operatorCharacters, c) != NULL) {
+      operators |= bit;
+    }
+  }
+  classes.digits[index] = digits;
+  classes.letters[index] = letters;
+  classes.operators[index] = operators;
+  classes.spaces[index] = spaces;
+}
+
+void classifyCharactersScalar(const char *str, int length, CharClasses classes) {
+  for (int index = 0; index * WORD_BITS < length; index++) {
+    int count = length - index * WORD_BITS;
+    classifyWordScalar(str + index * WORD_BITS, count < WORD_BITS ? count : WORD_BITS, classes, index);
+  }
+}
+
+#ifdef CLASSIFY_X86
+// Classifies 16 characters with SSE2.
+// SSE2 only has signed byte comparisons, so both sides of range checks are flipped by 0x80
+// to compare characters as unsigned values.
+static inline void classifyBlockSSE2(const char *str, unsigned *digits, unsigned *letters,
+                                     unsigned *operators, unsigned *spaces) {
+  const __m128i flip = _mm_set1_epi8((char) 0x80);
+  __m128i c = _mm_loadu_si128((const __m128i *) str);
+  __m128i flipped = _mm_xor_si128(c, flip);
+  __m128i lowerFlipped = _mm_xor_si128(_mm_or_si128(c, _mm_set1_epi8(0x20)), flip);
+
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(flipped, _mm_set1_epi8((char) (('0' - 1) ^ 0x80))),
+                                _mm_cmplt_epi8(flipped, _mm_set1_epi8((char) (('9' + 1) ^ 0x80))));
+  __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lowerFlipped, _mm_set1_epi8((char) (('a' - 1) ^ 0x80))),
+                                 _mm_cmplt_epi8(lowerFlipped, _mm_set1_epi8((char) (('z' + 1) ^ 0x80))));
+  __m128i space = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\t')));
+  __m128i operatorMatch = _mm_setzero_si128();
+  for (int i = 0; operatorCharacters[i] != '\0'; i++) {
+    operatorMatch = _mm_or_si128(operatorMatch, _mm_cmpeq_epi8(c, _mm_set1_epi8(operatorCharacters[i])));
+  }
+
+  *digits = (unsigned) _mm_movemask_epi8(digit);
+  *letters = (unsigned) _mm_movemask_epi8(letter);
+  *operators = (unsigned) _mm_movemask_epi8(operatorMatch);
+  *spaces = (unsigned) _mm_movemask_epi8(space);
+}
+
+// Classifies 64 characters with SSE2 and stores their class bits in word index of each mask
+static void classifyWordSSE2(const char *str, CharClasses classes, int index) {
+  uint64_t digits = 0, letters = 0, operators = 0, spaces = 0;
+  for (int block = 0; block < WORD_BITS / 16; block++) {
+    unsigned d, l, o, s;
+    classifyBlockSSE2(str + block * 16, &d, &l, &o, &s);
+    digits |= (uint64_t) d << (block * 16);
+    letters |= (uint64_t) l << (block * 16);
+    operators |= (uint64_t) o << (block * 16);
+    spaces |= (uint64_t) s << (block * 16);
+  }
+  classes.digits[index] = digits;
+  classes.letters[index] = letters;
+  classes.operators[index] = operators;
+  classes.spaces[index] = spaces;
+}
+
+// Classifies 32 characters with AVX2 (same comparisons as classifyBlockSSE2())
+__attribute__((target("avx2")))
+static inline void classifyBlockAVX2(const char *str, unsigned *digits, unsigned *letters,
+                                     unsigned *operators, unsigned *spaces) {
+  const __m256i flip = _mm256_set1_epi8((char) 0x80);
+  __m256i c = _mm256_loadu_si256((const __m256i *) str);
+  __m256i flipped = _mm256_xor_si256(c, flip);
+  __m256i lowerFlipped = _mm256_xor_si256(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), flip);
+
+  __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(flipped, _mm256_set1_epi8((char) (('0' - 1) ^ 0x80))),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (('9' + 1) ^ 0x80)), flipped));
+  __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lowerFlipped, _mm256_set1_epi8((char) (('a' - 1) ^ 0x80))),
+                                    _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (('z' + 1) ^ 0x80)), lowerFlipped));
+  __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                                  _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t')));
+  __m256i operatorMatch = _mm256_setzero_si256();
+  for (int i = 0; operatorCharacters[i] != '\0'; i++) {
+    operatorMatch = _mm256_or_si256(operatorMatch, _mm256_cmpeq_epi8(c, _mm256_set1_epi8(operatorCharacters[i])));
+  }
+
+  *digits = (unsigned) _mm256_movemask_epi8(digit);
+  *letters = (unsigned) _mm256_movemask_epi8(letter);
+  *operators = (unsigned) _mm256_movemask_epi8(operatorMatch);
+  *spaces = (unsigned) _mm256_movemask_epi8(space);
+}
+
+// Classifies 64 characters with AVX2 and stores their class bits in word index of each mask
+__attribute__((target("avx2")))
+static void classifyWordAVX2(const char *str, CharClasses classes, int index) {
+  uint64_t digits = 0, letters = 0, operators = 0, spaces = 0;
+  for (int block = 0; block < WORD_BITS / 32; block++) {
+    unsigned d, l, o, s;
+    classifyBlockAVX2(str + block * 32, &d, &l, &o, &s);
+    digits |= (uint64_t) d << (block * 32);
+    letters |= (uint64_t) l << (block * 32);
+    operators |= (uint64_t) o << (block * 32);
+    spaces |= (uint64_t) s << (block * 32);
+  }
+  classes.digits[index] = digits;
+  classes.letters[index] = letters;
+  classes.operators[index] = operators;
+  classes.spaces[index] = spaces;
+}
+#endif
+
+void classifyCharacters(const char *str, int length, CharClasses classes) {
+#ifdef CLASSIFY_X86
+  bool useAVX2 = __builtin_cpu_supports("avx2");
+  int index = 0;
+
+  // Classify all full words directly from the string
+  for (; (index + 1) * WORD_BITS <= length; index++) {
+    if (useAVX2) {
+      classifyWordAVX2(str + index * WORD_BITS, classes, index);
+    } else {
+      classifyWordSSE2(str + index * WORD_BITS, classes, index);
+    }
+  }
+
+  // The last partial word is copied into a zero-padded buffer so that the vector loads
+  // don't read past the end of the string ('\0' isn't in any class).
+  int remaining = length - index * WORD_BITS;
+  if (remaining > 0) {
+    char padded[WORD_BITS];
+    memset(padded, 0, sizeof(padded));
+    memcpy(padded, str + index * WORD_BITS, remaining);
+    classifyWordSSE2(padded, classes, index);
+  }
+#else
+  classifyCharactersScalar(str, length, classes);
+#endif
+}
+
+// Returns the number of set bits in a word
+static int countOnes(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  for (; word != 0; word &= word - 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+// Finds the '(' and ')' characters among (up to) 64 characters
+static void findParenthesesInWord(const char *str, int count, uint64_t *opens, uint64_t *closes) {
+  *opens = 0;
+  *closes = 0;
+#ifdef CLASSIFY_X86
+  if (count == WORD_BITS) {
+    for (int block = 0; block < WORD_BITS / 16; block++) {
+      __m128i c = _mm_loadu_si128((const __m128i *) (str + block * 16));
+      *opens |= (uint64_t) (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('('))) << (block * 16);
+      *closes |= (uint64_t) (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(')'))) << (block * 16);
+    }
+    return;
+  }
+#endif
+  for (int i = 0; i < count; i++) {
+    *opens |= (uint64_t) (str[i] == '(') << i;
+    *closes |= (uint64_t) (str[i] == ')') << i;
+  }
+}
+
+int findUnmatchedParenthesis(const char *str, int length) {
+  int depth = 0;            // Number of '(' not closed yet
+  int lastOpenAtZero = -1;  // Index of the last '(' that was opened at depth 0
+
+  for (int base = 0; base < length; base += WORD_BITS) {
+    int count = length - base < WORD_BITS ? length - base : WORD_BITS;
+    uint64_t opens, closes;
+    findParenthesesInWord(str + base, count, &opens, &closes);
+
+    // If there are more unclosed '(' than ')' in this word, the depth can't reach 0 anywhere
+    // in the word, so only the number of each matters (the prefix sum of +1/-1 per parenthesis).
+    int numCloses = countOnes(closes);
+    if (depth > numCloses) {
+      depth += countOnes(opens) - numCloses;
+      continue;
+    }
+
+    // Otherwise, go through the parentheses in this word in order
+    for (uint64_t parentheses = opens | closes; parentheses != 0; parentheses &= parentheses - 1) {
+      int bit = countTrailingZeros(parentheses);
+      if ((opens >> bit) & 1) {
+        if (depth == 0) {
+          lastOpenAtZero = base + bit;
+        }
+        depth++;
+      } else if (depth == 0) { // ')' with nothing to close
+        return base + bit;
+      } else {
+        depth--;
+      }
+    }
+  }
+
+  // The first '(' that is never closed is the last one opened at depth 0,
+  // as the depth never returned to 0 after it.
+  return depth > 0 ? lastOpenAtZero : -1;
+}
@@ -0,0 +1,74 @@
+// Justin Chen
+// Character classification for the tokenizer
+
+#ifndef CALCULATOR_CLASSIFY_H
+#define CALCULATOR_CLASSIFY_H
+
+#include <stdint.h>   // Fixed-width integers (uint64_t)
+#include <stdbool.h>  // Define booleans (bool, true, false)
+
+// Number of 64-bit words needed to hold one bit for each character of a string of the given length
+#define MASK_WORDS(length) (((length) + 63) / 64)
+
+// Define struct CharClasses
+// Holds one bitmask per character class. Bit (i % 64) of word (i / 64) of a mask is set
+// if the character at index i of the classified string belongs to that class.
+// Each mask must have room for MASK_WORDS(length) words.
+typedef struct CharClasses {
+    uint64_t *digits;     // [0-9]
+    uint64_t *letters;    // [a-zA-Z]
+    uint64_t *operators;  // [+-*/%^!()]
+    uint64_t *spaces;     // [ \t]
+} CharClasses;
+
+// Fills in the class masks for the first length characters of str.
+// Uses SSE2/AVX2 on x86-64 (16/32 characters at a time) and falls back to a scalar loop elsewhere.
+void classifyCharacters(const char *str, int length, CharClasses classes);
+
+// Same as classifyCharacters(), but always uses the scalar loop (used to check/benchmark the fast paths)
+void classifyCharactersScalar(const char *str, int length, CharClasses classes);
+
+// Finds the first unmatched parenthesis in the first length characters of str.
+// Returns the index of the first ')' that has no '(' before it to close, or if there isn't one,
+// the index of the first '(' that is never closed. Returns -1 if all parentheses match.
+// This is a single pass over the string (64 characters at a time) that uses O(1) memory.
+int findUnmatchedParenthesis(const char *str, int length);
+
+// Returns the number of trailing zero bits of a non-zero word
+static inline int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(word);
+#else
+  int count = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+// Checks if the character at index is in the class given by mask
+static inline bool inClass(const uint64_t *mask, int index) {
+  return (mask[(unsigned) index / 64] >> ((unsigned) index % 64)) & 1;
+}
+
+// Returns the index of the first character at or after index that is not in the class
+// given by mask, or length if there isn't one.
+// Note that this is called once per token, so it is defined here to be inlined into the tokenizer.
+static inline int skipClass(const uint64_t *mask, int index, int length) {
+  while (index < length) {
+    // Bits of characters not in the class, starting from index
+    // (bits shifted in from the top are 0, so they are never mistaken for a boundary)
+    uint64_t outside = ~mask[(unsigned) index / 64] >> ((unsigned) index % 64);
+    if (outside != 0) {
+      index += countTrailingZeros(outside);
+      return index < length ? index : length;
+    }
+    // The rest of this word is in the class, continue from the start of the next word
+    index = (index | 63) + 1;
+  }
+  return length;
+}
+
+#endif // CALCULATOR_CLASSIFY_H
@@ -0,0 +1,156 @@
+// Justin Chen
+// Flattening of sums and products in syntax trees
+// A chain is an addition whose operands may be additions too, whose operands may be too, and so on,
+// whatever its shape ('a + b + c + d' is ((a + b) + c) + d, and '(a + b) + (c + d)' is balanced).
+// Its terms are the operands in it that aren't additions, in the order they are evaluated. The
+// parser builds a chain of n terms as n - 1 additions, each of which has to wait for the one
+// before it. A flattened chain is one SUM node instead, whose terms are left on the stack by a
+// list of OPERAND_PAIR nodes, so the backends add them all with one call of sumTerms() (the same
+// goes for multiplications and PRODUCT nodes). Chains with fewer terms than sumTerms() has partial
+// sums are left alone, as it would add them in order anyway, like the additions do.
+
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <string.h>   // String functions (memset())
+#include <stdint.h>   // Fixed-width integers (int32_t)
+#include "flatten.h"
+#include "operations.h"  // Sums and products (REDUCTION_LANES)
+
+// Fewest terms of a compensated sum (the compensation of one addition is always lost when it is rounded)
+#define MIN_COMPENSATED_TERMS 3
+
+// Scratch memory of flattening a tree (freed when done, so that it doesn't stay with the
+// compiled expression)
+typedef struct Flattening {
+    const Ast *ast;
+    int32_t *order;    // Nodes of the tree in evaluation order
+    int32_t *parent;   // Node that uses each node (NO_NODE for the root)
+    int32_t *terms;    // Number of terms of the chain each node is the top of
+    int32_t *chain;    // Top of the flattened chain each node is an operator of (NO_NODE if none)
+    int32_t *written;  // Index of each node in the new tree (for the top of a chain, its list of terms so far)
+    bool fastMath;
+    bool compensatedSums;
+} Flattening;
+
+// Returns the type of the node a chain of operations of a type is flattened into (NUMBER if it isn't)
+static Symbol flattenedType(const Flattening *flattening, Symbol type) {
+  if (type == ADD && (flattening->fastMath || flattening->compensatedSums)) {
+    return flattening->compensatedSums ? COMPENSATED_SUM : SUM;
+  } else if (type == MULTIPLY && flattening->fastMath) {
+    return PRODUCT;
+  }
+  return NUMBER;
+}
+
+// Returns the number of terms an operand adds to the chain of its parent of a type
+static int termsOf(const Flattening *flattening, int operand, Symbol type) {
+  return flattening->ast->nodes[operand].type == type ? flattening->terms[operand] : 1;
+}
+
+// Finds the chains to flatten: counts the terms of the chains from the bottom up, then marks the
+// operators of the ones long enough from the top down. Returns the number of chains.
+static int findChains(Flattening *flattening, int numNodes) {
+  const Ast *ast = flattening->ast;
+  for (int i = 0; i < numNodes; i++) {
+    int index = flattening->order[i];
+    const AstNode *node = &ast->nodes[index];
+    flattening->parent[index] = NO_NODE;
+    if (astHasLeftOperand(node)) {
+      flattening->parent[node->left] = index;
+    }
+    if (astHasRightOperand(node)) {
+      flattening->parent[node->right] = index;
+    }
+    if (flattenedType(flattening, node->type) != NUMBER) {
+      flattening->terms[index] = termsOf(flattening, node->left, node->type) +
+                                 termsOf(flattening, node->right, node->type);
+    }
+  }
+
+  int numChains = 0;
+  for (int i = numNodes - 1; i >= 0; i--) {
+    int index = flattening->order[i];
+    Symbol type = ast->nodes[index].type;
+    int parent = flattening->parent[index];
+    Symbol flattened = flattenedType(flattening, type);
+    flattening->chain[index] = NO_NODE;
+    if (flattened == NUMBER) {
+      continue;
+    } else if (parent != NO_NODE && ast->nodes[parent].type == type) { // Part of its parent's chain
+      flattening->chain[index] = flattening->chain[parent];
+    } else if (flattening->terms[index] >= (flattened == COMPENSATED_SUM ? MIN_COMPENSATED_TERMS : REDUCTION_LANES)) {
+      flattening->chain[index] = index;
+      numChains++;
+    }
+  }
+  return numChains;
+}
+
+// Writes the tree out into output (in evaluation order), with the operators of each flattened
+// chain replaced by the list of its terms, and its top by the SUM or PRODUCT of them
+static void writeTree(Flattening *flattening, int numNodes, Ast *output) {
+  const Ast *ast = flattening->ast;
+  int32_t *chain = flattening->chain;
+  int32_t *written = flattening->written;
+  output->numNodes = 0;
+  for (int i = 0; i < numNodes; i++) {
+    int index = flattening->order[i];
+    const AstNode *node = &ast->nodes[index];
+    uint32_t position = ast->positions[index];
+    if (chain[index] == index) { // The top of a chain, whose terms are all written
+      Symbol type = flattenedType(flattening, node->type);
+      written[index] = astAddNode(output, type, written[index], flattening->terms[index], position);
+    } else if (chain[index] != NO_NODE) { // An operator in a chain, which its list replaces
+      continue;
+    } else {
+      int left = astHasLeftOperand(node) ? written[node->left] : node->left;
+      int right = astHasRightOperand(node) ? written[node->right] : node->right;
+      written[index] = astAddNode(output, node->type, left, right, position);
+    }
+
+    // The terms of a chain are appended to its list as they are written (in evaluation order)
+    int parent = flattening->parent[index];
+    if (parent != NO_NODE && chain[parent] != NO_NODE && chain[index] != chain[parent]) {
+      int top = chain[parent];
+      written[top] = written[top] == NO_NODE ? written[index] :
+                     astAddNode(output, OPERAND_PAIR, written[top], written[index], ast->positions[parent]);
+    }
+  }
+}
+
+bool flattenChains(Ast *ast, int *root, bool fastMath, bool compensatedSums, Arena *arena) {
+  Flattening flattening = {ast, NULL, NULL, NULL, NULL, NULL, fastMath, compensatedSums};
+  flattening.order = malloc(ast->numNodes * sizeof(int32_t));
+  flattening.parent = malloc(ast->numNodes * sizeof(int32_t));
+  flattening.terms = malloc(ast->numNodes * sizeof(int32_t));
+  flattening.chain = malloc(ast->numNodes * sizeof(int32_t));
+  flattening.written = malloc(ast->numNodes * sizeof(int32_t));
+  int32_t *work = malloc(2 * (size_t) ast->numNodes * sizeof(int32_t));
+  bool flattened = flattening.order != NULL && flattening.parent != NULL && flattening.terms != NULL &&
+                   flattening.chain != NULL && flattening.written != NULL && work != NULL;
+  if (flattened) {
+    int numNodes = astPostOrder(ast, *root, flattening.order, work);
+    int numChains = findChains(&flattening, numNodes);
+
+    // Only rebuild the tree if a chain is flattened (a chain of n terms has n - 1 operators, and
+    // becomes n - 1 pairs and its SUM or PRODUCT)
+    if (numChains > 0) {
+      Ast output = {NULL, NULL, 0, ast->literals, ast->numShared};
+      output.nodes = arenaAllocate(arena, (numNodes + numChains) * sizeof(AstNode));
+      output.positions = arenaAllocate(arena, (numNodes + numChains) * sizeof(uint32_t));
+      flattened = output.nodes != NULL && output.positions != NULL;
+      if (flattened) {
+        memset(flattening.written, 0xFF, ast->numNodes * sizeof(int32_t));
+        writeTree(&flattening, numNodes, &output);
+        *ast = output;
+        *root = output.numNodes - 1;
+      }
+    }
+  }
+  free(flattening.order);
+  free(flattening.parent);
+  free(flattening.terms);
+  free(flattening.chain);
+  free(flattening.written);
+  free(work);
+  return flattened;
+}
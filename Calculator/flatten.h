@@ -0,0 +1,22 @@
+// Justin Chen
+// Flattening of sums and products in syntax trees
+
+#ifndef CALCULATOR_FLATTEN_H
+#define CALCULATOR_FLATTEN_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+#include "arena.h"    // Memory of the new tree (Arena)
+
+// Rewrites each long chain of additions (and, with fastMath, multiplications) in the tree with
+// its root at *root, e.g., 'a + b + c + ...', into one node of all its terms: a SUM (added
+// pairwise, see sumTerms()), a COMPENSATED_SUM if compensatedSums is set (see compensatedSum())
+// or a PRODUCT. Either way the terms are added in a different order than the parser's, which
+// changes results, so this is only run with CalcOptions.fastMath or CalcOptions.compensatedSums.
+// The terms are still evaluated in the same order. If a chain is flattened, the tree is rebuilt
+// from arena (with one more node per chain) and *root is updated. This has to be run after
+// fuseOperations() (which looks for additions) and shareSubexpressions().
+// Returns false if out of memory.
+bool flattenChains(Ast *ast, int *root, bool fastMath, bool compensatedSums, Arena *arena);
+
+#endif // CALCULATOR_FLATTEN_H
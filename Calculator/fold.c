@@ -0,0 +1,61 @@
+// Justin Chen
+// Constant folding of syntax trees
+// Operands always come before the nodes that use them (see ast.h), so one pass over the nodes in
+// order sees every operand folded before deciding whether the node that uses it can be.
+
+#include <string.h>   // String functions (memcpy())
+#include "fold.h"
+#include "operations.h"  // Operators and functions (applyOperator(), applyFunction(), factorial())
+
+bool foldConstants(Ast *ast, int numLiterals, Arena *arena) {
+  // Every node may become a number with a value of its own
+  double *literals = arenaAllocate(arena, (numLiterals + ast->numNodes) * sizeof(double));
+  if (literals == NULL) {
+    return false;
+  }
+  memcpy(literals, ast->literals, numLiterals * sizeof(double));
+
+  for (int i = 0; i < ast->numNodes; i++) {
+    AstNode *node = &ast->nodes[i];
+    double value;
+    switch (node->type) {
+      case NUMBER: case RAND_NUM: case STORE_SHARED: case LOAD_SHARED: case INTEGER_POWER: case ROOT_POWER:
+        continue;
+      case MATH_PI:
+        value = M_PI;
+        break;
+      case MATH_E:
+        value = M_E;
+        break;
+      case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER:
+        if (ast->nodes[node->left].type != NUMBER || ast->nodes[node->right].type != NUMBER) {
+          continue;
+        }
+        value = applyOperator(node->type, literals[ast->nodes[node->left].left], literals[ast->nodes[node->right].left]);
+        break;
+      default: { // Unary operators and functions
+        if (ast->nodes[node->left].type != NUMBER) {
+          continue;
+        }
+        double operand = literals[ast->nodes[node->left].left];
+        if (node->type == NEGATE) {
+          value = -operand;
+        } else if (node->type == FACTORIAL) {
+          if (operand < 0) { // Reported when evaluated
+            continue;
+          }
+          value = factorial(operand);
+        } else {
+          value = applyFunction(node->type, operand);
+        }
+        break;
+      }
+    }
+
+    literals[numLiterals] = value;
+    *node = (AstNode) {NUMBER, numLiterals++, NO_NODE};
+  }
+
+  ast->literals = literals;
+  return true;
+}
@@ -0,0 +1,20 @@
+// Justin Chen
+// Constant folding of syntax trees
+
+#ifndef CALCULATOR_FOLD_H
+#define CALCULATOR_FOLD_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+#include "arena.h"    // Memory of the folded values (Arena)
+
+// Replaces every subtree that doesn't depend on 'rand' (its inputs are all numbers, pi and e)
+// by a NUMBER node of its value, so that it is computed once instead of on every evaluation.
+// The values are computed with the same operations as evaluateAst(), so the results don't change.
+// Factorials of negative numbers are left alone, so that their error is still reported when the
+// expression is evaluated. Folded nodes are rewritten in place (operands they no longer use are
+// left unreachable), and the literals are copied into a larger array allocated from arena.
+// numLiterals is the number of values in ast->literals. Returns false if out of memory.
+bool foldConstants(Ast *ast, int numLiterals, Arena *arena);
+
+#endif // CALCULATOR_FOLD_H
@@ -0,0 +1,104 @@
+// Justin Chen
+// Fused operations in syntax trees
+// The nodes are visited from the root down, so the largest pattern a node is the top of is found
+// first (e.g., 'ln(1 + x * y)' is log1p(x * y), not ln(fma(x, y, 1))). A fused multiply-add
+// takes three operands, so its first two are an OPERAND_PAIR node, which leaves both values for
+// it: the product in 'x * y + z' becomes the pair, and so does the one in 'x + y * z', which keeps
+// the operands in the order they were evaluated in (and the nodes in the order of ast.h).
+
+#include <stdlib.h>   // Standard library (calloc(), free())
+#include "fuse.h"
+
+// Returns whether a node is a number with a value
+static bool isNumber(const Ast *ast, int index, double value) {
+  const AstNode *node = &ast->nodes[index];
+  return node->type == NUMBER && ast->literals[node->left] == value;
+}
+
+// Returns the operand of a node that is the square of it, 'x^2' or 'x * x' (NO_NODE if it isn't one)
+// x * x is only found when both are the same value: a constant, or a repeated subexpression
+// (saved by the left one and loaded by the right one, see shareSubexpressions()).
+static int squaredOperand(const Ast *ast, int index) {
+  const AstNode *node = &ast->nodes[index];
+  if (node->type == POWER && isNumber(ast, node->right, 2)) {
+    return node->left;
+  } else if (node->type != MULTIPLY) {
+    return NO_NODE;
+  }
+  const AstNode *left = &ast->nodes[node->left];
+  const AstNode *right = &ast->nodes[node->right];
+  if (right->type == LOAD_SHARED && (left->type == STORE_SHARED || left->type == LOAD_SHARED) &&
+      left->right == right->right) {
+    return node->left;
+  } else if (left->type == NUMBER && right->type == NUMBER &&
+             ast->literals[left->left] == ast->literals[right->left]) {
+    return node->left;
+  }
+  return NO_NODE;
+}
+
+// Rewrites a node into a fused operation if it is the top of a pattern
+static void fuseNode(Ast *ast, AstNode *node) {
+  AstNode *left = &ast->nodes[node->left];
+  AstNode *right = astHasRightOperand(node) ? &ast->nodes[node->right] : NULL;
+  switch (node->type) {
+    case LN: // ln(1 + x) or ln(x + 1)
+      if (left->type == ADD && isNumber(ast, left->left, 1)) {
+        *node = (AstNode) {LOG1P, left->right, NO_NODE};
+      } else if (left->type == ADD && isNumber(ast, left->right, 1)) {
+        *node = (AstNode) {LOG1P, left->left, NO_NODE};
+      }
+      return;
+    case SQRT: { // sqrt(x^2 + y^2)
+      if (left->type != ADD) {
+        return;
+      }
+      int x = squaredOperand(ast, left->left), y = squaredOperand(ast, left->right);
+      if (x != NO_NODE && y != NO_NODE) {
+        *node = (AstNode) {HYPOT, x, y};
+      }
+      return;
+    }
+    case ADD: case MINUS:
+      // e^x - 1, e^x + -1 or -1 + e^x
+      if (node->type == MINUS && left->type == EXP && isNumber(ast, node->right, 1)) {
+        *node = (AstNode) {EXPM1, left->left, NO_NODE};
+      } else if (node->type == ADD && left->type == EXP && isNumber(ast, node->right, -1)) {
+        *node = (AstNode) {EXPM1, left->left, NO_NODE};
+      } else if (node->type == ADD && right->type == EXP && isNumber(ast, node->left, -1)) {
+        *node = (AstNode) {EXPM1, right->left, NO_NODE};
+      } else if (left->type == MULTIPLY) { // x * y ± z
+        left->type = OPERAND_PAIR;
+        node->type = node->type == ADD ? FUSED_MULTIPLY_ADD : FUSED_MULTIPLY_SUBTRACT;
+      } else if (right->type == MULTIPLY) { // x ± y * z
+        right->type = OPERAND_PAIR;
+        node->type = node->type == ADD ? FUSED_ADD_MULTIPLY : FUSED_SUBTRACT_MULTIPLY;
+      }
+      return;
+    default:
+      return;
+  }
+}
+
+bool fuseOperations(Ast *ast, int root) {
+  // Only the nodes reached from the root are rewritten: a node a pattern no longer uses (e.g., the
+  // sum in 'ln(1 + x * y)') still points at operands that are in the tree
+  unsigned char *reached = calloc(ast->numNodes, 1);
+  if (reached == NULL) {
+    return false;
+  }
+  reached[root] = 1;
+  for (int i = root; i >= 0; i--) {
+    AstNode *node = &ast->nodes[i];
+    if (!reached[i] || !astHasLeftOperand(node)) {
+      continue;
+    }
+    fuseNode(ast, node);
+    reached[node->left] = 1;
+    if (astHasRightOperand(node)) {
+      reached[node->right] = 1;
+    }
+  }
+  free(reached);
+  return true;
+}
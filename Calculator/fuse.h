@@ -0,0 +1,20 @@
+// Justin Chen
+// Fused operations in syntax trees
+
+#ifndef CALCULATOR_FUSE_H
+#define CALCULATOR_FUSE_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+
+// Rewrites the operations of the tree with its root at root that libm can do with one rounding
+// instead of several: a product that is added or subtracted becomes a fused multiply-add (fma()),
+// 'ln(1 + x)' becomes log1p(x), 'e^x - 1' becomes expm1(x) and 'sqrt(x^2 + y^2)' becomes
+// hypot(x, y). This changes results (they are usually closer to the exact ones, and hypot()
+// doesn't overflow), so it is only run with CalcOptions.fastMath. Operands are still evaluated in
+// the same order. Nodes are rewritten in place (the ones no longer used are left unreachable).
+// This has to be run after shareSubexpressions() and before reducePowers() (x^2 is found as a
+// POWER). Returns false if out of memory.
+bool fuseOperations(Ast *ast, int root);
+
+#endif // CALCULATOR_FUSE_H
@@ -0,0 +1,66 @@
+// Justin Chen
+// Reserved identifiers (names of constants and functions)
+// Identifiers are found with a minimal perfect hash, so a lookup hashes the name once
+// and compares it against a single candidate.
+
+#include <string.h>   // String functions (strncmp())
+#include "identifiers.h"
+
+// Reserved identifiers, placed in the slots given by their minimal perfect hash.
+// The slot of an identifier is (hash / 256 + identifierDisplacements[hash % 12]) % 27, where
+// hash is the FNV-1a hash of its name (see lookupIdentifier()). The displacements were found by
+// placing the buckets of identifiers (largest first) at the smallest displacement that doesn't
+// collide with an already placed identifier.
+// When adding an identifier, the displacements (and the number of buckets) need to be recomputed.
+static const Identifier identifiers[27] = {
+    {"degtorad", DEGTORAD, true},
+    {"pi", MATH_PI, false},
+    {"cos", COS, true},
+    {"ln", LN, true},
+    {"round", ROUND, true},
+    {"e", MATH_E, false},
+    {"cosh", COSH, true},
+    {"abs", ABS, true},
+    {"acos", ACOS, true},
+    {"sqrt", SQRT, true},
+    {"log", LOG, true},
+    {"floor", FLOOR, true},
+    {"asinh", ASINH, true},
+    {"tanh", TANH, true},
+    {"inv", INV, true},
+    {"exp", EXP, true},
+    {"atanh", ATANH, true},
+    {"ceil", CEIL, true},
+    {"sinh", SINH, true},
+    {"rand", RAND_NUM, false},
+    {"cbrt", CBRT, true},
+    {"acosh", ACOSH, true},
+    {"atan", ATAN, true},
+    {"sin", SIN, true},
+    {"radtodeg", RADTODEG, true},
+    {"asin", ASIN, true},
+    {"tan", TAN, true},
+};
+
+// Displacement of each bucket of identifiers in the identifiers table
+static const unsigned char identifierDisplacements[12] = {20, 3, 1, 0, 18, 11, 17, 17, 2, 1, 4, 4};
+
+unsigned int hashSpan(const char *str, int length) {
+  unsigned int hash = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    hash ^= (unsigned char) str[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// The hash of the text gives the only slot the identifier could be in,
+// so a single comparison is needed to confirm it.
+const Identifier *lookupIdentifier(const char *str, int length) {
+  unsigned int hash = hashSpan(str, length);
+  const Identifier *candidate = &identifiers[(hash / 256 + identifierDisplacements[hash % 12]) % 27];
+  if (strncmp(str, candidate->name, length) == 0 && candidate->name[length] == '\0') {
+    return candidate;
+  }
+  return NULL;
+}
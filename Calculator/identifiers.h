@@ -0,0 +1,27 @@
+// Justin Chen
+// Reserved identifiers (names of constants and functions)
+
+#ifndef CALCULATOR_IDENTIFIERS_H
+#define CALCULATOR_IDENTIFIERS_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "symbol.h"
+
+// Define struct Identifier
+// Identifiers are the reserved names of constants and functions (e.g., 'pi', 'sqrt').
+// Each identifier has a name, the type of the token it is tokenized into, and whether it is
+// a function (functions are applied to the operand after them).
+typedef struct Identifier {
+    const char *name;
+    Symbol type;
+    bool isFunction;
+} Identifier;
+
+// Hashes the first length characters of a string with FNV-1a
+unsigned int hashSpan(const char *str, int length);
+
+// Finds the reserved identifier spelled by the first length characters of str (in lowercase),
+// or returns NULL if there isn't one. The text doesn't need to be null-terminated.
+const Identifier *lookupIdentifier(const char *str, int length);
+
+#endif // CALCULATOR_IDENTIFIERS_H
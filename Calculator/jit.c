@@ -0,0 +1,537 @@
+// Justin Chen
+// Native machine code compiled from syntax trees (x86-64 only)
+// The code keeps the value on the top of the stack in xmm0 and the values under it in memory
+// slots, so an operation with a constant operand is a single SSE2 instruction (the constant is
+// read from memory). Functions other than sqrt() and abs() are calls to libm (or to the same
+// functions the other backends use), and every operation is rounded on its own, as it is in C.
+// Fused multiply-adds (see fuseOperations()) are one FMA3 instruction on CPUs that have them, and
+// calls of fma() elsewhere, which round the same way. Sums and products of many terms (see
+// flattenChains()) are calls of the same functions as the other backends', on the terms' slots.
+//
+// Registers while the code runs (all callee-saved, so they survive the calls):
+//   rbx - slots, rbp - constants, r12 - the AstEvaluation (for 'rand' and errors)
+// The values of repeated subexpressions (see shareSubexpressions()) are kept after the fixed
+// constants, so they are read the same way constants are.
+
+#define _DEFAULT_SOURCE  // Anonymous mappings (MAP_ANONYMOUS)
+
+#include "jit.h"
+
+#ifdef JIT_SUPPORTED
+
+#include <math.h>     // Math library (pow(), fmod(), sin(), ...)
+#include <string.h>   // String functions (memcpy())
+#include <stdint.h>   // Fixed-width integers (uint32_t, uint64_t, uintptr_t)
+#include <sys/mman.h> // Executable memory (mmap(), mprotect(), munmap())
+#include <unistd.h>   // Page size (sysconf())
+#include "operations.h"  // Powers, factorials, conversions and random numbers (power(), factorial(), degtorad())
+
+// Largest number of bytes of machine code of one node
+#define MAX_NODE_BYTES 64
+
+// Base registers of memory operands (their numbers in x86-64 encodings)
+#define SLOTS 3      // rbx
+#define CONSTANTS 5  // rbp
+
+// Constants every program has, before the ones of the expression
+#define SIGN_MASK 0  // -0.0 (only the sign bit set), for negation
+#define ABS_MASK 1   // All the bits but the sign bit, for abs()
+#define NUM_FIXED_CONSTANTS 2
+
+// The compiled code
+typedef double (*JitFunction)(double *slots, double *constants, const AstEvaluation *evaluation);
+
+// State of compiling a tree
+typedef struct Compiler {
+    const Ast *ast;
+    JitCode *jit;
+    unsigned char *code;      // Next byte of machine code
+    unsigned char *folded;    // Whether each node is a constant (or shared value) read by the operation that uses it
+    int numConstants;
+    int depth;                // Number of values on the stack after the code so far
+    int maxDepth;
+    bool fma;                 // Whether the CPU has FMA3 instructions (vfmadd231sd, ...)
+} Compiler;
+
+// Functions that take degrees, called by the code (the same operations as applyFunction())
+static double jitSin(double x) { return sin(degtorad(x)); }
+static double jitCos(double x) { return cos(degtorad(x)); }
+static double jitTan(double x) { return tan(degtorad(x)); }
+static double jitAsin(double x) { return radtodeg(asin(x)); }
+static double jitAcos(double x) { return radtodeg(acos(x)); }
+static double jitAtan(double x) { return radtodeg(atan(x)); }
+static double jitSinh(double x) { return radtodeg(sinh(degtorad(x))); }
+static double jitCosh(double x) { return radtodeg(cosh(degtorad(x))); }
+static double jitTanh(double x) { return radtodeg(tanh(degtorad(x))); }
+static double jitAsinh(double x) { return radtodeg(asinh(degtorad(x))); }
+static double jitAcosh(double x) { return radtodeg(acosh(degtorad(x))); }
+static double jitAtanh(double x) { return radtodeg(atanh(degtorad(x))); }
+static double jitInv(double x) { return 1.0 / x; }
+static double jitSqrtPower(double x) { return rootPower(x, 2); }
+static double jitCbrtPower(double x) { return rootPower(x, 3); }
+
+// Returns a random number for 'rand'
+static double jitRandom(const AstEvaluation *evaluation) {
+  return randomNumber(evaluation->randomState);
+}
+
+// Returns the factorial of x, reporting an error if it is negative
+static double jitFactorial(double x, const AstEvaluation *evaluation, uint32_t position) {
+  if (x < 0) {
+    evaluation->domainError(evaluation->context, position);
+    return 0;
+  }
+  return factorial(x);
+}
+
+// Returns the function called for a function node
+static double (*functionOf(Symbol type))(double) {
+  switch (type) {
+    case CBRT: return cbrt;
+    case LOG: return log10;
+    case LN: return log;
+    case SIN: return jitSin;
+    case COS: return jitCos;
+    case TAN: return jitTan;
+    case ASIN: return jitAsin;
+    case ACOS: return jitAcos;
+    case ATAN: return jitAtan;
+    case SINH: return jitSinh;
+    case COSH: return jitCosh;
+    case TANH: return jitTanh;
+    case ASINH: return jitAsinh;
+    case ACOSH: return jitAcosh;
+    case ATANH: return jitAtanh;
+    case DEGTORAD: return degtorad;
+    case RADTODEG: return radtodeg;
+    case FLOOR: return floor;
+    case CEIL: return ceil;
+    case ROUND: return round;
+    case INV: return jitInv;
+    case LOG1P: return log1p;
+    case EXPM1: return expm1;
+    default: return exp;
+  }
+}
+
+// Appends bytes of machine code
+static void emitBytes(Compiler *compiler, const unsigned char *bytes, size_t count) {
+  memcpy(compiler->code, bytes, count);
+  compiler->code += count;
+}
+
+// Appends an SSE instruction on xmm (reg) and a memory operand at base + 8 * index
+// prefix is 0xF2 for scalar doubles (e.g., addsd), 0x66 for packed ones (e.g., movapd).
+static void emitMemory(Compiler *compiler, unsigned char prefix, unsigned char opcode, int xmm, int base,
+                       int index) {
+  uint32_t displacement = (uint32_t) index * 8;
+  unsigned char bytes[] = {prefix, 0x0F, opcode, (unsigned char) (0x80 | xmm << 3 | base),
+                           (unsigned char) displacement, (unsigned char) (displacement >> 8),
+                           (unsigned char) (displacement >> 16), (unsigned char) (displacement >> 24)};
+  emitBytes(compiler, bytes, sizeof(bytes));
+}
+
+// Appends an SSE instruction on two xmm registers (destination = destination (operation) source)
+static void emitRegisters(Compiler *compiler, unsigned char prefix, unsigned char opcode, int destination,
+                          int source) {
+  unsigned char bytes[] = {prefix, 0x0F, opcode, (unsigned char) (0xC0 | destination << 3 | source)};
+  emitBytes(compiler, bytes, sizeof(bytes));
+}
+
+// Appends an FMA3 instruction on scalar doubles: xmm, source and a memory operand at base + 8 * index,
+// combined as the opcode says (e.g., VFMADD231SD is xmm = source * memory + xmm)
+static void emitFusedMemory(Compiler *compiler, unsigned char opcode, int xmm, int source, int base, int index) {
+  uint32_t displacement = (uint32_t) index * 8;
+  // VEX prefix: 0F 38 opcode map, W1 (doubles), source register (inverted), 66 prefix
+  unsigned char bytes[] = {0xC4, 0xE2, (unsigned char) (0x80 | (~source & 15) << 3 | 0x01), opcode,
+                           (unsigned char) (0x80 | xmm << 3 | base), (unsigned char) displacement,
+                           (unsigned char) (displacement >> 8), (unsigned char) (displacement >> 16),
+                           (unsigned char) (displacement >> 24)};
+  emitBytes(compiler, bytes, sizeof(bytes));
+}
+
+// Opcodes of the SSE instructions used (after the 0x0F)
+#define MOVSD_LOAD 0x10
+#define MOVSD_STORE 0x11
+#define MOVAPD 0x28
+#define SQRTSD 0x51
+#define ANDPD 0x54
+#define XORPD 0x57
+#define ADDSD 0x58
+#define MULSD 0x59
+#define SUBSD 0x5C
+#define DIVSD 0x5E
+#define UCOMISD 0x2E
+#define SCALAR 0xF2
+#define PACKED 0x66
+
+// Opcodes of the FMA3 instructions used (after the VEX prefix)
+#define VFMADD132SD 0x99   // xmm = xmm * memory + source
+#define VFNMADD132SD 0x9D  // xmm = -(xmm * memory) + source
+#define VFMADD231SD 0xB9   // xmm = source * memory + xmm
+#define VFMSUB231SD 0xBB   // xmm = source * memory - xmm
+
+// Appends a call of a function (its arguments have to be in place already)
+static void emitCall(Compiler *compiler, const void *function) {
+  uint64_t address = (uint64_t) (uintptr_t) function;
+  unsigned char bytes[12] = {0x48, 0xB8};  // mov rax, address
+  memcpy(bytes + 2, &address, 8);
+  bytes[10] = 0xFF;                        // call rax
+  bytes[11] = 0xD0;
+  emitBytes(compiler, bytes, sizeof(bytes));
+}
+
+// Appends moving the AstEvaluation into the first integer argument (mov rdi, r12)
+static void emitEvaluationArgument(Compiler *compiler) {
+  static const unsigned char bytes[] = {0x4C, 0x89, 0xE7};
+  emitBytes(compiler, bytes, sizeof(bytes));
+}
+
+// Adds a constant and returns its index
+static int addConstant(Compiler *compiler, double value) {
+  compiler->jit->constants[compiler->numConstants] = value;
+  return compiler->numConstants++;
+}
+
+// Makes room for a new value in xmm0 by storing the one there (if any) in its slot
+static void push(Compiler *compiler) {
+  if (compiler->depth > 0) {
+    emitMemory(compiler, SCALAR, MOVSD_STORE, 0, SLOTS, compiler->depth - 1);
+  }
+  compiler->depth++;
+  if (compiler->depth > compiler->maxDepth) {
+    compiler->maxDepth = compiler->depth;
+  }
+}
+
+// Returns the value of a constant node
+static double constantOf(const Ast *ast, const AstNode *node) {
+  return node->type == NUMBER ? ast->literals[node->left] : node->type == MATH_PI ? M_PI : M_E;
+}
+
+// Returns whether a node is a constant
+static bool isConstantNode(const AstNode *node) {
+  return node->type == NUMBER || node->type == MATH_PI || node->type == MATH_E;
+}
+
+// Returns the index (in the constants) of the value of a constant or LOAD_SHARED node, adding the
+// constant
+static int memoryOperand(Compiler *compiler, const AstNode *node) {
+  if (node->type == LOAD_SHARED) {
+    return NUM_FIXED_CONSTANTS + node->right;
+  }
+  return addConstant(compiler, constantOf(compiler->ast, node));
+}
+
+// Returns whether a node is a binary operator
+static bool isBinary(Symbol type) {
+  return type == ADD || type == MINUS || type == MULTIPLY || type == DIVIDE || type == MODULO || type == POWER ||
+         type == HYPOT;
+}
+
+// Returns whether the CPU has FMA3 instructions (and the OS saves the registers they use)
+static bool hasFma(void) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif
+}
+
+// Appends the code of a binary operator, with the left operand in xmm0 and the right one in
+// xmm1 (or, for ADD, MINUS, MULTIPLY and DIVIDE, in memory at base + 8 * index)
+static void emitOperator(Compiler *compiler, Symbol type, int base, int index) {
+  switch (type) {
+    case ADD: emitMemory(compiler, SCALAR, ADDSD, 0, base, index); break;
+    case MINUS: emitMemory(compiler, SCALAR, SUBSD, 0, base, index); break;
+    case MULTIPLY: emitMemory(compiler, SCALAR, MULSD, 0, base, index); break;
+    case DIVIDE: emitMemory(compiler, SCALAR, DIVSD, 0, base, index); break;
+    case MODULO: emitCall(compiler, (const void *) fmod); break;
+    case HYPOT: emitCall(compiler, (const void *) hypot); break;
+    default: emitCall(compiler, (const void *) power); break;
+  }
+}
+
+// Appends the code of a fused multiply-add, with x and y in their slots and z in xmm0 (see
+// applyFused())
+static void emitFused(Compiler *compiler, Symbol type) {
+  int x = compiler->depth - 3, y = compiler->depth - 2;
+  bool addendFirst = type == FUSED_ADD_MULTIPLY || type == FUSED_SUBTRACT_MULTIPLY;
+  if (compiler->fma) { // One instruction, with the operand that isn't in xmm0 or y's slot in xmm1
+    emitMemory(compiler, SCALAR, MOVSD_LOAD, 1, SLOTS, x);
+    switch (type) {
+      case FUSED_MULTIPLY_ADD: emitFusedMemory(compiler, VFMADD231SD, 0, 1, SLOTS, y); break;
+      case FUSED_MULTIPLY_SUBTRACT: emitFusedMemory(compiler, VFMSUB231SD, 0, 1, SLOTS, y); break;
+      case FUSED_ADD_MULTIPLY: emitFusedMemory(compiler, VFMADD132SD, 0, 1, SLOTS, y); break;
+      default: emitFusedMemory(compiler, VFNMADD132SD, 0, 1, SLOTS, y); break;
+    }
+  } else { // fma(xmm0, xmm1, xmm2), with the product's operands in xmm0 and xmm1
+    emitRegisters(compiler, PACKED, MOVAPD, addendFirst ? 1 : 2, 0);
+    emitMemory(compiler, SCALAR, MOVSD_LOAD, 0, SLOTS, addendFirst ? y : x);
+    if (addendFirst) {
+      emitMemory(compiler, SCALAR, MOVSD_LOAD, 2, SLOTS, x);
+    } else {
+      emitMemory(compiler, SCALAR, MOVSD_LOAD, 1, SLOTS, y);
+    }
+    if (type == FUSED_MULTIPLY_SUBTRACT || type == FUSED_SUBTRACT_MULTIPLY) { // Negate z or y
+      int negated = type == FUSED_MULTIPLY_SUBTRACT ? 2 : 0;
+      emitMemory(compiler, SCALAR, MOVSD_LOAD, 3, CONSTANTS, SIGN_MASK);
+      emitRegisters(compiler, PACKED, XORPD, negated, 3);
+    }
+    emitCall(compiler, (const void *) fma);
+  }
+  compiler->depth -= 2;
+}
+
+// Appends a call of the sum or product of the top count values (see applyReduction()), with the
+// last term in xmm0 and the others in their slots
+static void emitReduction(Compiler *compiler, Symbol type, int count) {
+  int first = compiler->depth - count;
+  uint32_t displacement = (uint32_t) first * 8;
+  unsigned char bytes[12] = {0x48, 0x8D, 0xBB};  // lea rdi, [rbx + displacement] (the first term's slot)
+  memcpy(bytes + 3, &displacement, 4);
+  bytes[7] = 0xBE;                               // mov esi, count
+  memcpy(bytes + 8, &count, 4);
+  emitMemory(compiler, SCALAR, MOVSD_STORE, 0, SLOTS, compiler->depth - 1);
+  emitBytes(compiler, bytes, sizeof(bytes));
+  emitCall(compiler, type == SUM ? (const void *) sumTerms :
+                     type == COMPENSATED_SUM ? (const void *) compensatedSum : (const void *) multiplyTerms);
+  compiler->depth = first + 1;
+}
+
+// Appends the code of a power with a constant integer exponent, with the base in xmm0
+// The loop of integerPower() is unrolled for positive exponents, with the powers of the base
+// squared in xmm0 and the product of the ones used so far in xmm1. Multiplications by the 1 it
+// starts with are exact, so they are left out. Negative exponents call integerPower(), which needs
+// the base again for pow() when the positive power isn't normal.
+static void emitIntegerPower(Compiler *compiler, int exponent) {
+  if (exponent < 0) { // integerPower(xmm0, exponent)
+    unsigned char bytes[5] = {0xBF};  // mov edi, exponent
+    memcpy(bytes + 1, &exponent, 4);
+    emitBytes(compiler, bytes, sizeof(bytes));
+    emitCall(compiler, (const void *) integerPower);
+    return;
+  }
+  unsigned n = (unsigned) exponent;
+  if (n == 0) {
+    emitMemory(compiler, SCALAR, MOVSD_LOAD, 0, CONSTANTS, addConstant(compiler, 1));
+    return;
+  }
+  bool started = false;  // Whether xmm1 holds a product yet
+  while (n > 0) {
+    if (n == 1 && started) { // The last multiplication leaves the result in xmm0
+      emitRegisters(compiler, SCALAR, MULSD, 0, 1);
+    } else if (n > 1 && (n & 1)) {
+      emitRegisters(compiler, started ? SCALAR : PACKED, started ? MULSD : MOVAPD, 1, 0);
+      started = true;
+    }
+    n >>= 1;
+    if (n > 0) {
+      emitRegisters(compiler, SCALAR, MULSD, 0, 0);
+    }
+  }
+}
+
+// Appends the code of a square root of xmm0 as a power (sqrtsd for a positive base, or a call of
+// rootPower() for the others)
+static void emitSqrtPower(Compiler *compiler) {
+  static const unsigned char skipSqrt[] = {0x76, 6};   // jbe +6 (xmm0 ≤ 0 or NaN)
+  static const unsigned char skipCall[] = {0xEB, 12};  // jmp +12
+  emitRegisters(compiler, PACKED, XORPD, 1, 1);
+  emitRegisters(compiler, PACKED, UCOMISD, 0, 1);
+  emitBytes(compiler, skipSqrt, sizeof(skipSqrt));
+  emitRegisters(compiler, SCALAR, SQRTSD, 0, 0);
+  emitBytes(compiler, skipCall, sizeof(skipCall));
+  emitCall(compiler, (const void *) jitSqrtPower);
+}
+
+// Appends the code of a node (its operands' code has to be appended already)
+static void compileNode(Compiler *compiler, int index) {
+  const Ast *ast = compiler->ast;
+  const AstNode *node = &ast->nodes[index];
+  Symbol type = node->type;
+  switch (type) {
+    case NUMBER: case MATH_PI: case MATH_E: case LOAD_SHARED:
+      if (!compiler->folded[index]) {
+        push(compiler);
+        emitMemory(compiler, SCALAR, MOVSD_LOAD, 0, CONSTANTS, memoryOperand(compiler, node));
+      }
+      break;
+    case STORE_SHARED: // Keep the value in xmm0 too
+      emitMemory(compiler, SCALAR, MOVSD_STORE, 0, CONSTANTS, NUM_FIXED_CONSTANTS + node->right);
+      break;
+    case RAND_NUM:
+      push(compiler);
+      emitEvaluationArgument(compiler);
+      emitCall(compiler, (const void *) jitRandom);
+      break;
+    case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER: case HYPOT:
+      if (compiler->folded[node->right]) { // The left operand is in xmm0, the right one is in memory
+        const AstNode *right = &ast->nodes[node->right];
+        if (type == POWER && isConstantNode(right) && constantOf(ast, right) == 2) { // x^2 is x * x (see power())
+          emitRegisters(compiler, SCALAR, MULSD, 0, 0);
+        } else if (type == MODULO || type == POWER || type == HYPOT) {
+          emitMemory(compiler, SCALAR, MOVSD_LOAD, 1, CONSTANTS, memoryOperand(compiler, right));
+          emitOperator(compiler, type, 0, 0);
+        } else {
+          emitOperator(compiler, type, CONSTANTS, memoryOperand(compiler, right));
+        }
+      } else { // The left operand is in its slot, the right one in xmm0
+        int slot = compiler->depth - 2;
+        if (type == ADD || type == MULTIPLY) { // Commutative (with the same rounding)
+          emitOperator(compiler, type, SLOTS, slot);
+        } else {
+          emitRegisters(compiler, PACKED, MOVAPD, 1, 0);
+          emitMemory(compiler, SCALAR, MOVSD_LOAD, 0, SLOTS, slot);
+          if (type == MODULO || type == POWER || type == HYPOT) {
+            emitOperator(compiler, type, 0, 0);
+          } else {
+            emitRegisters(compiler, SCALAR, type == MINUS ? SUBSD : DIVSD, 0, 1);
+          }
+        }
+        compiler->depth--;
+      }
+      break;
+    case OPERAND_PAIR: // Both values stay on the stack for the fused operation (or the sum)
+      break;
+    case FUSED_MULTIPLY_ADD: case FUSED_MULTIPLY_SUBTRACT: case FUSED_ADD_MULTIPLY: case FUSED_SUBTRACT_MULTIPLY:
+      emitFused(compiler, type);
+      break;
+    case SUM: case COMPENSATED_SUM: case PRODUCT:
+      emitReduction(compiler, type, node->right);
+      break;
+    case NEGATE: // Flip the sign bit
+      emitMemory(compiler, SCALAR, MOVSD_LOAD, 1, CONSTANTS, SIGN_MASK);
+      emitRegisters(compiler, PACKED, XORPD, 0, 1);
+      break;
+    case ABS: // Clear the sign bit
+      emitMemory(compiler, SCALAR, MOVSD_LOAD, 1, CONSTANTS, ABS_MASK);
+      emitRegisters(compiler, PACKED, ANDPD, 0, 1);
+      break;
+    case SQRT: // Correctly rounded, like sqrt()
+      emitRegisters(compiler, SCALAR, SQRTSD, 0, 0);
+      break;
+    case INTEGER_POWER:
+      emitIntegerPower(compiler, node->right);
+      break;
+    case ROOT_POWER:
+      if (node->right == 2) {
+        emitSqrtPower(compiler);
+      } else {
+        emitCall(compiler, (const void *) jitCbrtPower);
+      }
+      break;
+    case FACTORIAL: { // jitFactorial(xmm0, evaluation, position)
+      uint32_t position = ast->positions[index];
+      unsigned char bytes[5] = {0xBE};  // mov esi, position
+      memcpy(bytes + 1, &position, 4);
+      emitEvaluationArgument(compiler);
+      emitBytes(compiler, bytes, sizeof(bytes));
+      emitCall(compiler, (const void *) jitFactorial);
+      break;
+    }
+    default: // Functions
+      emitCall(compiler, (const void *) functionOf(type));
+      break;
+  }
+}
+
+bool compileJit(const Ast *ast, int root, JitCode *jit, Arena *arena) {
+  static const unsigned char prologue[] = {
+      0x53,              // push rbx
+      0x55,              // push rbp
+      0x41, 0x54,        // push r12 (the stack is aligned to 16 bytes for calls after these)
+      0x48, 0x89, 0xFB,  // mov rbx, rdi (slots)
+      0x48, 0x89, 0xF5,  // mov rbp, rsi (constants)
+      0x49, 0x89, 0xD4,  // mov r12, rdx (evaluation)
+  };
+  static const unsigned char epilogue[] = {
+      0x41, 0x5C,        // pop r12
+      0x5D,              // pop rbp
+      0x5B,              // pop rbx
+      0xC3,              // ret
+  };
+
+  jit->code = NULL;
+  jit->constants = arenaAllocate(arena, (ast->numNodes + NUM_FIXED_CONSTANTS + ast->numShared) * sizeof(double));
+  unsigned char *folded = arenaAllocate(arena, ast->numNodes);
+  int32_t *order = arenaAllocate(arena, ast->numNodes * sizeof(int32_t));
+  int32_t *work = arenaAllocate(arena, 2 * ast->numNodes * sizeof(int32_t));
+  if (jit->constants == NULL || folded == NULL || order == NULL || work == NULL) {
+    return false;
+  }
+
+  // Map pages for the code, writable while it is generated and executable afterwards
+  long pageSize = sysconf(_SC_PAGESIZE);
+  size_t size = sizeof(prologue) + sizeof(epilogue) + (size_t) ast->numNodes * MAX_NODE_BYTES;
+  size = (size + pageSize - 1) / pageSize * pageSize;
+  void *code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    return false;
+  }
+  jit->code = code;
+  jit->size = size;
+
+  // Constants and shared values that are the right operand of a binary operator are read by its
+  // instruction
+  int numNodes = astPostOrder(ast, root, order, work);
+  memset(folded, 0, ast->numNodes);
+  for (int i = 0; i < numNodes; i++) {
+    const AstNode *node = &ast->nodes[order[i]];
+    const AstNode *right = isBinary(node->type) ? &ast->nodes[node->right] : NULL;
+    if (right != NULL && (isConstantNode(right) || right->type == LOAD_SHARED)) {
+      folded[node->right] = 1;
+    }
+  }
+
+  uint64_t signMask = 0x8000000000000000ULL, absMask = 0x7FFFFFFFFFFFFFFFULL;
+  memcpy(&jit->constants[SIGN_MASK], &signMask, sizeof(double));
+  memcpy(&jit->constants[ABS_MASK], &absMask, sizeof(double));
+  Compiler compiler = {ast, jit, code, folded, NUM_FIXED_CONSTANTS + ast->numShared, 0, 0, hasFma()};
+  emitBytes(&compiler, prologue, sizeof(prologue));
+  for (int i = 0; i < numNodes; i++) {
+    compileNode(&compiler, order[i]);
+  }
+  emitBytes(&compiler, epilogue, sizeof(epilogue));
+
+  jit->slots = arenaAllocate(arena, compiler.maxDepth * sizeof(double));
+  if (jit->slots == NULL || mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+    releaseJit(jit);
+    return false;
+  }
+  return true;
+}
+
+double runJit(const JitCode *jit, const AstEvaluation *evaluation) {
+  JitFunction function = (JitFunction) (uintptr_t) jit->code;
+  return function(jit->slots, jit->constants, evaluation);
+}
+
+void releaseJit(JitCode *jit) {
+  if (jit->code != NULL) {
+    munmap(jit->code, jit->size);
+    jit->code = NULL;
+  }
+}
+
+#else // No machine code on other architectures
+
+bool compileJit(const Ast *ast, int root, JitCode *jit, Arena *arena) {
+  (void) ast;
+  (void) root;
+  (void) arena;
+  jit->code = NULL;
+  return false;
+}
+
+double runJit(const JitCode *jit, const AstEvaluation *evaluation) {
+  (void) jit;
+  (void) evaluation;
+  return 0;
+}
+
+void releaseJit(JitCode *jit) {
+  (void) jit;
+}
+
+#endif // JIT_SUPPORTED
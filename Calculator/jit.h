@@ -0,0 +1,40 @@
+// Justin Chen
+// Native machine code compiled from syntax trees (x86-64 only)
+
+#ifndef CALCULATOR_JIT_H
+#define CALCULATOR_JIT_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <stddef.h>   // Sizes (size_t)
+#include "ast.h"      // Syntax trees (Ast, AstEvaluation)
+#include "arena.h"    // Memory of the compiled code's data (Arena)
+
+// Machine code is only generated for x86-64 with the System V calling convention (Linux, macOS,
+// the BSDs). Elsewhere compileJit() fails and another backend has to be used.
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_SUPPORTED
+#endif
+
+// Define struct JitCode
+// A compiled expression in machine code. The code is in pages of its own (see releaseJit()),
+// and the data it uses is allocated from an arena.
+typedef struct JitCode {
+    void *code;                // Executable pages (NULL if none)
+    size_t size;               // Number of bytes of the pages
+    double *constants;         // Values of the constants the code loads (and of repeated subexpressions)
+    double *slots;             // Values of operands that are waiting for the operation that uses them
+} JitCode;
+
+// Compiles the tree with its root at index into machine code.
+// Returns false if machine code can't be generated here (see JIT_SUPPORTED) or if out of memory.
+bool compileJit(const Ast *ast, int root, JitCode *jit, Arena *arena);
+
+// Runs compiled machine code and returns the result
+// The operations are done in the same order and rounded the same way as evaluateAst() does them,
+// so the results (and the random numbers and errors) are the same.
+double runJit(const JitCode *jit, const AstEvaluation *evaluation);
+
+// Frees the pages of compiled machine code (does nothing if there are none)
+void releaseJit(JitCode *jit);
+
+#endif // CALCULATOR_JIT_H
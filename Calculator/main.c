@@ -6,62 +6,17 @@
 #include <string.h>   // String functions (strcspn(), strstr(), strlen(), strncpy(), strcpy())
 #include <stdbool.h>  // Define booleans (bool, true, false)
 #include <ctype.h>    // Lowercase character function tolower()
-#include <stdlib.h>   // Standard library (system(), strtod(), malloc())
+#include <stdlib.h>   // Standard library (system(), malloc(), free())
 #include <math.h>     // Math library (INFINITY, isnan(), pow())
+#include "calc.h"     // Compiling and evaluating expressions (calcCompile(), calcEvaluate())
+#include "arena.h"    // Per-evaluation memory (arenaAllocate(), arenaReset())
 
 #if defined(WIN32)        // Add support for thread sleeping in Windows
 #include <windows.h>
 #else
-#include <unistd.h>     // Thread sleep function (usleep())
+#include <unistd.h>     // Thread sleep function (usleep()), close()
 #endif
-
-#ifndef M_PI // Define pi if not defined previously in math.h header
-#define M_PI 3.14159265358979323846
-#endif
-
-#ifndef M_E // Define e if not defined previously in math.h header
-#define M_E 2.71828182845904523536
-#endif
-
-// Define enumeration containing labels for various different token types
-typedef enum Symbol {
-    NUMBER,                     // Numerical values (RegExp [0-9.])
-    ADD, MINUS,                 // Addition [+] and subtraction [-]
-    DIVIDE, MULTIPLY,           // Division [/] and multiplication [*]
-    MODULO,                     // Modulo (%)
-    POWER, FACTORIAL,           // Exponentiation [^] and factorials [!]
-    MATH_PI, MATH_E,            // π and e
-    EXP,                        // e^x
-    RAND_NUM,                   // obtain random number
-    SQRT,                       // performs square root ('sqrt')
-    CBRT,                       // performs cube root ('cbrt')
-    LOG,                        // performs logarithm ('log')
-    LN,                         // performs natural logarithm ('ln')
-    SIN, COS, TAN,              // performs trigonometric functions ('sin', 'cos', 'tan') IN DEGREES
-    ASIN, ACOS, ATAN,           // performs inverse trigonometric functions ('asin', 'acos', 'atan')
-    SINH, COSH, TANH,           // performs hyperbolic trigonometric functions ('sinh', 'cosh', 'tanh')
-    ASINH, ACOSH, ATANH,        // performs inverse hyperbolic trigonometric functions ('asinh', 'acosh', 'atanh')
-    ABS,                        // performs absolute value ('abs')
-    DEGTORAD, RADTODEG,         // performs conversion between degrees and radians ('degtorad', 'radtodeg')
-    FLOOR, CEIL, ROUND,         // performs floor, ceil and round functions ('floor', 'ceil', 'round')
-    INV,                        // performs 1/x ('inv')
-    PASS_TOKEN,                 // Ignore this token space
-    START_BRACKET, END_BRACKET, // Parentheses [(], [)]
-    IDENTIFIER,                 // Function/constant names
-    END_OF_EXPRESSION           // End of user expression
-} Symbol;
-
-// Define struct Token
-// Tokens hold more information about themselves than the Symbol type.
-// Each token has a string value (that represents their value in the user expression),
-// type, and binding power. The larger the binding power, the higher the precedence the operator has.
-// Note that binding power is only assigned to operator tokens.
-// To create a token, call initToken().
-typedef struct Token {
-    const char *value;
-    Symbol type;
-    int bindingPower;
-} Token;
+#include <fcntl.h>        // Opening files for streaming (open())
 
 // Function prototype declarations.
 // Small utility functions
@@ -71,81 +26,27 @@ void boldBlue();        // Change text color to bold blue/cyan
 void green();           // Change text color to green
 void boldRed();         // Change text color to bold red for error messages
 void purple();          // Change text color to purple
-void error(char *str, int index);  // Change text color to bold red and print an error message, changes hadError to true
+void error(const char *str, const char *exp, long long position); // Change text color to bold red and print an error message
 void type(const char *str);   // Types out a message character by character
+void typeSpan(const char *str, int length); // Types out the first length characters of a message
 
 // De-clutter main() method (code ported off into a method)
 void printHelpManual(); // prints help manual
-bool evaluateExpression(); // evaluates expression stored in userExp
+bool evaluateExpression(char *userExp, unsigned long long seed); // evaluates the user's expression (or command)
+bool printResult(double result); // prints the result of an expression (or why it can't be printed)
+void printErrors(const CalcErrors *errors, const char *exp); // prints the errors found in an expression
+void reportMemoryUsage(const CalcExpression *expression); // prints how much memory an evaluation used (if built with ARENA_REPORT)
+bool evaluateStream(const char *path); // evaluates an expression of any length read from a file
+bool evaluateCompiledFile(const char *path); // evaluates each line of a file, compiled to native code
 
 // Helper functions
 char *lowercase(char *str);                    // converts string to lowercase
-double factorial(double left);                 // returns factorial of value
-double integerFactorial(double left);          // returns factorial of integer ≥0
-double spouge(double z);                       // implementation of Spouge approximation for factorials
-Token initToken(const char *val, Symbol ty);   // creates a token and returns to callee
-Token advance();                               // advances and returns tokens, used during expression parsing
-void resetGlobalVariables();                   // reset global variables to default values
 void stripTrailingZeros(char *str);            // remove trailing 0s from result when printing
 void stripTrailingZerosScientificNotation(char *str); // remove trailing 0s in result expressed in scientific notation.
-bool match(const char *value, char *anotherValue);   // checks if two values match
-void omitToken(int index);                     // removes token at index + 1 from expression
-double degtorad(double degrees);                     // converts degrees to radians
-double radtodeg(double radians);                     // converts radians to degrees
-
-// Small validation functions
-bool isBlank(char *string);      // checks if a string only contains blank spaces
-bool isNumeric(char c);          // checks if character is a digit from 0 to 9
-bool isAlpha(char c);            // checks if character is alphabet from a to z
-
-// Validation functions
-void checkParenthesesMatch(char *inputString); // checks if parentheses '()' match throughout expression
-void checkExpressionValidity();                // checks if expression contains *only* valid characters
-
-// Tokenization functions - converts user expression to a list of tokens
-void tokenize(char *exp);           // tokenizes user expression
-void tokenizeNumber();              // tokenizes a number token
-void tokenizeAlpha();               // tokenizes an identifier for a constant/function
-void tokenizeFunction(int index, const char *tempTokenValue); // tokenizes a function token
-int findNumberOfTokens(char *exp);  // counts the number of tokens in the expression
-
-// Pratt-parsing specific functions
-double expression(int bindingPower);       // evaluates expression at current binding power
-double led(Token tempToken, double left);  // left-denotation - evaluates binary expressions
-double nud(Token tempToken);               // null-denotation - evaluates unary expressions
-
-// Global variables
-// Stores whether an error occurred
-bool hadError = false;
-
-// Stores which stage currently in when error occurred
-// false - before tokenize stage or during parsing stage
-// true - during tokenize stage
-bool inTokenizeStage = false;
-
-// Stores the number of errors
-// If there are more than 5 errors, the rest are omitted.
-int numErrors = 0;
-
-// Stores the index of the start of a token
-int start = 0;
-
-// Stores the index of the currently being parsed character
-int current = 0;
-
-// Stores the index of the token that will be parsed
-int parseCurrent = 0;
-
-// Token array
-// Note the max is 1024 because userExp has a max of 1024, and the max number of tokens
-// would therefore be 1024 (one token is at least one character long)
-Token tokens[1024];
-
-// Stores the token to be parsed by expression()
-Token token;
 
-// Stores the user's expression
-char userExp[1024];
+// Memory for what is printed about an evaluation (the caret under an error), reset before each
+// evaluation (the compiled expression has an arena of its own, see calc.c)
+Arena arena;
 
 int main(int argc, char **argv) {
   if (argc == 1) {
@@ -164,12 +65,12 @@ int main(int argc, char **argv) {
 
     // Keep asking for user input until they type a message containing 'exit' or
     // forcefully terminate the program.
+    char userExp[1024];
+    bool running;
+    // Each expression's 'rand' numbers are seeded with the number of expressions before it,
+    // so that they don't repeat from one expression to the next.
+    unsigned long long numExpressions = 0;
     do {
-      // Reset all global variables
-      // These variables have values that change depending on what the user enters during
-      // each iteration of the while loop.
-      resetGlobalVariables();
-
       // Ask for user input in purple
       purple();
       type("> ");
@@ -184,22 +85,36 @@ int main(int argc, char **argv) {
       // Play a beep sound
       beep();
 
-    } while (evaluateExpression());
+      running = evaluateExpression(userExp, numExpressions++);
+    } while (running);
+    arenaRelease(&arena);
+  } else if (argc == 3 && strcmp(argv[1], "--stream") == 0) {
+    // Evaluate an expression read from a file (or stdin if the path is '-')
+    return evaluateStream(argv[2]) ? 0 : 1;
+  } else if (argc == 3 && strcmp(argv[1], "--compile") == 0) {
+    // Evaluate each expression of a file, compiled by the C compiler (and cached)
+    return evaluateCompiledFile(argv[2]) ? 0 : 1;
   } else {
     // Get input from command line arguments
     // Concatenate all arguments into a single string (as each
     // argument is delimited by a ' ')
+    size_t length = 1;
+    for (int i = 1; i < argc; i++) {
+      length += strlen(argv[i]) + 1;
+    }
+    char *userExp = malloc(length);
+    userExp[0] = '\0';
     for (int i = 1; i < argc; i++) {
       strcat(userExp, argv[i]);
       strcat(userExp, " ");
     }
-    evaluateExpression();
+    evaluateExpression(userExp, 0);
+    free(userExp);
+    arenaRelease(&arena);
   }
 }
 
-bool evaluateExpression() {
-  inTokenizeStage = true;
-
+bool evaluateExpression(char *userExp, unsigned long long seed) {
   // If the user inputs a message containing the word 'exit', say goodbye and terminate program.
   if (strstr(lowercase(userExp), "exit") != NULL) {
     blue();
@@ -215,80 +130,201 @@ bool evaluateExpression() {
     return true;
   }
 
-  // Check if user expression has matching parentheses (e.g., parentheses are in pairs)
-  checkParenthesesMatch(userExp);
+  // If the user's expression is empty, then ask for input again.
+  if (userExp[strspn(userExp, " \t")] == '\0') {
+    return true;
+  }
 
-  // If the expression doesn't have matching parentheses, then exit the current iteration
-  // and ask for user input again.
-  if (hadError) {
+  // Compile the expression (tokenize and validate it), then evaluate it
+  // If either fails, print why and ask for input again.
+  arenaReset(&arena);
+  CalcErrors errors;
+  CalcExpression *expression = calcCompile(userExp, &errors);
+  if (expression == NULL) {
+    printErrors(&errors, userExp);
     return true;
   }
+  calcSetSeed(expression, seed);
 
-  // Tokenize the user's expression
-  tokenize(userExp);
+  double result;
+  if (calcEvaluate(expression, &result, &errors)) {
+    printResult(result);
+  } else {
+    printErrors(&errors, userExp);
+  }
+  reportMemoryUsage(expression);
+  calcFree(expression);
+  return true;
+}
+
+// Prints the result of an expression up to 9 d.p.
+// Results that are ±∞ or NaN are reported as errors instead (and false is returned).
+bool printResult(double result) {
+  // If the result is ±∞, notify the user
+  if (result == INFINITY || result == -INFINITY) {
+    error("Result reached positive/negative infinity.", NULL, -1);
+    error("Hint: this may be because of double factorials (e.g., '5!!'), exponentiation or divide by 0.", NULL, -1);
+    return false;
+  } else if (isnan(result)) { // If the result is NaN, notify the user
+    error("Result is not a number.", NULL, -1);
+    error("Hint: this may be because of divide by 0.", NULL, -1);
+    error("Hint: this may be because result is imaginary or complex.", NULL, -1);
+    return false;
+  }
 
-  // Check tokens are valid
-  checkExpressionValidity();
+  // If no error occurred, then print the result up to 9 d.p.
+  // Final result string will be at most 1024 characters
+  // This won't be reached because double value range is <1E1024
+  char resultString[1024];
 
-  // If they aren't, exit the current iteration and ask for input again
-  if (hadError) {
-    return true;
+  if (result > 1e16 || result < -1e16 || (result > -1e-16 && result < 1e-16 && result != 0)) {
+    // If the result is bigger than 1e16 or less than -1e16,
+    // or the result is between -1e-16 and 1e-16,
+    // express the result in approximated scientific notation, as
+    // C floating-point arithmetic isn't very accurate in these ranges.
+    sprintf(resultString, "%.9e", result);
+
+    // Remove unnecessary 0s in scientific notation
+    stripTrailingZerosScientificNotation(resultString);
+  } else {
+    // Format the string to 9 d.p.
+    // Note that whole numbers and numbers that fit in less than 9 d.p. are also formatted
+    // into 9 d.p. (by adding trailing 0s)
+    sprintf(resultString, "%.9f", result);
+
+    // Call a function that removes the trailing 0s.
+    stripTrailingZeros(resultString);
   }
 
-  // If the user's expression doesn't have any tokens (it is empty), then ask for input again.
-  // If an error occurred during tokenization, don't try to parse it.
-  if (findNumberOfTokens(userExp) == 0 || hadError) {
-    return true;
+  // Type the final result
+  blue();
+  type(resultString);
+  type("\n\n");
+  return true;
+}
+
+// Prints the errors found in an expression, pointing at where each one is in it
+// If there are more than CALC_MAX_ERRORS errors, the rest are omitted.
+void printErrors(const CalcErrors *errors, const char *exp) {
+  int numErrors = errors->numErrors < CALC_MAX_ERRORS ? errors->numErrors : CALC_MAX_ERRORS;
+  for (int i = 0; i < numErrors; i++) {
+    error(errors->errors[i].message, exp, errors->errors[i].position);
+  }
+  if (errors->numErrors > CALC_MAX_ERRORS) {
+    boldRed();
+    type("Too many errors identified, please fix the ones pointed out first.\n\n");
+  }
+}
+
+// Evaluates an expression read from a file with calcEvaluateStream()
+// The expression can be of any length, and may span multiple lines.
+// Returns false if it couldn't be evaluated.
+bool evaluateStream(const char *path) {
+  int fd = strcmp(path, "-") == 0 ? fileno(stdin) : open(path, O_RDONLY);
+  if (fd < 0) {
+    char errorMessage[1024];
+    sprintf(errorMessage, "Unable to open '%.900s'.", path);
+    error(errorMessage, NULL, -1);
+    return false;
   }
 
-  // Let token be the first token in the list of tokens
-  token = tokens[parseCurrent];
-
-  // Start the parsing section with binding power 0.
-  // After recursing through the entire expression, the final result will be in here.
-  inTokenizeStage = false;
-  double result = expression(0);
-
-  if (!hadError) {
-    // If the result is ±∞, notify the user
-    if (result == INFINITY || result == -INFINITY) {
-      error("Result reached positive/negative infinity.", -1);
-      error("Hint: this may be because of double factorials (e.g., '5!!'), exponentiation or divide by 0.", -1);
-    } else if (isnan(result)) { // If the result is NaN, notify the user
-      error("Result is not a number.", -1);
-      error("Hint: this may be because of divide by 0.", -1);
-      error("Hint: this may be because result is imaginary or complex.", -1);
-    } else { // If no error occurred, then print the result up to 9 d.p.
-      // Final result string will be at most 1024 characters
-      // This won't be reached because double value range is <1E1024
-      char resultString[1024];
-
-      if (result > 1e16 || result < -1e16 || (result > -1e-16 && result < 1e-16 && result != 0)) {
-        // If the result is bigger than 1e16 or less than -1e16,
-        // or the result is between -1e-16 and 1e-16,
-        // express the result in approximated scientific notation, as
-        // C floating-point arithmetic isn't very accurate in these ranges.
-        sprintf(resultString, "%.9e", result);
-
-        // Remove unnecessary 0s in scientific notation
-        stripTrailingZerosScientificNotation(resultString);
-      } else {
-        // Format the string to 9 d.p.
-        // Note that whole numbers and numbers that fit in less than 9 d.p. are also formatted
-        // into 9 d.p. (by adding trailing 0s)
-        sprintf(resultString, "%.9f", result);
-
-        // Call a function that removes the trailing 0s.
-        stripTrailingZeros(resultString);
+  double result;
+  CalcErrors errors;
+  bool evaluated = calcEvaluateStream(fd, &result, &errors);
+  if (fd != fileno(stdin)) {
+    close(fd);
+  }
+
+  if (!evaluated) {
+    // The expression isn't kept, so the error is located by its character number instead
+    char errorMessage[1024];
+    if (errors.errors[0].position >= 0) {
+      sprintf(errorMessage, "%s (at character %lld)", errors.errors[0].message, errors.errors[0].position + 1);
+    } else {
+      sprintf(errorMessage, "%s", errors.errors[0].message);
+    }
+    error(errorMessage, NULL, -1);
+    return false;
+  }
+
+  return printResult(result);
+}
+
+// Evaluates each line of a file (a set of formulas), compiled with CALC_BACKEND_NATIVE
+// Each expression is compiled into a shared object by the C compiler the first time it is seen;
+// after that, the cached one is loaded. As in the prompt, each expression's 'rand' numbers are
+// seeded with the number of expressions before it. Blank lines are skipped.
+// Returns false if the file couldn't be read or an expression couldn't be evaluated.
+bool evaluateCompiledFile(const char *path) {
+  FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (file == NULL) {
+    char errorMessage[1024];
+    sprintf(errorMessage, "Unable to open '%.900s'.", path);
+    error(errorMessage, NULL, -1);
+    return false;
+  }
+
+  CalcOptions options = {CALC_BACKEND_NATIVE};
+  bool passed = true;
+  unsigned long long numExpressions = 0;
+  size_t capacity = 1024;
+  char *line = malloc(capacity);
+  while (fgets(line, (int) capacity, file) != NULL) {
+    // Read the rest of a line that didn't fit
+    size_t length = strlen(line);
+    while (length > 0 && line[length - 1] != '\n' && !feof(file)) {
+      capacity *= 2;
+      line = realloc(line, capacity);
+      if (fgets(line + length, (int) (capacity - length), file) == NULL) {
+        break;
       }
+      length += strlen(line + length);
+    }
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[strspn(line, " \t")] == '\0') {
+      continue;
+    }
+
+    arenaReset(&arena);
+    CalcErrors errors;
+    CalcExpression *expression = calcCompileWithOptions(line, &options, &errors);
+    if (expression == NULL) {
+      printErrors(&errors, line);
+      passed = false;
+      continue;
+    }
+    calcSetSeed(expression, numExpressions++);
 
-      // Type the final result
-      blue();
-      type(resultString);
-      type("\n\n");
+    double result;
+    if (calcEvaluate(expression, &result, &errors)) {
+      passed = printResult(result) && passed;
+    } else {
+      printErrors(&errors, line);
+      passed = false;
     }
+    calcFree(expression);
   }
-  return true;
+  free(line);
+  arenaRelease(&arena);
+  if (file != stdin) {
+    fclose(file);
+  }
+  return passed;
+}
+
+// Prints the memory held by a compiled expression, and the memory used for printing this
+// evaluation and the most any evaluation has used for it
+// Only enabled in builds with ARENA_REPORT defined (cmake -DARENA_REPORT=ON).
+void reportMemoryUsage(const CalcExpression *expression) {
+#ifdef ARENA_REPORT
+  char report[160];
+  sprintf(report, "Memory: %zu bytes held by the expression, %zu bytes used for printing, %zu bytes at most\n\n",
+          calcMemoryUsage(expression), arena.used, arena.highWaterMark);
+  green();
+  type(report);
+#else
+  (void) expression;
+#endif
 }
 
 void stripTrailingZerosScientificNotation(char *str) {
@@ -300,8 +336,9 @@ void stripTrailingZerosScientificNotation(char *str) {
   }
 
   // Preserve the 'e____' part (10^____) that will be concatenated afterwards.
-  char *magnitude = malloc(strlen(str));
-  strncpy(magnitude, str + maxIndex, strlen(str) - maxIndex);
+  // Note that the exponent of a double has at most 3 digits.
+  char magnitude[16];
+  snprintf(magnitude, sizeof(magnitude), "%s", str + maxIndex);
 
   // Find where the decimal point '.' is (if there is one)
   int decimalIndex = -1;
@@ -367,660 +404,6 @@ void stripTrailingZeros(char *str) {
   }
 }
 
-// Set global variables to default values
-void resetGlobalVariables() {
-  hadError = false;
-  inTokenizeStage = false;
-  numErrors = 0;
-  parseCurrent = 0;
-  current = 0;
-  start = 0;
-  token = initToken("", END_OF_EXPRESSION);
-}
-
-// Left denotation - evaluates binary expressions
-double led(Token tempToken, double left) {
-  // When expression() calls this, note that it will have already
-  // consumed the left operand and operator.
-  switch (tempToken.type) { // Check the type of the operator
-    case ADD: // Addition
-      return left + expression(10);
-    case MINUS: // Subtraction
-      return left - expression(10);
-    case MULTIPLY: // Multiplication
-      return left * expression(20);
-    case DIVIDE: // Division
-      return left / expression(20);
-    case MODULO: // Modulo
-      return fmod(left, expression(20));
-    case POWER: // Exponentiation
-      // Note how the binding power is 30 - 1 not 30.
-      // This is because exponents are right-associative, so exponents on the rightmost
-      // need to be evaluated first (thus having higher precedence than binding power 29)
-      return pow(left, expression(30 - 1));
-    case FACTORIAL: // Factorials
-      return factorial(left);
-    default: // This should never happen, but if it does, handle the error.
-      error("Unable to parse expression.", parseCurrent);
-      return 0;
-  }
-}
-
-// Performs factorial on integer values ≥0
-double integerFactorial(double left) {
-  double result = 1;
-  for (int i = 1; i <= left; i++) {
-    result *= i;
-  }
-  return result;
-}
-
-// Implementation of Spouge approximation of factorials
-// See https://en.wikipedia.org/wiki/Spouge%27s_approximation
-// Note: ε_a(z) was discarded, error because of discarding the term is small.
-double spouge(double z) {
-  int a = 15;
-  double result = pow(z + a, z + 0.5) * pow(M_E, -(z + a));
-  double prodValue = sqrt(2 * M_PI);
-  for (int k = 1; k <= a - 1; k++) {
-    prodValue += ((pow(-1, k - 1) / (integerFactorial(k - 1))) * pow(-k + a, k - 0.5) * pow(M_E, -k + a)) / (z + k);
-  }
-  result *= prodValue;
-  return result;
-}
-
-// Hand-implemented factorial calculator
-double factorial(double left) {
-  if (left < 0) {
-    error("Factorial is only defined for non-negative numbers.", parseCurrent);
-    return 0;
-  }
-
-  double result;
-  if (floor(left) == left) {
-    result = integerFactorial(left);
-  } else {
-    result = spouge(left);
-  }
-  return result;
-}
-
-// Null denotation - evaluates unary expressions
-double nud(Token tempToken) {
-  switch (tempToken.type) { // Check the type of the token
-    case NUMBER: // if it is a number, simply parse token.value into a double
-      return strtod(tempToken.value, NULL);
-    case MATH_PI: // π
-      return M_PI;
-    case MATH_E:  // exp
-      return M_E;
-    case RAND_NUM: // returns random number
-      return ((double) rand()) / RAND_MAX;
-    case MINUS: // Negation
-      // Note that negation has higher precedence than subtraction, and therefore
-      // the binding power is higher.
-      return -expression(25);
-    case START_BRACKET: { // Evaluate expressions in parentheses
-      double val = expression(0);
-      if (tokens[parseCurrent].type != END_BRACKET) {
-        error("Expected ending bracket ')'.", parseCurrent);
-      }
-      token = advance(); // consume the ')' ending parentheses
-      return val; // return the result of the expression in the parentheses
-    }
-    case END_BRACKET: // Handles expression '()'
-      error("Parsed unexpected ')' token.", parseCurrent);
-    case SQRT: { // Square root
-      return sqrt(expression(40));
-    }
-    case CBRT: { // Cube root
-      return cbrt(expression(40));
-    }
-    case LOG: { // Log base 10
-      return log10(expression(40));
-    }
-    case LN: { // Log base e
-      return log(expression(40));
-    }
-    case SIN: { // Sine
-      return sin(degtorad(expression(40)));
-    }
-    case COS: { // Cosine
-      return cos(degtorad(expression(40)));
-    }
-    case TAN: { // Tangent
-      return tan(degtorad(expression(40)));
-    }
-    case ASIN: { // Inverse sine
-      return radtodeg(asin(expression(40)));
-    }
-    case ACOS: { // Inverse cosine
-      return radtodeg(acos(expression(40)));
-    }
-    case ATAN: { // Inverse tangent
-      return radtodeg(atan(expression(40)));
-    }
-    case SINH: { // Hyperbolic sine
-      return radtodeg(sinh(degtorad(expression(40))));
-    }
-    case COSH: { // Hyperbolic cosine
-      return radtodeg(cosh(degtorad(expression(40))));
-    }
-    case TANH: { // Hyperbolic tangent
-      return radtodeg(tanh(degtorad(expression(40))));
-    }
-    case ASINH: { // Inverse hyperbolic sine
-      return radtodeg(asinh(degtorad(expression(40))));
-    }
-    case ACOSH: { // Inverse hyperbolic cosine
-      return radtodeg(acosh(degtorad(expression(40))));
-    }
-    case ATANH: { // Inverse hyperbolic tangent
-      return radtodeg(atanh(degtorad(expression(40))));
-    }
-    case ABS: { // Absolute value
-      return fabs(expression(40));
-    }
-    case FLOOR: { // Floor
-      return floor(expression(40));
-    }
-    case CEIL: { // Ceiling
-      return ceil(expression(40));
-    }
-    case ROUND: { // Round
-      return round(expression(40));
-    }
-    case DEGTORAD: { // Degrees to radians
-      return degtorad(expression(40));
-    }
-    case RADTODEG: { // Radians to degrees
-      return radtodeg(expression(40));
-    }
-    case INV: {
-      return 1.0 / (expression(40));
-    }
-    case EXP: {
-      return exp(expression(40));
-    }
-    default: { // Only happens in invalid (syntax-wise) expressions
-      char errorMessage[1024];
-      sprintf(errorMessage, "Unexpected token '%s'.", tempToken.value);
-      error(errorMessage, parseCurrent);
-      return 0;
-    }
-  }
-}
-
-double degtorad(double degrees) {
-  return degrees * M_PI / 180.0;
-}
-
-double radtodeg(double radians) {
-  return radians * 180.0 / M_PI;
-}
-
-// Return the next token
-Token advance() {
-  while (parseCurrent + 1 < findNumberOfTokens(userExp)) {
-    if (tokens[parseCurrent + 1].type != PASS_TOKEN) {
-      return tokens[++parseCurrent];
-    } else {
-      parseCurrent++;
-    }
-  }
-
-  // If there are no more tokens, return a token that indicates the end of the expression
-  return initToken("", END_OF_EXPRESSION);
-}
-
-// Evaluate user expression
-// Note that this function is recursive
-// Algorithm detailed in DF document
-double expression(int bindingPower) {
-  // Consume an operand
-  Token t = token;
-  token = advance();
-
-  // Evaluate the operand as a unary expression
-  double left = nud(t);
-
-  // Throw exception for input like '1 1'
-  if (t.type == NUMBER && token.type == NUMBER) {
-    error("Not expecting a number after a number (with no valid operator in between).", parseCurrent);
-  }
-
-  // If the binding power currently is smaller than the binding power
-  // of the next token, keep looping
-  while (bindingPower < token.bindingPower) {
-    // Consume tokens
-    t = token;
-    token = advance();
-
-    // Evaluate binary expression
-    left = led(t, left);
-  }
-
-  // Return result to callee
-  return left;
-}
-
-// Tokenize a string expression into an array of tokens
-void tokenize(char *exp) {
-  int indexToken = 0;
-  start = 0;
-  current = 0;
-
-  // Go through entire expression character by character
-  while (current < strlen(exp)) {
-    char c = exp[current];
-    if (isNumeric(c)) { // Consume number if program reads a digit
-      if (indexToken - 1 >= 0 && (tokens[indexToken - 1].type == END_BRACKET ||
-                                  tokens[indexToken - 1].type == FACTORIAL ||
-                                  tokens[indexToken - 1].type == IDENTIFIER)) { // If we have a number after ')'
-        tokens[indexToken++] = initToken("*", MULTIPLY);
-      }
-
-      tokenizeNumber();
-      char *sub = malloc(strlen(exp));
-      strncpy(sub, exp + start, current + 1 - start);
-
-      tokens[indexToken++] = initToken(sub, NUMBER);
-      current++;
-      start = current;
-      continue; // Continue onwards to the next iteration
-    } else if (isAlpha(c)) {
-      if (indexToken - 1 >= 0 && (tokens[indexToken - 1].type == END_BRACKET ||
-                                  tokens[indexToken - 1].type == FACTORIAL ||
-                                  tokens[indexToken - 1].type == NUMBER ||
-                                  tokens[indexToken - 1].type == IDENTIFIER)) {
-        tokens[indexToken++] = initToken("*", MULTIPLY);
-      }
-
-      tokenizeAlpha();
-      char *sub = malloc(strlen(exp));
-      strncpy(sub, exp + start, current + 1 - start);
-
-      tokens[indexToken++] = initToken(sub, IDENTIFIER);
-      current++;
-      start = current;
-      continue; // Continue onwards to the next iteration
-    }
-
-    // Check character type if it is not a number
-    switch (c) {
-      case ' ':  // spaces are ignored
-      case '\t': // tabs are ignored
-        break;
-      case '(': // consume '(' as start parentheses
-        // If we have a number before '('
-        // Or we have a factorial term before '(' (e.g., '5!(4)'), or we have ')'
-        if (indexToken - 1 >= 0 &&
-            (tokens[indexToken - 1].type == NUMBER || tokens[indexToken - 1].type == FACTORIAL ||
-             tokens[indexToken - 1].type == IDENTIFIER || tokens[indexToken - 1].type == END_BRACKET)) {
-          tokens[indexToken++] = initToken("*", MULTIPLY);
-        }
-        tokens[indexToken++] = initToken("(", START_BRACKET);
-        break;
-      case ')': // consume ')' as end parentheses
-        tokens[indexToken++] = initToken(")", END_BRACKET);
-        break;
-      case '+': // '+' - addition
-        tokens[indexToken++] = initToken("+", ADD);
-        break;
-      case '-': // '-' - subtraction/negation
-        tokens[indexToken++] = initToken("-", MINUS);
-        break;
-      case '*': // '*' - multiplication
-        tokens[indexToken++] = initToken("*", MULTIPLY);
-        break;
-      case '/': // '/' - division
-        tokens[indexToken++] = initToken("/", DIVIDE);
-        break;
-      case '%': // '%' - modulo
-        tokens[indexToken++] = initToken("%", MODULO);
-        break;
-      case '^': // '^' - exponentiation
-        tokens[indexToken++] = initToken("^", POWER);
-        break;
-      case '!': // '!' - factorial
-        tokens[indexToken++] = initToken("!", FACTORIAL);
-        break;
-      case '.': // '.' - unexpected as we handle '.' in numbers in the tokenizeNumber() function
-        error("Error: Unexpected '.', please have digits before '.' (e.g., 0.1 instead of .1)", -1);
-        error("       Also, numbers can only have one '.' (e.g., no 1.1.1)", current);
-        break;
-      default: {
-        // Unknown characters are reported (shouldn't happen as it
-        // happens already in checkExpressionValidity())
-        char errorMessage[1024];
-        sprintf(errorMessage, "Error: Unknown character: '%c'", c);
-        error(errorMessage, current);
-        break;
-      }
-    }
-    current++;
-    start = current; // end of token, the start of the next token must be the next character
-  }
-}
-
-// Finds the number of tokens in a string expression
-// Note that this function is very similar to the 'tokenize()' function,
-// just that it increments a counter instead of creating tokens.
-int findNumberOfTokens(char *exp) {
-  start = 0;
-  current = 0;
-
-  int numTokens = 0;
-
-  // Iterate through the expression
-  while (current < strlen(exp)) {
-    char c = exp[current];
-    if (isNumeric(c)) { // +1 for numbers
-      tokenizeNumber();
-
-      // Ignore whitespace afterwards
-      while (current + 1 < strlen(exp) && (exp[current + 1] == ' ' || exp[current + 1] == '\t')) {
-        current++;
-      }
-      // If we have an identifier after a number, then we will insert
-      // a multiplication operator there, so make sure to increment
-      // the token count.
-      if (current + 1 < strlen(exp) && isAlpha(exp[current + 1])) {
-        numTokens += 2;
-      } else {
-        numTokens++;
-      }
-
-      current++;
-      start = current;
-      continue;
-    } else if (isAlpha(c)) {
-      tokenizeAlpha();
-
-      // Ignore whitespace afterwards
-      while (current + 1 < strlen(exp) && (exp[current + 1] == ' ' || exp[current + 1] == '\t')) {
-        current++;
-      }
-
-      // If we have a number after the identifier, then we will insert
-      // a multiplication operator there, so make sure to increment
-      // the token count.
-      if (current + 1 < strlen(exp) && (isNumeric(exp[current + 1]) || isAlpha(exp[current + 1]))) {
-        numTokens += 2;
-      } else {
-        numTokens++;
-      }
-
-      current++;
-      start = current;
-      continue;
-    }
-    switch (c) { // +1 for each of these characters
-      // Notice the chaining of cases.
-      // Each of these cases below should increment token count by 1.
-      case '(': {
-        int tempCurrent = current;
-        // Ignore whitespace before
-        while (exp[tempCurrent - 1] == ' ' || exp[tempCurrent - 1] == '\t') {
-          tempCurrent--;
-        }
-        // If we have a number in front of the '(', or a factorial, or an identifier,
-        // then we will insert a multiplication operator there,
-        // so make sure to increment the token count.
-        if (tempCurrent - 1 >= 0 &&
-            (isNumeric(exp[tempCurrent - 1]) || exp[tempCurrent - 1] == '!' || isAlpha(exp[tempCurrent - 1]))) {
-          numTokens += 2;
-        } else {
-          numTokens++;
-        }
-        break;
-      }
-      case ')':
-        // Ignore whitespace afterwards
-        while (current + 1 < strlen(exp) && (exp[current + 1] == ' ' || exp[current + 1] == '\t')) {
-          current++;
-        }
-        // If we have a number after ')', then we will insert
-        // a multiplication operator there, so make sure to increment
-        // the token count.
-        if (current + 1 < strlen(exp) &&
-            (isNumeric(exp[current + 1]) ||
-             isAlpha(exp[current + 1]) ||
-             exp[current + 1] == '(')) {
-          numTokens += 2;
-        } else {
-          numTokens++;
-        }
-        break;
-      case '!':
-        // Ignore whitespace afterwards
-        while (current + 1 < strlen(exp) && (exp[current + 1] == ' ' || exp[current + 1] == '\t')) {
-          current++;
-        }
-        // If we have a number after '!', then we will insert
-        // a multiplication operator there, so make sure to increment
-        // the token count.
-        if (current + 1 < strlen(exp) && isNumeric(exp[current + 1])) {
-          numTokens += 2;
-        } else {
-          numTokens++;
-        }
-        break;
-      case '+':
-      case '-':
-      case '*':
-      case '/':
-      case '%':
-      case '^':
-        numTokens++;
-        break;
-        // Spaces, etc. aren't tokens, so ignore them
-      default:
-        break;
-    }
-    current++;
-    start = current;
-  }
-  return numTokens;
-}
-
-// Tokenize a function/constant identifier
-void tokenizeAlpha() {
-  // Consume alphabetical characters
-  // If we reach the end of the expression or the next character isn't alphabetical, stop
-  while (current + 1 < strlen(userExp) && (isAlpha(userExp[current + 1]))) {
-    current++;
-  }
-
-  // Note that no token is created here, it is created back in the function tokenize().
-}
-
-// Tokenize a number
-void tokenizeNumber() {
-  // Consume numeric part
-  // If we reach the end of the expression or the next character isn't numeric, stop
-  while (current + 1 < strlen(userExp) && (isNumeric(userExp[current + 1]))) {
-    current++;
-  }
-
-  // If the next character is '.', expect to see more numbers afterwards
-  if (current + 1 < strlen(userExp) && userExp[current + 1] == '.') {
-    current++; // consume the '.'
-    // Consume numbers afterwards
-    while (current + 1 < strlen(userExp) && isNumeric(userExp[current + 1])) {
-      current++;
-    }
-  }
-  // Note that no token is created here, it is created back in the function tokenize().
-}
-
-// Checks whether a string still has a pair of parentheses '()'
-// Note that blank spaces are ignored
-int hasMatchingBrackets(char *string) {
-  for (int i = 0; i < strlen(string); i++) { // For each character in the string
-    if (i + 1 < strlen(string) && // Ensure that there is a character after the current one
-        string[i] == '(') {  // Check if the current character is '('
-      int tempI = i + 1;
-      while (string[tempI] == ' ') { // While it is only spaces, advance
-        tempI++;
-      }
-      if (string[tempI] == ')') {
-        // Return true if we see a ')' next
-        // If not, then start scanning again from the next character
-        // This function only returns true when the innermost pair of parentheses are found.
-        return true;
-      }
-    }
-  }
-  // Return false if no more matching parentheses are found
-  return false;
-}
-
-// If the entire string is just spaces, then return true.
-// Else, the string contains some other character, return false.
-bool isBlank(char *string) {
-  for (int i = 0; i < strlen(string); i++) {
-    if (string[i] != ' ') {
-      return false;
-    }
-  }
-  return true;
-}
-
-// Validates that parentheses are matching in the expression
-void checkParenthesesMatch(char *inputString) {
-  // Make a copy of the input string because we are performing temporary functions on it.
-  char copyOfInput[strlen(inputString)];
-  strcpy(copyOfInput, inputString);
-
-  // For each character of the string
-  for (int i = 0; i < strlen(copyOfInput); i++) {
-    switch (copyOfInput[i]) { // Remove non-parentheses characters
-      case '(':
-      case ')':
-        continue;
-      default: // Remove numbers as well
-        copyOfInput[i] = ' ';
-        break;
-    }
-  }
-
-  // While there are still matching brackets '()'
-  while (hasMatchingBrackets(copyOfInput)) {
-    // Go through and replace them with spaces
-    for (int i = 0; i < strlen(copyOfInput); i++) {
-      if (i + 1 < strlen(copyOfInput) &&
-          copyOfInput[i] == '(') {
-        int tempI = i + 1;
-        while (copyOfInput[tempI] == ' ') {
-          tempI++;
-        }
-        if (copyOfInput[tempI] == ')') {
-          copyOfInput[i] = ' ';     // Remove '('
-          copyOfInput[tempI] = ' '; // Remove ')'
-        }
-      }
-    }
-  }
-
-  // If hadError isn't already true, set it to be true if the result
-  // string is not just a bunch of spaces
-  hadError = hadError || !isBlank(copyOfInput);
-
-  // If there are still parentheses in the string, then
-  // the parentheses are unmatched, an error is thrown.
-  if (!isBlank(copyOfInput)) {
-    error("Unmatched parentheses.", current);
-  }
-}
-
-// Check if the expression contains only valid characters
-void checkExpressionValidity() {
-  for (int index = 0; index < findNumberOfTokens(userExp); index++) {
-    const char *tempTokenValue = tokens[index].value;
-    // Iterate through all the tokens and check if all identifiers are valid
-    // Interpret the values of the identifiers and replace their token types
-    switch (tokens[index].type) {
-      case IDENTIFIER: // Matches an identifier
-        tokenizeFunction(index, tempTokenValue);
-        break;
-      default: {
-        break;
-      }
-    }
-  }
-}
-
-void tokenizeFunction(int index, const char *tempTokenValue) {
-  if (match(tempTokenValue, "pi")) {
-    // Match 'pi', which represents π
-    Token t = {"pi", MATH_PI, 25};
-    tokens[index] = t;
-  } else if (match(tempTokenValue, "e")) {
-    // Match 'exp', which matches Euler's constant
-    Token t = {"e", MATH_E, 25};
-    tokens[index] = t;
-  } else if (match(tempTokenValue, "rand")) {
-    Token t = {"rand", RAND_NUM, 25};
-    tokens[index] = t;
-  } else {
-    // Tokenize functions
-    if (match(tempTokenValue, "sqrt")) tokens[index] = initToken("sqrt", SQRT);
-    else if (match(tempTokenValue, "cbrt")) tokens[index] = initToken("cbrt", CBRT);
-    else if (match(tempTokenValue, "log")) tokens[index] = initToken("log", LOG);
-    else if (match(tempTokenValue, "ln")) tokens[index] = initToken("ln", LN);
-    else if (match(tempTokenValue, "sin")) tokens[index] = initToken("sin", SIN);
-    else if (match(tempTokenValue, "cos")) tokens[index] = initToken("cos", COS);
-    else if (match(tempTokenValue, "tan")) tokens[index] = initToken("tan", TAN);
-    else if (match(tempTokenValue, "asin")) tokens[index] = initToken("asin", ASIN);
-    else if (match(tempTokenValue, "acos")) tokens[index] = initToken("acos", ACOS);
-    else if (match(tempTokenValue, "atan")) tokens[index] = initToken("atan", ATAN);
-    else if (match(tempTokenValue, "sinh")) tokens[index] = initToken("sinh", SINH);
-    else if (match(tempTokenValue, "cosh")) tokens[index] = initToken("cosh", COSH);
-    else if (match(tempTokenValue, "tanh")) tokens[index] = initToken("tanh", TANH);
-    else if (match(tempTokenValue, "asinh")) tokens[index] = initToken("asinh", ASINH);
-    else if (match(tempTokenValue, "acosh")) tokens[index] = initToken("acosh", ACOSH);
-    else if (match(tempTokenValue, "atanh")) tokens[index] = initToken("atanh", ATANH);
-    else if (match(tempTokenValue, "abs")) tokens[index] = initToken("abs", ABS);
-    else if (match(tempTokenValue, "floor")) tokens[index] = initToken("floor", FLOOR);
-    else if (match(tempTokenValue, "ceil")) tokens[index] = initToken("ceil", CEIL);
-    else if (match(tempTokenValue, "round")) tokens[index] = initToken("round", ROUND);
-    else if (match(tempTokenValue, "degtorad")) tokens[index] = initToken("degtorad", DEGTORAD);
-    else if (match(tempTokenValue, "radtodeg")) tokens[index] = initToken("radtodeg", RADTODEG);
-    else if (match(tempTokenValue, "inv")) tokens[index] = initToken("inv", INV);
-    else if (match(tempTokenValue, "exp")) tokens[index] = initToken("exp", EXP);
-    else { // Some random word that isn't a reserved identifier
-      hadError = true;
-      char errorMessage[1024];
-      sprintf(errorMessage, "Unexpected identifier '%s'.", tokens[index].value);
-
-      inTokenizeStage = false;
-      error(errorMessage, index + 1);
-    }
-    omitToken(index + 1);
-  }
-}
-
-void omitToken(int index) {
-  if (tokens[index].type == MULTIPLY) {
-    tokens[index] = initToken("", PASS_TOKEN);
-  }
-}
-
-bool match(const char *value, char *anotherValue) {
-  return strcmp(value, anotherValue) == 0;
-}
-
-// Checks if character is digit from 0 to 9
-bool isNumeric(char c) {
-  return c >= '0' && c <= '9';
-}
-
-// Checks if character is an alphabet from a-z
-bool isAlpha(char c) {
-  return (tolower(c) >= 'a' && tolower(c) <= 'z');
-}
-
 #if defined(WIN32)
 HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
 
@@ -1080,88 +463,28 @@ void beep() {
   printf("\a");
 }
 
-// Print errors in bold red and set the hadError flag on.
-// Additionally, mark where the error occurred in the expression.
-void error(char *str, int index) {
-  numErrors++;
+// Print errors in bold red
+// If position isn't -1, additionally mark where the error occurred in the expression.
+void error(const char *str, const char *exp, long long position) {
   boldRed();
-  if (numErrors == 6) {
-    type("Too many errors identified, please fix the ones pointed out first.\n\n");
-    return;
-  } else if (numErrors > 6) {
-    return;
-  }
-  hadError = true;
   type(str);
   type("\n");
-  if (index >= 0) {
+  if (exp != NULL && position >= 0) {
     type("    => ");
-    char *point;
-    int len = 0;
-    int tempIndex = index;
-    if (inTokenizeStage) {
-      type(userExp);
-      type("\n");
+    type(exp);
+    type("\n");
 
-      len = (int) strlen(userExp);
-    } else {
-      tempIndex = 0;
-      for (int i = 0; i < index - 1; i++) {
-        tempIndex += (int) strlen(tokens[i].value);
-      }
+    // A '^' under the character at position
+    char *point = arenaAllocate(&arena, position + 1);
+    if (point != NULL) {
+      memset(point, ' ', position);
+      point[position] = '^';
 
-      for (int i = 0; i < findNumberOfTokens(userExp); i++) {
-        type(tokens[i].value);
-      }
+      type("       ");
+      typeSpan(point, (int) position + 1);
       type("\n");
-
-      for (int i = 0; i < findNumberOfTokens(userExp); i++) {
-        len += (int) strlen(tokens[i].value);
-      }
-    }
-    point = malloc(len);
-    for (int indice = 0; indice < len; indice++) {
-      if (indice == tempIndex) {
-        point[indice] = '^';
-      } else {
-        point[indice] = ' ';
-      }
     }
-
-    type("       ");
-    type(point);
-    type("\n");
-  }
-}
-
-// Return an initialized token
-Token initToken(const char *val, Symbol ty) {
-  // The main purpose of this function is to assign binding power to operators.
-  int bindingPower;
-  switch (ty) { // Check the type of the token to be created
-    // Assign binding powers based on which operator it is
-    case ADD:
-    case MINUS:
-      bindingPower = 10;
-      break;
-    case MULTIPLY:
-    case DIVIDE:
-    case MODULO:
-      bindingPower = 20;
-      break;
-    case POWER:
-      bindingPower = 30;
-      break;
-    case FACTORIAL:
-      bindingPower = 40;
-      break;
-    default: // If it isn't an operator, assign a default binding power value of 0.
-      bindingPower = 0;
-      break;
   }
-  // Return the new token to the callee
-  Token returnToken = {val, ty, bindingPower};
-  return returnToken;
 }
 
 // Returns the lowercase version of a string
@@ -1193,6 +516,8 @@ void printHelpManual() {
   type("at most 1024 characters long");
   blue();
   type(".\n");
+  type("   Longer expressions can be evaluated from a file with 'Calculator --stream <file>'.\n");
+  type(" - A file of expressions (one per line) can be compiled to native code with 'Calculator --compile <file>'.\n");
   type(" - If the evaluated expression is:\n");
   type("\t - Greater than 1e16\n");
   type("\t - Less than -1e16\n");
@@ -1262,20 +587,25 @@ void printHelpManual() {
 
 // Typing function
 void type(const char *str) {
+  typeSpan(str, (int) strlen(str));
+}
+
+// Types out the first length characters of a string
+void typeSpan(const char *str, int length) {
   // Find the amount of milliseconds to delay printing each character by.
   // Note that strings will be typed out at different speeds depending on their length.
   // Each string will take ~300 milliseconds to type out
-  int timeInMs = (int) (300.0l / strlen(str));
+  int timeInMs = (int) (300.0l / length);
 
   // If the string is very short, type it out in
   // less than 300 milliseconds
-  if (strlen(str) < 10) {
+  if (length < 10) {
     timeInMs = 30;
   }
 
   // Type the string with delay
   // See DF design brief: How can you display text with delay?
-  for (int i = 0; i < strlen(str); i++) {
+  for (int i = 0; i < length; i++) {
     // Sleep the thread for timeInMs * 1000 microseconds
     // (1 μs = 1000 ns)
     usleep(timeInMs * 1000);
@@ -0,0 +1,369 @@
+// Justin Chen
+// Expressions compiled ahead of time into shared objects by the system C compiler
+// The syntax tree is written out as a C function of straight-line code (one variable per node,
+// in the order evaluateAst() finishes them), with the same libm calls as applyOperator(),
+// applyFused() and applyFunction(), after the code of the operations the backends share (power(),
+// sumTerms(), ...) copied from operations.c (see nativePrelude.h). It is built with -O2 and
+// loaded with dlopen(). Operations aren't contracted into fused ones (only fuseOperations() adds
+// fma() calls), and libm calls aren't evaluated by the compiler (which rounds them correctly,
+// unlike libm), so the results are rounded the same way as the other backends'. 'rand' and factorials call back into libcalc,
+// so they share the state and errors of the evaluation.
+
+#define _DEFAULT_SOURCE  // POSIX functions (fork(), mkdir(), dlopen())
+
+#include "native.h"
+
+#ifdef NATIVE_SUPPORTED
+
+#include <stdio.h>    // I/O functions (fopen(), fprintf(), snprintf())
+#include <stdlib.h>   // Standard library (getenv())
+#include <string.h>   // String functions (strcmp(), strlen())
+#include <stdint.h>   // Fixed-width integers (uint32_t, uint64_t, uintptr_t)
+#include <math.h>     // Math library (isinf(), isnan(), signbit())
+#include <errno.h>    // Error numbers (errno, EEXIST, EINTR)
+#include <fcntl.h>    // Opening files (open())
+#include <unistd.h>   // Processes and files (fork(), execlp(), dup2(), rename(), unlink())
+#include <dlfcn.h>    // Loading shared objects (dlopen(), dlsym(), dlclose())
+#include <sys/stat.h> // Directories (mkdir())
+#include <sys/wait.h> // Waiting for the compiler (waitpid())
+#include "operations.h"  // Factorials, random numbers and constants (factorial(), randomNumber(), M_PI)
+#include "nativePrelude.h" // Operations the generated code starts with (operationsPrelude, made from operations.c)
+
+// The C compiler libcalc was built with (set by CMakeLists.txt)
+#ifndef CALC_C_COMPILER
+#define CALC_C_COMPILER "cc"
+#endif
+
+// Changes whenever the code writeSource() writes changes, so that stale shared objects aren't
+// loaded (operationsPrelude is hashed along with it, so changes to operations.c don't need this)
+#define NATIVE_FORMAT "libcalc-native-9"
+
+// Longest path of a file in the cache
+#define MAX_PATH 4096
+
+// The compiled expression
+typedef double (*NativeFunction)(double (*random)(const void *), double (*factorial)(double, const void *, unsigned),
+                                 const void *evaluation);
+
+// Returns a random number for 'rand' (called by the compiled code)
+static double nativeRandom(const void *evaluation) {
+  return randomNumber(((const AstEvaluation *) evaluation)->randomState);
+}
+
+// Returns the factorial of x, reporting an error if it is negative (called by the compiled code)
+static double nativeFactorial(double x, const void *context, unsigned position) {
+  const AstEvaluation *evaluation = context;
+  if (x < 0) {
+    evaluation->domainError(evaluation->context, position);
+    return 0;
+  }
+  return factorial(x);
+}
+
+// Returns the C code of a function applied to the variable %d (the same operations as applyFunction())
+static const char *functionCode(Symbol type) {
+  switch (type) {
+    case NEGATE: return "-v%d";
+    case SQRT: return "sqrt(v%d)";
+    case CBRT: return "cbrt(v%d)";
+    case LOG: return "log10(v%d)";
+    case LN: return "log(v%d)";
+    case SIN: return "sin(degtorad(v%d))";
+    case COS: return "cos(degtorad(v%d))";
+    case TAN: return "tan(degtorad(v%d))";
+    case ASIN: return "radtodeg(asin(v%d))";
+    case ACOS: return "radtodeg(acos(v%d))";
+    case ATAN: return "radtodeg(atan(v%d))";
+    case SINH: return "radtodeg(sinh(degtorad(v%d)))";
+    case COSH: return "radtodeg(cosh(degtorad(v%d)))";
+    case TANH: return "radtodeg(tanh(degtorad(v%d)))";
+    case ASINH: return "radtodeg(asinh(degtorad(v%d)))";
+    case ACOSH: return "radtodeg(acosh(degtorad(v%d)))";
+    case ATANH: return "radtodeg(atanh(degtorad(v%d)))";
+    case ABS: return "fabs(v%d)";
+    case DEGTORAD: return "degtorad(v%d)";
+    case RADTODEG: return "radtodeg(v%d)";
+    case FLOOR: return "floor(v%d)";
+    case CEIL: return "ceil(v%d)";
+    case ROUND: return "round(v%d)";
+    case INV: return "1.0 / v%d";
+    case LOG1P: return "log1p(v%d)";
+    case EXPM1: return "expm1(v%d)";
+    default: return "exp(v%d)";
+  }
+}
+
+// Writes a double as an exact C constant
+// Folding can leave NaNs, which are read from volatile ones (see writeSource()): the compiler would
+// change the sign of a NAN literal (e.g., x + -NAN becomes x - NAN).
+static void writeConstant(FILE *file, double value) {
+  if (isinf(value)) {
+    fprintf(file, "%sHUGE_VAL", value < 0 ? "-" : "");
+  } else if (isnan(value)) {
+    fprintf(file, signbit(value) ? "negativeNan" : "positiveNan");
+  } else {
+    fprintf(file, "%a", value);
+  }
+}
+
+// Writes a string as a C string literal
+static void writeString(FILE *file, const char *text) {
+  fputc('"', file);
+  for (const char *c = text; *c != '\0'; c++) {
+    if ((*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') || *c == ' ' || *c == '.') {
+      fputc(*c, file);
+    } else {
+      fprintf(file, "\\%03o", (unsigned char) *c);
+    }
+  }
+  fputc('"', file);
+}
+
+// Writes the terms of a SUM, COMPENSATED_SUM or PRODUCT node as an array (a compound literal)
+// The list of OPERAND_PAIR nodes is read from the top down, so the terms are found last to first
+// (terms needs room for all of them).
+static void writeTerms(FILE *file, const Ast *ast, const AstNode *node, int32_t *terms) {
+  int list = node->left;
+  for (int i = node->right - 1; i > 0; i--) {
+    terms[i] = ast->nodes[list].right;
+    list = ast->nodes[list].left;
+  }
+  terms[0] = list;
+  fprintf(file, "(const double[]) {v%d", terms[0]);
+  for (int i = 1; i < node->right; i++) {
+    fprintf(file, ", v%d", terms[i]);
+  }
+  fprintf(file, "}, %d", node->right);
+}
+
+// Returns the options that change the tree, as a number (kept in the shared objects)
+static int mathOptionsOf(const CalcOptions *options) {
+  return options->fastMath | options->compensatedSums << 1;
+}
+
+// Writes the C source of the tree with its root at index
+// The text of the expression is kept in calcSource (and the options that changed the tree in
+// calcMathOptions), so that a hash collision can't load the wrong expression.
+static bool writeSource(const char *path, const Ast *ast, int root, const char *text, int mathOptions,
+                        Arena *arena) {
+  int32_t *order = arenaAllocate(arena, ast->numNodes * sizeof(int32_t));
+  int32_t *work = arenaAllocate(arena, 2 * ast->numNodes * sizeof(int32_t));
+  int32_t *terms = arenaAllocate(arena, ast->numNodes * sizeof(int32_t));
+  FILE *file = order != NULL && work != NULL && terms != NULL ? fopen(path, "w") : NULL;
+  if (file == NULL) {
+    return false;
+  }
+
+  // The constants of operations.h, the shared operations and the NaNs of writeConstant()
+  // Only the symbols dlsym() looks up are visible, so the operations can be inlined.
+  fprintf(file, "// Generated by libcalc\n\n#include <math.h>\n\n#undef M_PI\n#define M_PI ");
+  writeConstant(file, M_PI);
+  fprintf(file, "\n#define MAX_INTEGER_EXPONENT %d\n#define REDUCTION_LANES %d\n#define REDUCTION_BLOCK %d\n\n%s"
+                "static const volatile double positiveNan = NAN, negativeNan = -NAN;\n\n"
+                "#define EXPORT __attribute__((visibility(\"default\")))\n\nEXPORT const char calcSource[] = ",
+          MAX_INTEGER_EXPONENT, REDUCTION_LANES, REDUCTION_BLOCK, operationsPrelude);
+  writeString(file, text);
+  fprintf(file, ";\nEXPORT const int calcMathOptions = %d;\n\nEXPORT double calcEvaluateNative(double (*random)"
+                "(const void *), double (*factorial)(double, const void *, unsigned), const void *evaluation) {\n",
+          mathOptions);
+  for (int i = 0; i < ast->numShared; i++) { // Values of repeated subexpressions
+    fprintf(file, "  double s%d;\n", i);
+  }
+
+  int numNodes = astPostOrder(ast, root, order, work);
+  for (int i = 0; i < numNodes; i++) {
+    int index = order[i];
+    const AstNode *node = &ast->nodes[index];
+    if (node->type == OPERAND_PAIR) { // Its operands are used by the fused operation (or the sum)
+      continue;
+    }
+    fprintf(file, "  double v%d = ", index);
+    switch (node->type) {
+      case NUMBER: writeConstant(file, ast->literals[node->left]); break;
+      case MATH_PI: writeConstant(file, M_PI); break;
+      case MATH_E: writeConstant(file, M_E); break;
+      case RAND_NUM: fprintf(file, "random(evaluation)"); break;
+      case ADD: fprintf(file, "v%d + v%d", node->left, node->right); break;
+      case MINUS: fprintf(file, "v%d - v%d", node->left, node->right); break;
+      case MULTIPLY: fprintf(file, "v%d * v%d", node->left, node->right); break;
+      case DIVIDE: fprintf(file, "v%d / v%d", node->left, node->right); break;
+      case MODULO: fprintf(file, "fmod(v%d, v%d)", node->left, node->right); break;
+      case POWER: fprintf(file, "power(v%d, v%d)", node->left, node->right); break;
+      case HYPOT: fprintf(file, "hypot(v%d, v%d)", node->left, node->right); break;
+      case FUSED_MULTIPLY_ADD: case FUSED_MULTIPLY_SUBTRACT: { // x * y ± z, with x and y in the left pair
+        const AstNode *pair = &ast->nodes[node->left];
+        fprintf(file, node->type == FUSED_MULTIPLY_ADD ? "fma(v%d, v%d, v%d)" : "fma(v%d, v%d, -v%d)", pair->left,
+                pair->right, node->right);
+        break;
+      }
+      case FUSED_ADD_MULTIPLY: case FUSED_SUBTRACT_MULTIPLY: { // x ± y * z, with y and z in the right pair
+        const AstNode *pair = &ast->nodes[node->right];
+        fprintf(file, node->type == FUSED_ADD_MULTIPLY ? "fma(v%d, v%d, v%d)" : "fma(-v%d, v%d, v%d)", pair->left,
+                pair->right, node->left);
+        break;
+      }
+      case SUM: fprintf(file, "sumTerms("); writeTerms(file, ast, node, terms); fprintf(file, ")"); break;
+      case COMPENSATED_SUM: fprintf(file, "compensatedSum("); writeTerms(file, ast, node, terms); fprintf(file, ")"); break;
+      case PRODUCT: fprintf(file, "multiplyTerms("); writeTerms(file, ast, node, terms); fprintf(file, ")"); break;
+      case FACTORIAL: fprintf(file, "factorial(v%d, evaluation, %uu)", node->left, ast->positions[index]); break;
+      case STORE_SHARED: fprintf(file, "s%d = v%d", node->right, node->left); break;
+      case LOAD_SHARED: fprintf(file, "s%d", node->right); break;
+      case INTEGER_POWER: fprintf(file, "integerPower(v%d, %d)", node->left, node->right); break;
+      case ROOT_POWER: fprintf(file, "rootPower(v%d, %d)", node->left, node->right); break;
+      default: fprintf(file, functionCode(node->type), node->left); break;
+    }
+    fprintf(file, ";\n");
+  }
+  fprintf(file, "  return v%d;\n}\n", root);
+  return fclose(file) == 0;
+}
+
+// Builds a shared object from a C source file with the C compiler (its output is discarded)
+// Returns false if it couldn't be built.
+static bool buildLibrary(const char *sourcePath, const char *libraryPath) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  } else if (pid == 0) { // The compiler's process
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+      dup2(null, STDOUT_FILENO);
+      dup2(null, STDERR_FILENO);
+    }
+    execlp(CALC_C_COMPILER, CALC_C_COMPILER, "-O2", "-ffp-contract=off", "-fno-builtin", "-fPIC", "-fvisibility=hidden",
+           "-shared",
+           "-o", libraryPath, sourcePath, "-lm", (char *) NULL);
+    _exit(127);
+  }
+
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Loads a shared object and finds the compiled expression in it
+// Returns false if it doesn't exist or is of a different expression.
+static bool loadLibrary(const char *path, const char *text, int mathOptions, NativeCode *native) {
+  native->library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (native->library == NULL) {
+    return false;
+  }
+  const char *source = dlsym(native->library, "calcSource");
+  const int *sourceMathOptions = dlsym(native->library, "calcMathOptions");
+  native->function = dlsym(native->library, "calcEvaluateNative");
+  if (source == NULL || sourceMathOptions == NULL || native->function == NULL || strcmp(source, text) != 0 ||
+      *sourceMathOptions != mathOptions) {
+    releaseNative(native);
+    return false;
+  }
+  return true;
+}
+
+// Stores the path of the cache directory in path (creating it if needed)
+// Returns false if there is none.
+static bool findCacheDirectory(const char *cacheDirectory, char *path) {
+  const char *base;
+  int length;
+  if (cacheDirectory != NULL) {
+    length = snprintf(path, MAX_PATH, "%s", cacheDirectory);
+  } else if ((base = getenv("XDG_CACHE_HOME")) != NULL && base[0] != '\0') {
+    mkdir(base, 0700);
+    length = snprintf(path, MAX_PATH, "%s/libcalc", base);
+  } else if ((base = getenv("HOME")) != NULL && base[0] != '\0') {
+    char cache[MAX_PATH];
+    if (snprintf(cache, MAX_PATH, "%s/.cache", base) >= MAX_PATH) {
+      return false;
+    }
+    mkdir(cache, 0700);
+    length = snprintf(path, MAX_PATH, "%s/libcalc", cache);
+  } else {
+    return false;
+  }
+  return length < MAX_PATH && (mkdir(path, 0700) == 0 || errno == EEXIST);
+}
+
+// Returns the FNV-1a hash of a string, continuing from hash
+static uint64_t hashString(uint64_t hash, const char *text) {
+  for (const char *c = text; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char) *c) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+bool compileNative(const Ast *ast, int root, const char *text, const CalcOptions *options, NativeCode *native,
+                   Arena *arena) {
+  native->library = NULL;
+  char directory[MAX_PATH];
+  if (!findCacheDirectory(options->cacheDirectory, directory)) {
+    return false;
+  }
+
+  // Shared objects are named after the expression (and how they were built)
+  uint64_t hash = hashString(hashString(0xCBF29CE484222325ULL, NATIVE_FORMAT), CALC_C_COMPILER);
+  hash = hashString(hash, operationsPrelude);
+  int mathOptions = mathOptionsOf(options);
+  hash = hashString(hash, options->fastMath ? "fast" : "exact");
+  hash = hashString(hash, options->compensatedSums ? "compensated" : "pairwise");
+  char passes[32]; // The passes that were run shape the tree, and with fastMath, the results
+  snprintf(passes, sizeof(passes), "passes %x", options->disabledPasses);
+  hash = hashString(hash, passes);
+  hash = hashString(hash, text);
+  char libraryPath[MAX_PATH + 64], sourcePath[MAX_PATH + 64], buildPath[MAX_PATH + 64];
+  snprintf(libraryPath, sizeof(libraryPath), "%s/%016llx.so", directory, (unsigned long long) hash);
+  if (loadLibrary(libraryPath, text, mathOptions, native)) {
+    return true;
+  }
+
+  // Build it under a name of its own, so that other processes never load a half-written one
+  snprintf(sourcePath, sizeof(sourcePath), "%s/%016llx-%ld.c", directory, (unsigned long long) hash, (long) getpid());
+  snprintf(buildPath, sizeof(buildPath), "%s/%016llx-%ld.so", directory, (unsigned long long) hash, (long) getpid());
+  bool built = writeSource(sourcePath, ast, root, text, mathOptions, arena) && buildLibrary(sourcePath, buildPath) &&
+               rename(buildPath, libraryPath) == 0;
+  unlink(sourcePath);
+  if (!built) {
+    unlink(buildPath);
+    return false;
+  }
+  return loadLibrary(libraryPath, text, mathOptions, native);
+}
+
+double runNative(const NativeCode *native, const AstEvaluation *evaluation) {
+  NativeFunction function = (NativeFunction) (uintptr_t) native->function;
+  return function(nativeRandom, nativeFactorial, evaluation);
+}
+
+void releaseNative(NativeCode *native) {
+  if (native->library != NULL) {
+    dlclose(native->library);
+    native->library = NULL;
+  }
+}
+
+#else // No shared objects without dlopen()
+
+bool compileNative(const Ast *ast, int root, const char *text, const CalcOptions *options, NativeCode *native,
+                   Arena *arena) {
+  (void) ast;
+  (void) root;
+  (void) text;
+  (void) options;
+  (void) arena;
+  native->library = NULL;
+  return false;
+}
+
+double runNative(const NativeCode *native, const AstEvaluation *evaluation) {
+  (void) native;
+  (void) evaluation;
+  return 0;
+}
+
+void releaseNative(NativeCode *native) {
+  (void) native;
+}
+
+#endif // NATIVE_SUPPORTED
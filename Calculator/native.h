@@ -0,0 +1,41 @@
+// Justin Chen
+// Expressions compiled ahead of time into shared objects by the system C compiler
+
+#ifndef CALCULATOR_NATIVE_H
+#define CALCULATOR_NATIVE_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast, AstEvaluation)
+#include "arena.h"    // Memory used while compiling (Arena)
+#include "calc.h"     // How the tree was compiled (CalcOptions)
+
+// Shared objects can only be built and loaded where there is a POSIX dlopen()
+#if defined(__unix__) || defined(__APPLE__)
+#define NATIVE_SUPPORTED
+#endif
+
+// Define struct NativeCode
+// A loaded shared object with the compiled expression in it
+typedef struct NativeCode {
+    void *library;                // Handle from dlopen() (NULL if none)
+    void *function;               // The compiled expression (see compileNative())
+} NativeCode;
+
+// Compiles the tree with its root at index into a shared object and loads it.
+// The C source is generated from the tree, built with the C compiler libcalc was built with and
+// kept in options->cacheDirectory (NULL for $XDG_CACHE_HOME/libcalc or ~/.cache/libcalc), named
+// after a hash of text (the expression) and the options that change the tree (fastMath and
+// compensatedSums), so that it is only built the first time an expression is seen.
+// Returns false if it couldn't be built or loaded (e.g., there is no compiler).
+bool compileNative(const Ast *ast, int root, const char *text, const CalcOptions *options, NativeCode *native,
+                   Arena *arena);
+
+// Runs a compiled expression and returns the result
+// The operations are done in the same order and rounded the same way as evaluateAst() does them,
+// so the results (and the random numbers and errors) are the same.
+double runNative(const NativeCode *native, const AstEvaluation *evaluation);
+
+// Unloads a compiled expression (does nothing if none is loaded)
+void releaseNative(NativeCode *native);
+
+#endif // CALCULATOR_NATIVE_H
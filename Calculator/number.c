@@ -0,0 +1,338 @@
+// Justin Chen
+// Conversion of numeric literals to doubles
+// Literals are read into a decimal (digits and the position of the decimal point).
+// Most literals have few enough digits that the result can be computed exactly with a single
+// floating-point multiplication or division (the fast path). The rest are converted by repeatedly
+// shifting the decimal by powers of two (the slow path), which is always correctly rounded.
+// The slow path follows the algorithm used by Go's strconv package.
+
+#include <stdint.h>   // Fixed-width integers (uint64_t)
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <string.h>   // String functions (memcpy())
+#include <float.h>    // Floating-point evaluation method (FLT_EVAL_METHOD)
+#include <math.h>     // Math library (INFINITY)
+#include "number.h"
+
+// Maximum number of digits kept in a decimal
+// Any nonzero digits after these only affect rounding, which is tracked with the truncated flag.
+#define MAX_DIGITS 800
+
+// Largest shift that can be done at once without overflowing a uint64_t
+#define MAX_SHIFT 60
+
+// Define struct Decimal
+// Represents the number 0.d[0]d[1]...d[numDigits - 1] * 10^decimalPoint
+// Digits are stored as values from 0 to 9, and there are no trailing zeros.
+typedef struct Decimal {
+    unsigned char d[MAX_DIGITS];
+    int numDigits;
+    int decimalPoint;
+    bool truncated; // whether nonzero digits after the first MAX_DIGITS were discarded
+} Decimal;
+
+// Powers of 10 that are exactly representable as doubles
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Number of binary digits to shift by to move a decimal with the given number of integer
+// digits into [0.5, 1) (or close to it)
+static const int shiftForDigits[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+
+// Removes trailing zeros from a decimal
+static void trim(Decimal *a) {
+  while (a->numDigits > 0 && a->d[a->numDigits - 1] == 0) {
+    a->numDigits--;
+  }
+  if (a->numDigits == 0) {
+    a->decimalPoint = 0;
+  }
+}
+
+// Reads a literal into a decimal, skipping leading zeros
+static void readDecimal(Decimal *a, const char *str, int length) {
+  a->numDigits = 0;
+  a->decimalPoint = 0;
+  a->truncated = false;
+
+  bool sawDot = false;
+  for (int i = 0; i < length; i++) {
+    char c = str[i];
+    if (c == '.') {
+      sawDot = true;
+      continue;
+    }
+    if (c == '0' && a->numDigits == 0) {
+      // Leading zeros before the decimal point don't matter,
+      // but the ones after it move the first digit to the right.
+      if (sawDot) {
+        a->decimalPoint--;
+      }
+      continue;
+    }
+    if (!sawDot) {
+      a->decimalPoint++;
+    }
+    if (a->numDigits < MAX_DIGITS) {
+      a->d[a->numDigits++] = (unsigned char) (c - '0');
+    } else if (c != '0') {
+      a->truncated = true;
+    }
+  }
+  trim(a);
+}
+
+// Multiplies a decimal by 2^k
+static void leftShift(Decimal *a, unsigned k) {
+  // The product is written backwards from the end of a temporary buffer, as its length
+  // isn't known until the final carry has been written.
+  unsigned char product[MAX_DIGITS + 20];
+  int write = (int) sizeof(product);
+  uint64_t n = 0;
+
+  for (int read = a->numDigits - 1; read >= 0; read--) {
+    n += (uint64_t) a->d[read] << k;
+    uint64_t quotient = n / 10;
+    product[--write] = (unsigned char) (n - 10 * quotient);
+    n = quotient;
+  }
+  while (n > 0) {
+    uint64_t quotient = n / 10;
+    product[--write] = (unsigned char) (n - 10 * quotient);
+    n = quotient;
+  }
+
+  int productDigits = (int) sizeof(product) - write;
+  a->decimalPoint += productDigits - a->numDigits;
+  a->numDigits = productDigits < MAX_DIGITS ? productDigits : MAX_DIGITS;
+  memcpy(a->d, product + write, a->numDigits);
+  for (int i = a->numDigits; i < productDigits; i++) {
+    if (product[write + i] != 0) {
+      a->truncated = true;
+    }
+  }
+  trim(a);
+}
+
+// Divides a decimal by 2^k
+static void rightShift(Decimal *a, unsigned k) {
+  int read = 0;
+  int write = 0;
+  uint64_t n = 0;
+
+  // Pick up enough leading digits to cover the first shift
+  for (; (n >> k) == 0; read++) {
+    if (read >= a->numDigits) {
+      if (n == 0) { // The decimal is 0
+        a->numDigits = 0;
+        return;
+      }
+      while ((n >> k) == 0) {
+        n *= 10;
+        read++;
+      }
+      break;
+    }
+    n = n * 10 + a->d[read];
+  }
+  a->decimalPoint -= read - 1;
+
+  // Pick up a digit, put down a digit
+  uint64_t mask = ((uint64_t) 1 << k) - 1;
+  for (; read < a->numDigits; read++) {
+    uint64_t digit = n >> k;
+    n &= mask;
+    a->d[write++] = (unsigned char) digit;
+    n = n * 10 + a->d[read];
+  }
+
+  // Put down the remaining digits
+  while (n > 0) {
+    uint64_t digit = n >> k;
+    n &= mask;
+    if (write < MAX_DIGITS) {
+      a->d[write++] = (unsigned char) digit;
+    } else if (digit > 0) {
+      a->truncated = true;
+    }
+    n *= 10;
+  }
+  a->numDigits = write;
+  trim(a);
+}
+
+// Multiplies a decimal by 2^k (or divides it by 2^-k if k is negative)
+static void shift(Decimal *a, int k) {
+  if (a->numDigits == 0) {
+    return;
+  }
+  if (k > 0) {
+    for (; k > MAX_SHIFT; k -= MAX_SHIFT) {
+      leftShift(a, MAX_SHIFT);
+    }
+    leftShift(a, (unsigned) k);
+  } else if (k < 0) {
+    for (; k < -MAX_SHIFT; k += MAX_SHIFT) {
+      rightShift(a, MAX_SHIFT);
+    }
+    rightShift(a, (unsigned) -k);
+  }
+}
+
+// Checks whether a decimal needs to be rounded up when cutting it off after numDigits digits
+static bool shouldRoundUp(const Decimal *a, int numDigits) {
+  if (numDigits < 0 || numDigits >= a->numDigits) {
+    return false;
+  }
+  if (a->d[numDigits] == 5 && numDigits + 1 == a->numDigits) {
+    // Exactly halfway, round to even
+    // (unless digits were discarded, in which case it is a little more than halfway)
+    if (a->truncated) {
+      return true;
+    }
+    return numDigits > 0 && a->d[numDigits - 1] % 2 == 1;
+  }
+  return a->d[numDigits] >= 5;
+}
+
+// Returns the integer part of a decimal, rounded to the nearest integer (ties to even)
+static uint64_t roundedInteger(const Decimal *a) {
+  if (a->decimalPoint > 20) {
+    return UINT64_MAX;
+  }
+  uint64_t n = 0;
+  int i = 0;
+  for (; i < a->decimalPoint && i < a->numDigits; i++) {
+    n = n * 10 + a->d[i];
+  }
+  for (; i < a->decimalPoint; i++) {
+    n *= 10;
+  }
+  if (shouldRoundUp(a, a->decimalPoint)) {
+    n++;
+  }
+  return n;
+}
+
+// Tries to convert a decimal exactly with one floating-point operation
+// (both the digits and the power of 10 must be exactly representable as doubles).
+// Returns false if the decimal is outside the range where this is exact.
+static bool convertFast(const Decimal *a, double *result) {
+#if FLT_EVAL_METHOD == 0 // Intermediate results must be rounded to double, not to a wider type
+  if (a->truncated || a->numDigits > 19) {
+    return false;
+  }
+  uint64_t digits = 0;
+  for (int i = 0; i < a->numDigits; i++) {
+    digits = digits * 10 + a->d[i];
+  }
+  if (digits > (uint64_t) 1 << 53) {
+    return false;
+  }
+
+  int exponent = a->decimalPoint - a->numDigits;
+  double value = (double) digits;
+  if (exponent >= 0 && exponent <= 22) {
+    *result = value * exactPowersOfTen[exponent];
+    return true;
+  }
+  if (exponent < 0 && exponent >= -22) {
+    *result = value / exactPowersOfTen[-exponent];
+    return true;
+  }
+  if (exponent > 22 && exponent <= 22 + 15) {
+    // Move part of the exponent into the digits while they stay exactly representable
+    // (e.g., 12 * 10^30 = 12000000000 * 10^22)
+    for (; exponent > 22; exponent--) {
+      digits *= 10;
+      if (digits > (uint64_t) 1 << 53) {
+        return false;
+      }
+    }
+    *result = (double) digits * exactPowersOfTen[22];
+    return true;
+  }
+#endif
+  return false;
+}
+
+// Converts a decimal to the nearest double by shifting it until its integer part holds the
+// 53 bits of the mantissa, then assembling the bits of the double.
+static double convertSlow(Decimal *a) {
+  const int mantissaBits = 52;
+  const int bias = -1023;
+  int exponent = 0;
+  uint64_t mantissa;
+
+  if (a->numDigits == 0) {
+    return 0;
+  }
+  if (a->decimalPoint > 310) { // Too large for a double
+    return INFINITY;
+  }
+  if (a->decimalPoint < -330) { // Too small for a double
+    return 0;
+  }
+
+  // Scale by powers of two until the decimal is in [0.5, 1)
+  while (a->decimalPoint > 0) {
+    int n = a->decimalPoint >= 9 ? 27 : shiftForDigits[a->decimalPoint];
+    shift(a, -n);
+    exponent += n;
+  }
+  while (a->decimalPoint < 0 || (a->decimalPoint == 0 && a->d[0] < 5)) {
+    int n = -a->decimalPoint >= 9 ? 27 : shiftForDigits[-a->decimalPoint];
+    shift(a, n);
+    exponent -= n;
+  }
+
+  // The range of the mantissa of a double is [1, 2), not [0.5, 1)
+  exponent--;
+
+  // Denormalized numbers have the smallest exponent
+  if (exponent < bias + 1) {
+    int n = bias + 1 - exponent;
+    shift(a, -n);
+    exponent += n;
+  }
+  if (exponent - bias >= 0x7FF) {
+    return INFINITY;
+  }
+
+  // Extract the 53 bits of the mantissa
+  shift(a, 1 + mantissaBits);
+  mantissa = roundedInteger(a);
+
+  // Rounding might have added a bit
+  if (mantissa == (uint64_t) 2 << mantissaBits) {
+    mantissa >>= 1;
+    exponent++;
+    if (exponent - bias >= 0x7FF) {
+      return INFINITY;
+    }
+  }
+
+  // Denormalized numbers don't have the implicit leading 1 bit
+  if ((mantissa & ((uint64_t) 1 << mantissaBits)) == 0) {
+    exponent = bias;
+  }
+
+  uint64_t bits = mantissa & (((uint64_t) 1 << mantissaBits) - 1);
+  bits |= (uint64_t) ((exponent - bias) & 0x7FF) << mantissaBits;
+
+  double result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+double parseNumber(const char *str, int length) {
+  Decimal decimal;
+  readDecimal(&decimal, str, length);
+
+  double result;
+  if (convertFast(&decimal, &result)) {
+    return result;
+  }
+  return convertSlow(&decimal);
+}
@@ -0,0 +1,12 @@
+// Justin Chen
+// Conversion of numeric literals to doubles
+
+#ifndef CALCULATOR_NUMBER_H
+#define CALCULATOR_NUMBER_H
+
+// Converts a numeric literal (RegExp [0-9]+(\.[0-9]*)?) of the given length into the nearest double.
+// Unlike strtod(), this doesn't depend on the locale (the decimal point is always '.')
+// and doesn't need the literal to be null-terminated.
+double parseNumber(const char *str, int length);
+
+#endif // CALCULATOR_NUMBER_H
@@ -0,0 +1,308 @@
+// Justin Chen
+// Operators and functions of the calculator
+
+#include <math.h>     // Math library (pow(), fmod(), sqrt(), sin(), ...)
+#include "operations.h"
+
+double applyOperator(Symbol type, double left, double right) {
+  switch (type) { // Check the type of the operator
+    case ADD: // Addition
+      return left + right;
+    case MINUS: // Subtraction
+      return left - right;
+    case MULTIPLY: // Multiplication
+      return left * right;
+    case DIVIDE: // Division
+      return left / right;
+    case MODULO: // Modulo
+      return fmod(left, right);
+    case POWER: // Exponentiation
+      return power(left, right);
+    case HYPOT: // sqrt(left^2 + right^2)
+      return hypot(left, right);
+    default: // Not a binary operator
+      return NAN;
+  }
+}
+
+double applyFused(Symbol type, double x, double y, double z) {
+  switch (type) { // Check the type of the operation
+    case FUSED_MULTIPLY_ADD: // x * y + z
+      return fma(x, y, z);
+    case FUSED_MULTIPLY_SUBTRACT: // x * y - z
+      return fma(x, y, -z);
+    case FUSED_ADD_MULTIPLY: // x + y * z
+      return fma(y, z, x);
+    case FUSED_SUBTRACT_MULTIPLY: // x - y * z
+      return fma(-y, z, x);
+    default: // Not a fused operation
+      return NAN;
+  }
+}
+
+double applyReduction(Symbol type, const double *terms, int count) {
+  switch (type) { // Check the type of the operation
+    case SUM: // Pairwise sum
+      return sumTerms(terms, count);
+    case COMPENSATED_SUM: // Neumaier sum
+      return compensatedSum(terms, count);
+    case PRODUCT: // Pairwise product
+      return multiplyTerms(terms, count);
+    default: // Not a sum or product
+      return NAN;
+  }
+}
+
+double applyFunction(Symbol type, double argument) {
+  switch (type) { // Check the type of the function
+    case SQRT: // Square root
+      return sqrt(argument);
+    case CBRT: // Cube root
+      return cbrt(argument);
+    case LOG: // Log base 10
+      return log10(argument);
+    case LN: // Log base e
+      return log(argument);
+    case SIN: // Sine
+      return sin(degtorad(argument));
+    case COS: // Cosine
+      return cos(degtorad(argument));
+    case TAN: // Tangent
+      return tan(degtorad(argument));
+    case ASIN: // Inverse sine
+      return radtodeg(asin(argument));
+    case ACOS: // Inverse cosine
+      return radtodeg(acos(argument));
+    case ATAN: // Inverse tangent
+      return radtodeg(atan(argument));
+    case SINH: // Hyperbolic sine
+      return radtodeg(sinh(degtorad(argument)));
+    case COSH: // Hyperbolic cosine
+      return radtodeg(cosh(degtorad(argument)));
+    case TANH: // Hyperbolic tangent
+      return radtodeg(tanh(degtorad(argument)));
+    case ASINH: // Inverse hyperbolic sine
+      return radtodeg(asinh(degtorad(argument)));
+    case ACOSH: // Inverse hyperbolic cosine
+      return radtodeg(acosh(degtorad(argument)));
+    case ATANH: // Inverse hyperbolic tangent
+      return radtodeg(atanh(degtorad(argument)));
+    case ABS: // Absolute value
+      return fabs(argument);
+    case FLOOR: // Floor
+      return floor(argument);
+    case CEIL: // Ceiling
+      return ceil(argument);
+    case ROUND: // Round
+      return round(argument);
+    case DEGTORAD: // Degrees to radians
+      return degtorad(argument);
+    case RADTODEG: // Radians to degrees
+      return radtodeg(argument);
+    case INV: // 1 / x
+      return 1.0 / argument;
+    case EXP: // e^x
+      return exp(argument);
+    case LOG1P: // ln(1 + x)
+      return log1p(argument);
+    case EXPM1: // e^x - 1
+      return expm1(argument);
+    default: // Not a function
+      return NAN;
+  }
+}
+
+// Generates random numbers with SplitMix64
+// See https://prng.di.unimi.it/splitmix64.c
+double randomNumber(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  // The top 53 bits fill the mantissa of a double in [0, 1)
+  return (double) (z >> 11) * 0x1.0p-53;
+}
+
+// Operations that are also compiled into the C code of CALC_BACKEND_NATIVE (CMakeLists.txt copies
+// the lines between the markers below into nativePrelude.h), so that it rounds them the same way
+// as the other backends. They can only use <math.h> and the constants of operations.h, and each
+// function has to come after the ones it calls.
+// NATIVE PRELUDE BEGIN
+
+// Degrees to radians
+double degtorad(double degrees) {
+  return degrees * M_PI / 180.0;
+}
+
+// Radians to degrees
+double radtodeg(double radians) {
+  return radians * 180.0 / M_PI;
+}
+
+// Exponentiation by squaring
+// The multiplications are done in this order by every backend (including machine code that
+// unrolls the loop), so they all round the same way. x^2 is x * x, the correctly rounded square.
+// Negative exponents are the reciprocal of the positive power, unless it overflowed or is
+// subnormal (or zero, or NaN): its reciprocal would be 0 or lose precision where pow()'s result
+// is a subnormal, so those go to pow().
+double integerPower(double base, int exponent) {
+  unsigned n = exponent < 0 ? -(unsigned) exponent : (unsigned) exponent;
+  double result = 1, square = base;
+  while (n > 0) {
+    if (n & 1) {
+      result *= square;
+    }
+    n >>= 1;
+    if (n > 0) {
+      square *= square;
+    }
+  }
+  if (exponent < 0) {
+    return isnormal(result) ? 1 / result : pow(base, exponent);
+  }
+  return result;
+}
+
+// Square root (root 2) or cube root (root 3), as an exponent of 0.5 or 1/3
+double rootPower(double base, int root) {
+  if (base > 0) {
+    return root == 2 ? sqrt(base) : cbrt(base);
+  }
+  return pow(base, root == 2 ? 0.5 : 1.0 / 3);
+}
+
+// Exponentiation
+// Small integer powers of any base are multiplied out (see integerPower()), and square and cube
+// roots of positive numbers are taken with sqrt() and cbrt(), which are much faster than pow().
+// Roots of other bases (negative ones, zeros, NaN) and other exponents go to pow(), so their
+// results stay pow()'s.
+double power(double base, double exponent) {
+  if (exponent >= -MAX_INTEGER_EXPONENT && exponent <= MAX_INTEGER_EXPONENT && exponent == (int) exponent) {
+    return integerPower(base, (int) exponent);
+  } else if (exponent == 0.5 || exponent == 1.0 / 3) {
+    return rootPower(base, exponent == 0.5 ? 2 : 3);
+  }
+  return pow(base, exponent);
+}
+
+// Pairwise sum
+// Blocks of up to REDUCTION_BLOCK terms are added into REDUCTION_LANES partial sums (term i into
+// sum i % REDUCTION_LANES), which are independent of each other, so the compiler can keep them in
+// vector registers and add several terms with one instruction, and the partial sums are added
+// pairwise. Longer lists are split in halves (at a multiple of REDUCTION_LANES), so the error
+// grows with the logarithm of the number of terms rather than the number itself. The terms are
+// added in the same order whether they are vectorized or not, so every backend gets the same sum.
+double sumTerms(const double *terms, int count) {
+  if (count < REDUCTION_LANES) {
+    double sum = terms[0];
+    for (int i = 1; i < count; i++) {
+      sum += terms[i];
+    }
+    return sum;
+  } else if (count > REDUCTION_BLOCK) {
+    int half = count / 2 / REDUCTION_LANES * REDUCTION_LANES;
+    return sumTerms(terms, half) + sumTerms(terms + half, count - half);
+  }
+  double lanes[REDUCTION_LANES];
+  for (int j = 0; j < REDUCTION_LANES; j++) {
+    lanes[j] = terms[j];
+  }
+  int i = REDUCTION_LANES;
+  for (; i + REDUCTION_LANES <= count; i += REDUCTION_LANES) {
+    for (int j = 0; j < REDUCTION_LANES; j++) {
+      lanes[j] += terms[i + j];
+    }
+  }
+  double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  for (; i < count; i++) {
+    sum += terms[i];
+  }
+  return sum;
+}
+
+// Pairwise product (in the same order as sumTerms())
+double multiplyTerms(const double *terms, int count) {
+  if (count < REDUCTION_LANES) {
+    double product = terms[0];
+    for (int i = 1; i < count; i++) {
+      product *= terms[i];
+    }
+    return product;
+  } else if (count > REDUCTION_BLOCK) {
+    int half = count / 2 / REDUCTION_LANES * REDUCTION_LANES;
+    return multiplyTerms(terms, half) * multiplyTerms(terms + half, count - half);
+  }
+  double lanes[REDUCTION_LANES];
+  for (int j = 0; j < REDUCTION_LANES; j++) {
+    lanes[j] = terms[j];
+  }
+  int i = REDUCTION_LANES;
+  for (; i + REDUCTION_LANES <= count; i += REDUCTION_LANES) {
+    for (int j = 0; j < REDUCTION_LANES; j++) {
+      lanes[j] *= terms[i + j];
+    }
+  }
+  double product = ((lanes[0] * lanes[1]) * (lanes[2] * lanes[3])) * ((lanes[4] * lanes[5]) * (lanes[6] * lanes[7]));
+  for (; i < count; i++) {
+    product *= terms[i];
+  }
+  return product;
+}
+
+// Compensated sum (Neumaier's variant of Kahan summation)
+// The terms are added in order, and the rounding error of each addition (which is exact to
+// compute) is added up on the side and added to the sum at the end, so the error doesn't grow
+// with the number of terms. If the sum overflows, the errors are meaningless (∞ - ∞), so the
+// sum is returned on its own.
+double compensatedSum(const double *terms, int count) {
+  double sum = terms[0];
+  double compensation = 0;
+  for (int i = 1; i < count; i++) {
+    double term = terms[i];
+    double next = sum + term;
+    if (fabs(sum) >= fabs(term)) {
+      compensation += (sum - next) + term;
+    } else {
+      compensation += (term - next) + sum;
+    }
+    sum = next;
+  }
+  return isfinite(compensation) ? sum + compensation : sum;
+}
+
+// NATIVE PRELUDE END
+
+// Performs factorial on integer values ≥0
+double integerFactorial(double left) {
+  double result = 1;
+  for (int i = 1; i <= left; i++) {
+    result *= i;
+  }
+  return result;
+}
+
+// Implementation of Spouge approximation of factorials
+// See https://en.wikipedia.org/wiki/Spouge%27s_approximation
+// Note: ε_a(z) was discarded, error because of discarding the term is small.
+double spouge(double z) {
+  int a = 15;
+  double result = pow(z + a, z + 0.5) * pow(M_E, -(z + a));
+  double prodValue = sqrt(2 * M_PI);
+  for (int k = 1; k <= a - 1; k++) {
+    prodValue += ((pow(-1, k - 1) / (integerFactorial(k - 1))) * pow(-k + a, k - 0.5) * pow(M_E, -k + a)) / (z + k);
+  }
+  result *= prodValue;
+  return result;
+}
+
+// Hand-implemented factorial calculator
+// Note that callers report an error for negative values before calling this.
+double factorial(double left) {
+  double result;
+  if (floor(left) == left) {
+    result = integerFactorial(left);
+  } else {
+    result = spouge(left);
+  }
+  return result;
+}
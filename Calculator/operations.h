@@ -0,0 +1,60 @@
+// Justin Chen
+// Operators and functions of the calculator
+// These are shared by every way of evaluating an expression, so they all give the same results.
+
+#ifndef CALCULATOR_OPERATIONS_H
+#define CALCULATOR_OPERATIONS_H
+
+#include <stdint.h>   // Fixed-width integers (uint64_t)
+#include "symbol.h"
+
+#ifndef M_PI // Define pi if not defined previously in math.h header
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifndef M_E // Define e if not defined previously in math.h header
+#define M_E 2.71828182845904523536
+#endif
+
+// Applies a binary operator (ADD, MINUS, MULTIPLY, DIVIDE, MODULO, POWER or HYPOT) to its operands
+double applyOperator(Symbol type, double left, double right);
+
+// Applies a fused multiply-add (e.g., FUSED_MULTIPLY_ADD, see ast.h) to its operands x, y and z,
+// in the order they are evaluated
+double applyFused(Symbol type, double x, double y, double z);
+
+// Applies a sum or product of any number of terms (SUM, COMPENSATED_SUM or PRODUCT, see ast.h)
+double applyReduction(Symbol type, const double *terms, int count);
+
+// Applies a function (e.g., SQRT, SIN, INV) to its argument
+// Note that trigonometric functions take/return degrees.
+double applyFunction(Symbol type, double argument);
+
+// Seed of the random number generator state of a new evaluation
+#define RANDOM_SEED 0x2545F4914F6CDD1DULL
+
+// Returns a random number between 0 and 1 and advances the generator state
+// Each evaluation has its own state, so evaluations on different threads don't share anything.
+double randomNumber(uint64_t *state);
+
+// Largest integer exponent (either sign) that powers are multiplied out for
+#define MAX_INTEGER_EXPONENT 8
+
+double power(double base, double exponent); // returns base ^ exponent
+double integerPower(double base, int exponent); // returns base ^ exponent for |exponent| ≤ MAX_INTEGER_EXPONENT
+double rootPower(double base, int root);  // returns base ^ (1 / root) for a root of 2 or 3
+// Number of partial sums (or products) sumTerms() and multiplyTerms() keep, and most terms they
+// add into them before splitting the terms in halves
+#define REDUCTION_LANES 8
+#define REDUCTION_BLOCK 128
+
+double sumTerms(const double *terms, int count);      // returns the pairwise sum of count ≥ 1 terms
+double multiplyTerms(const double *terms, int count); // returns the pairwise product of count ≥ 1 terms
+double compensatedSum(const double *terms, int count); // returns the compensated sum of count ≥ 1 terms
+double factorial(double left);         // returns factorial of a non-negative value
+double integerFactorial(double left);  // returns factorial of integer ≥0
+double spouge(double z);               // implementation of Spouge approximation for factorials
+double degtorad(double degrees);       // converts degrees to radians
+double radtodeg(double radians);       // converts radians to degrees
+
+#endif // CALCULATOR_OPERATIONS_H
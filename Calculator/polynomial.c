@@ -0,0 +1,458 @@
+// Justin Chen
+// Evaluation of polynomials in syntax trees with Horner's rule and Estrin's scheme
+// A polynomial is a sum (of additions, subtractions and negations) of terms that are each a
+// constant times a power of the same variable. Expressions have no variables of their own, so the
+// variable is a value the tree is known to repeat: a repeated subexpression (saved by its first
+// occurrence and loaded by the others, see shareSubexpressions()), pi or e. The nodes are
+// classified from the bottom up as monomials (a coefficient times the variable to a degree, e.g.,
+// '3x^4', 'x * x' or '-x / 2'), polynomials (sums of them) or neither, and the terms of the top of
+// each polynomial are then collected into one coefficient per degree.
+//
+// As parsed, each term computes its power on its own. Horner's rule, (c_n x + c_n-1)x + ... + c_0,
+// takes one multiplication and one addition per degree (which fuseOperations() fuses), but each
+// of them has to wait for the one before it. Polynomials of a high degree use Estrin's scheme
+// instead: p(x) = low(x) + x^m high(x), where m is the largest power of 2 below the number of
+// coefficients and low and high are split the same way, down to linear ones. The halves don't
+// depend on each other, so the processor can compute them at the same time, and x^2, x^4, ... are
+// each squared once and saved in a slot of their own.
+
+#include <stdlib.h>   // Standard library (malloc(), free())
+#include <string.h>   // String functions (memcpy(), memset())
+#include <stdint.h>   // Fixed-width integers (int32_t)
+#include "polynomial.h"
+#include "operations.h"  // Powers (integerPower(), MAX_INTEGER_EXPONENT)
+
+// Highest degree of a polynomial that is rewritten, and the lowest that uses Estrin's scheme
+#define MAX_DEGREE 64
+#define ESTRIN_DEGREE 8
+
+// Number of powers x^1, x^2, x^4, ... that Estrin's scheme may use (up to x^MAX_DEGREE)
+#define MAX_LEVELS 7
+
+// Cost of a power that is computed with pow() (in multiplications, as in simplify.c)
+#define POW_COST 48
+
+// Most nodes a polynomial of a degree is written out as (see writeHorner() and writeEstrin())
+#define MAX_WRITTEN_NODES(degree) (8 * ((degree) + 1) + 4 * MAX_LEVELS)
+
+// Kinds of nodes
+#define NOT_POLYNOMIAL 0
+#define MONOMIAL 1
+#define POLYNOMIAL 2
+
+// Variable of a constant (a monomial of degree 0)
+#define NO_VARIABLE (-1)
+
+// Work items of the stack in collectTerms(): a node, and whether its terms are subtracted
+#define TERM(index, negative) ((index) * 2 + (negative))
+
+// Scratch memory of rewriting the polynomials of a tree (freed when done, so that it doesn't
+// stay with the compiled expression), and the state of writing the new tree
+typedef struct Polynomials {
+    const Ast *ast;
+    int32_t *order;        // Nodes of the tree in evaluation order
+    int32_t *parent;       // Node that uses each node (NO_NODE for the root)
+    unsigned char *kind;   // Whether each node is a monomial, a polynomial or neither
+    int32_t *variable;     // Variable of each monomial and polynomial (NO_VARIABLE for constants)
+    int32_t *degree;       // Degree of each monomial, and highest degree of each polynomial
+    double *coefficient;   // Coefficient of each monomial
+    int32_t *cost;         // Number of operations of each monomial and polynomial
+    int32_t *top;          // Top of the rewritten polynomial each node is part of (NO_NODE if none)
+    int32_t *written;      // Index of each node in the new tree (for the top of a polynomial, the
+                           // variable's operand until it is written)
+    int32_t *work;
+    Ast *output;
+    double *literals;      // Values of the new tree's NUMBER nodes
+    int numLiterals;       // Number of them so far (at first, the number of the tree's)
+    // The polynomial being written out
+    Symbol variableType;   // LOAD_SHARED, MATH_PI or MATH_E
+    int slot;              // Slot of a repeated subexpression
+    int32_t operand;       // Operand of the STORE_SHARED that saves it if the polynomial did (NO_NODE once written)
+    int32_t powers[MAX_LEVELS]; // Slots of x^1, x^2, x^4, ... once saved (NO_NODE before)
+    uint32_t position;
+} Polynomials;
+
+// Returns the variable a node is (NO_VARIABLE if it isn't one): the slot of a repeated
+// subexpression, or the slots after the last one for pi and e
+static int variableOf(const Ast *ast, const AstNode *node) {
+  switch (node->type) {
+    case STORE_SHARED: case LOAD_SHARED:
+      return node->right;
+    case MATH_PI:
+      return ast->numShared;
+    case MATH_E:
+      return ast->numShared + 1;
+    default:
+      return NO_VARIABLE;
+  }
+}
+
+// Returns whether two monomials or polynomials are in the same variable (or either is constant)
+static bool sameVariable(const Polynomials *polynomials, int a, int b) {
+  int first = polynomials->variable[a], second = polynomials->variable[b];
+  return first == NO_VARIABLE || second == NO_VARIABLE || first == second;
+}
+
+// Returns the variable of two monomials or polynomials in the same variable
+static int commonVariable(const Polynomials *polynomials, int a, int b) {
+  return polynomials->variable[a] != NO_VARIABLE ? polynomials->variable[a] : polynomials->variable[b];
+}
+
+// Returns the number of multiplications integerPower() takes for a positive exponent
+static int multiplicationsOf(int exponent) {
+  if (exponent > MAX_INTEGER_EXPONENT) {
+    return POW_COST;
+  }
+  int count = 0;
+  for (int n = exponent; n > 1; n >>= 1) {
+    count += 1 + (n & 1);
+  }
+  return count;
+}
+
+// Marks a node as a monomial
+static void setMonomial(Polynomials *polynomials, int index, double coefficient, int degree, int variable, int cost) {
+  polynomials->kind[index] = MONOMIAL;
+  polynomials->coefficient[index] = coefficient;
+  polynomials->degree[index] = degree;
+  polynomials->variable[index] = variable;
+  polynomials->cost[index] = cost;
+}
+
+// Classifies a node as a monomial, a polynomial or neither, given that its operands have been classified
+static void classifyNode(Polynomials *polynomials, int index) {
+  const Ast *ast = polynomials->ast;
+  const AstNode *node = &ast->nodes[index];
+  unsigned char *kind = polynomials->kind;
+  int32_t *degree = polynomials->degree;
+  double *coefficient = polynomials->coefficient;
+  int32_t *cost = polynomials->cost;
+  int left = node->left, right = node->right;
+  kind[index] = NOT_POLYNOMIAL;
+  switch (node->type) {
+    case NUMBER:
+      setMonomial(polynomials, index, ast->literals[left], 0, NO_VARIABLE, 0);
+      return;
+    case STORE_SHARED: case LOAD_SHARED: case MATH_PI: case MATH_E:
+      setMonomial(polynomials, index, 1, 1, variableOf(ast, node), 0);
+      return;
+    case NEGATE:
+      if (kind[left] == MONOMIAL) {
+        setMonomial(polynomials, index, -coefficient[left], degree[left], polynomials->variable[left], cost[left] + 1);
+      } else if (kind[left] == POLYNOMIAL) {
+        kind[index] = POLYNOMIAL;
+        degree[index] = degree[left];
+        polynomials->variable[index] = polynomials->variable[left];
+        cost[index] = cost[left] + 1;
+      }
+      return;
+    case MULTIPLY:
+      if (kind[left] == MONOMIAL && kind[right] == MONOMIAL && sameVariable(polynomials, left, right) &&
+          degree[left] + degree[right] <= MAX_DEGREE) {
+        setMonomial(polynomials, index, coefficient[left] * coefficient[right], degree[left] + degree[right],
+                    commonVariable(polynomials, left, right), cost[left] + cost[right] + 1);
+      }
+      return;
+    case DIVIDE: // By a constant
+      if (kind[left] == MONOMIAL && kind[right] == MONOMIAL && degree[right] == 0) {
+        setMonomial(polynomials, index, coefficient[left] / coefficient[right], degree[left],
+                    polynomials->variable[left], cost[left] + cost[right] + 1);
+      }
+      return;
+    case POWER: { // To a constant positive integer
+      double exponent = coefficient[right];
+      if (kind[left] == MONOMIAL && kind[right] == MONOMIAL && degree[right] == 0 && exponent >= 1 &&
+          exponent <= MAX_DEGREE && exponent == (int) exponent && degree[left] * (int) exponent <= MAX_DEGREE) {
+        setMonomial(polynomials, index, integerPower(coefficient[left], (int) exponent), degree[left] * (int) exponent,
+                    polynomials->variable[left], cost[left] + cost[right] + multiplicationsOf((int) exponent));
+      }
+      return;
+    }
+    case ADD: case MINUS:
+      if (kind[left] != NOT_POLYNOMIAL && kind[right] != NOT_POLYNOMIAL && sameVariable(polynomials, left, right)) {
+        kind[index] = POLYNOMIAL;
+        degree[index] = degree[left] > degree[right] ? degree[left] : degree[right];
+        polynomials->variable[index] = commonVariable(polynomials, left, right);
+        cost[index] = cost[left] + cost[right] + 1;
+      }
+      return;
+    default:
+      return;
+  }
+}
+
+// Adds up the terms of a polynomial into coefficients (one per degree, up to MAX_DEGREE)
+static void collectTerms(const Polynomials *polynomials, int top, double *coefficients) {
+  const Ast *ast = polynomials->ast;
+  int32_t *work = polynomials->work;
+  int numWork = 0;
+  memset(coefficients, 0, (MAX_DEGREE + 1) * sizeof(double));
+  work[numWork++] = TERM(top, 0);
+  while (numWork > 0) {
+    int32_t item = work[--numWork];
+    int index = item / 2;
+    int negative = item % 2;
+    const AstNode *node = &ast->nodes[index];
+    if (polynomials->kind[index] == MONOMIAL) {
+      double coefficient = polynomials->coefficient[index];
+      coefficients[polynomials->degree[index]] += negative ? -coefficient : coefficient;
+    } else if (node->type == NEGATE) {
+      work[numWork++] = TERM(node->left, !negative);
+    } else {
+      work[numWork++] = TERM(node->left, negative);
+      work[numWork++] = TERM(node->right, node->type == MINUS ? !negative : negative);
+    }
+  }
+}
+
+// Returns the highest degree with a coefficient, at most degree (-1 if there is none)
+static int leadingDegree(const double *coefficients, int degree) {
+  while (degree >= 0 && coefficients[degree] == 0) {
+    degree--;
+  }
+  return degree;
+}
+
+// Returns the number of operations Horner's rule takes for a polynomial (see writeHorner())
+static int hornerCost(const double *coefficients, int degree) {
+  int cost = degree - 1 + (coefficients[degree] != 1);
+  for (int i = 0; i < degree; i++) {
+    cost += coefficients[i] != 0;
+  }
+  return cost;
+}
+
+// Finds the polynomials to rewrite: classifies the nodes from the bottom up, then picks the tops
+// of the polynomials that Horner's rule takes no more operations for, and marks the nodes of
+// each from the top down (a repeated subexpression that is its variable is part of it, but not
+// the subtree that computes it). Finds the number of literals of the tree, adds the most nodes
+// and literals the polynomials are written out as to maxNodes and maxLiterals, and returns the
+// number of polynomials.
+static int findPolynomials(Polynomials *polynomials, int numNodes, int *maxNodes, int *maxLiterals) {
+  const Ast *ast = polynomials->ast;
+  double coefficients[MAX_DEGREE + 1];
+  for (int i = 0; i < numNodes; i++) {
+    int index = polynomials->order[i];
+    const AstNode *node = &ast->nodes[index];
+    polynomials->parent[index] = NO_NODE;
+    if (astHasLeftOperand(node)) {
+      polynomials->parent[node->left] = index;
+    }
+    if (astHasRightOperand(node)) {
+      polynomials->parent[node->right] = index;
+    }
+    classifyNode(polynomials, index);
+    if (node->type == NUMBER && node->left >= polynomials->numLiterals) {
+      polynomials->numLiterals = node->left + 1;
+    }
+  }
+  *maxLiterals += polynomials->numLiterals;
+
+  int numPolynomials = 0;
+  for (int i = 0; i < numNodes; i++) {
+    int index = polynomials->order[i];
+    int parent = polynomials->parent[index];
+    polynomials->top[index] = NO_NODE;
+    if (polynomials->kind[index] != POLYNOMIAL || polynomials->variable[index] == NO_VARIABLE ||
+        (parent != NO_NODE && polynomials->kind[parent] == POLYNOMIAL)) {
+      continue;
+    }
+    collectTerms(polynomials, index, coefficients);
+    int degree = leadingDegree(coefficients, polynomials->degree[index]);
+    if (degree >= 2 && hornerCost(coefficients, degree) <= polynomials->cost[index]) {
+      polynomials->top[index] = index;
+      *maxNodes += MAX_WRITTEN_NODES(degree);
+      *maxLiterals += degree + 1;
+      numPolynomials++;
+    }
+  }
+
+  for (int i = numNodes - 1; i >= 0 && numPolynomials > 0; i--) {
+    int index = polynomials->order[i];
+    int parent = polynomials->parent[index];
+    if (polynomials->top[index] != index && parent != NO_NODE && ast->nodes[parent].type != STORE_SHARED) {
+      polynomials->top[index] = polynomials->top[parent];
+    }
+  }
+  return numPolynomials;
+}
+
+// Appends a node to the new tree
+static int addNode(Polynomials *polynomials, Symbol type, int left, int right) {
+  return astAddNode(polynomials->output, type, left, right, polynomials->position);
+}
+
+// Writes out a coefficient
+static int writeNumber(Polynomials *polynomials, double value) {
+  polynomials->literals[polynomials->numLiterals] = value;
+  return addNode(polynomials, NUMBER, polynomials->numLiterals++, NO_NODE);
+}
+
+// Writes out the variable (the first time, the subexpression that computes it if the polynomial
+// is where it is saved)
+static int writeVariable(Polynomials *polynomials) {
+  if (polynomials->variableType != LOAD_SHARED) {
+    return addNode(polynomials, polynomials->variableType, NO_NODE, NO_NODE);
+  } else if (polynomials->operand != NO_NODE) {
+    int operand = polynomials->operand;
+    polynomials->operand = NO_NODE;
+    return addNode(polynomials, STORE_SHARED, operand, polynomials->slot);
+  }
+  return addNode(polynomials, LOAD_SHARED, NO_NODE, polynomials->slot);
+}
+
+// Writes out x^(2^level), squaring (and saving) it the first time
+static int writePower(Polynomials *polynomials, int level) {
+  if (level == 0) {
+    return writeVariable(polynomials);
+  } else if (polynomials->powers[level] != NO_NODE) {
+    return addNode(polynomials, LOAD_SHARED, NO_NODE, polynomials->powers[level]);
+  }
+  int base = writePower(polynomials, level - 1);
+  int same = writePower(polynomials, level - 1);
+  int square = addNode(polynomials, MULTIPLY, base, same);
+  polynomials->powers[level] = polynomials->output->numShared++;
+  return addNode(polynomials, STORE_SHARED, square, polynomials->powers[level]);
+}
+
+// Writes out a polynomial of a degree (whose leading coefficient isn't 0) with Horner's rule
+static int writeHorner(Polynomials *polynomials, const double *coefficients, int degree) {
+  if (degree == 0) {
+    return writeNumber(polynomials, coefficients[0]);
+  }
+  int value = writeVariable(polynomials);
+  if (coefficients[degree] == -1) {
+    value = addNode(polynomials, NEGATE, value, NO_NODE);
+  } else if (coefficients[degree] != 1) {
+    int coefficient = writeNumber(polynomials, coefficients[degree]);
+    value = addNode(polynomials, MULTIPLY, value, coefficient);
+  }
+  for (int i = degree - 1; i >= 0; i--) {
+    if (coefficients[i] != 0) {
+      int coefficient = writeNumber(polynomials, coefficients[i]);
+      value = addNode(polynomials, ADD, value, coefficient);
+    }
+    if (i > 0) {
+      int variable = writeVariable(polynomials);
+      value = addNode(polynomials, MULTIPLY, value, variable);
+    }
+  }
+  return value;
+}
+
+// Writes out a polynomial of a degree (whose leading coefficient isn't 0) with Estrin's scheme
+static int writeEstrin(Polynomials *polynomials, const double *coefficients, int degree) {
+  if (degree < 2) {
+    return writeHorner(polynomials, coefficients, degree);
+  }
+  int level = 0;
+  while ((2 << level) <= degree) {
+    level++;
+  }
+  int split = 1 << level; // The largest power of 2 up to the degree
+  int lowDegree = leadingDegree(coefficients, split - 1);
+  int low = lowDegree >= 0 ? writeEstrin(polynomials, coefficients, lowDegree) : NO_NODE;
+  int high;
+  if (degree == split && coefficients[split] == 1) {
+    high = writePower(polynomials, level);
+  } else {
+    int factor = writeEstrin(polynomials, coefficients + split, degree - split);
+    int power = writePower(polynomials, level);
+    high = addNode(polynomials, MULTIPLY, factor, power);
+  }
+  return low != NO_NODE ? addNode(polynomials, ADD, low, high) : high;
+}
+
+// Writes out the polynomial with its top at index
+static int writePolynomial(Polynomials *polynomials, int index) {
+  const Ast *ast = polynomials->ast;
+  double coefficients[MAX_DEGREE + 1];
+  collectTerms(polynomials, index, coefficients);
+  int degree = leadingDegree(coefficients, polynomials->degree[index]);
+  int variable = polynomials->variable[index];
+  polynomials->variableType = variable < ast->numShared ? LOAD_SHARED : variable == ast->numShared ? MATH_PI : MATH_E;
+  polynomials->slot = variable;
+  polynomials->operand = polynomials->written[index];
+  polynomials->position = ast->positions[index];
+  for (int level = 0; level < MAX_LEVELS; level++) {
+    polynomials->powers[level] = NO_NODE;
+  }
+  return degree >= ESTRIN_DEGREE ? writeEstrin(polynomials, coefficients, degree) :
+                                   writeHorner(polynomials, coefficients, degree);
+}
+
+// Writes the tree out into output (in evaluation order), with each polynomial replaced by its
+// new form
+static void writeTree(Polynomials *polynomials, int numNodes) {
+  const Ast *ast = polynomials->ast;
+  int32_t *written = polynomials->written;
+  for (int i = 0; i < numNodes; i++) {
+    int index = polynomials->order[i];
+    const AstNode *node = &ast->nodes[index];
+    int top = polynomials->top[index];
+    if (top == index) {
+      written[index] = writePolynomial(polynomials, index);
+    } else if (top != NO_NODE) { // Part of a polynomial, which only keeps its variable's operand
+      if (node->type == STORE_SHARED) {
+        written[top] = written[node->left];
+      }
+    } else {
+      int left = astHasLeftOperand(node) ? written[node->left] : node->left;
+      int right = astHasRightOperand(node) ? written[node->right] : node->right;
+      written[index] = astAddNode(polynomials->output, node->type, left, right, ast->positions[index]);
+    }
+  }
+}
+
+bool rewritePolynomials(Ast *ast, int *root, Arena *arena) {
+  Polynomials polynomials = {ast};
+  polynomials.order = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.parent = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.kind = malloc(ast->numNodes);
+  polynomials.variable = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.degree = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.coefficient = malloc(ast->numNodes * sizeof(double));
+  polynomials.cost = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.top = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.written = malloc(ast->numNodes * sizeof(int32_t));
+  polynomials.work = malloc(2 * (size_t) ast->numNodes * sizeof(int32_t));
+  bool rewritten = polynomials.order != NULL && polynomials.parent != NULL && polynomials.kind != NULL &&
+                   polynomials.variable != NULL && polynomials.degree != NULL && polynomials.coefficient != NULL &&
+                   polynomials.cost != NULL && polynomials.top != NULL && polynomials.written != NULL &&
+                   polynomials.work != NULL;
+  if (rewritten) {
+    int numNodes = astPostOrder(ast, *root, polynomials.order, polynomials.work);
+    int maxNodes = numNodes, maxLiterals = 0;
+    int numPolynomials = findPolynomials(&polynomials, numNodes, &maxNodes, &maxLiterals);
+
+    // Only rebuild the tree if a polynomial is rewritten
+    if (numPolynomials > 0) {
+      Ast output = {NULL, NULL, 0, NULL, ast->numShared};
+      output.nodes = arenaAllocate(arena, maxNodes * sizeof(AstNode));
+      output.positions = arenaAllocate(arena, maxNodes * sizeof(uint32_t));
+      polynomials.literals = arenaAllocate(arena, maxLiterals * sizeof(double));
+      rewritten = output.nodes != NULL && output.positions != NULL && polynomials.literals != NULL;
+      if (rewritten) {
+        // The literals of the tree are kept where they are, and the coefficients go after them
+        memcpy(polynomials.literals, ast->literals, polynomials.numLiterals * sizeof(double));
+        memset(polynomials.written, 0xFF, ast->numNodes * sizeof(int32_t));
+        polynomials.output = &output;
+        writeTree(&polynomials, numNodes);
+        output.literals = polynomials.literals;
+        *ast = output;
+        *root = output.numNodes - 1;
+      }
+    }
+  }
+  free(polynomials.order);
+  free(polynomials.parent);
+  free(polynomials.kind);
+  free(polynomials.variable);
+  free(polynomials.degree);
+  free(polynomials.coefficient);
+  free(polynomials.cost);
+  free(polynomials.top);
+  free(polynomials.written);
+  free(polynomials.work);
+  return rewritten;
+}
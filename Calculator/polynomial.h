@@ -0,0 +1,22 @@
+// Justin Chen
+// Evaluation of polynomials in syntax trees with Horner's rule and Estrin's scheme
+
+#ifndef CALCULATOR_POLYNOMIAL_H
+#define CALCULATOR_POLYNOMIAL_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+#include "arena.h"    // Memory of the new tree (Arena)
+
+// Rewrites each polynomial in the tree with its root at *root, e.g., '3x^4 + 2x^3 - x + 7' where
+// x is a repeated subexpression (or pi or e), into Horner's rule, '(((3x + 2)x)x - 1)x + 7', or,
+// if its degree is high, Estrin's scheme (see polynomial.c), when that takes fewer operations
+// than computing each power on its own. The terms are collected into one coefficient per power
+// and added in a different order, which changes results, so this is only run with
+// CalcOptions.fastMath. If a polynomial is rewritten, the tree is rebuilt from arena (with the
+// coefficients in a larger copy of the literals) and *root is updated. This has to be run after
+// shareSubexpressions() (which finds the variable) and before fuseOperations() (which turns the
+// steps of Horner's rule into fused multiply-adds). Returns false if out of memory.
+bool rewritePolynomials(Ast *ast, int *root, Arena *arena);
+
+#endif // CALCULATOR_POLYNOMIAL_H
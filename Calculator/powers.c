@@ -0,0 +1,22 @@
+// Justin Chen
+// Strength reduction of powers in syntax trees
+// A power is only rewritten into an operation that gives exactly what power() would, so the
+// reduced tree gives the same results (negative bases included) whether it is run or not.
+
+#include "powers.h"
+#include "operations.h"  // Powers (power(), integerPower(), rootPower(), MAX_INTEGER_EXPONENT)
+
+void reducePowers(Ast *ast) {
+  for (int i = 0; i < ast->numNodes; i++) {
+    AstNode *node = &ast->nodes[i];
+    if (node->type != POWER || ast->nodes[node->right].type != NUMBER) {
+      continue;
+    }
+    double exponent = ast->literals[ast->nodes[node->right].left];
+    if (exponent >= -MAX_INTEGER_EXPONENT && exponent <= MAX_INTEGER_EXPONENT && exponent == (int) exponent) {
+      *node = (AstNode) {INTEGER_POWER, node->left, (int) exponent};
+    } else if (exponent == 0.5 || exponent == 1.0 / 3) {
+      *node = (AstNode) {ROOT_POWER, node->left, exponent == 0.5 ? 2 : 3};
+    }
+  }
+}
@@ -0,0 +1,17 @@
+// Justin Chen
+// Strength reduction of powers in syntax trees
+
+#ifndef CALCULATOR_POWERS_H
+#define CALCULATOR_POWERS_H
+
+#include "ast.h"      // Syntax trees (Ast)
+
+// Rewrites the powers with a constant exponent that power() doesn't need pow() for: small
+// integer exponents become INTEGER_POWER nodes (multiplied out by squaring) and exponents of 0.5
+// and 1/3 become ROOT_POWER nodes (sqrt() and cbrt() for positive bases), so that the backends
+// can compile them without a call or any checks of the exponent. The results are the same as
+// power()'s. Nodes are rewritten in place (the exponents' nodes are left unreachable). This has to
+// be run after shareSubexpressions(), which takes the right field of every node to be an operand.
+void reducePowers(Ast *ast);
+
+#endif // CALCULATOR_POWERS_H
@@ -0,0 +1,527 @@
+// Justin Chen
+// Register-machine code compiled from syntax trees, and its interpreter
+// Compared to the stack machine of bytecode.c, constants are never pushed (they are kept in
+// registers of their own), and an instruction names the registers it uses, so one instruction
+// can do the work of several stack-machine ones, e.g., '2x + 1' is one REG_MULTIPLY_ADD.
+// Multiplications (and conversions from degrees to radians) are kept pending while compiling
+// until it is known whether the operation that uses them can do them itself (a
+// superinstruction) or they have to be done on their own.
+
+#include <math.h>     // Math library (pow(), fmod(), sqrt(), sin(), ...)
+#include "registers.h"
+#include "operations.h"  // Powers, factorials, conversions and random numbers (power(), factorial(), degtorad())
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTED_GOTO
+#endif
+
+// Define enumeration of kinds of operands
+typedef enum OperandKind {
+    OPERAND_VALUE,    // A value in register left
+    OPERAND_PRODUCT,  // left * right, not done yet
+    OPERAND_RADIANS   // degtorad(left), not done yet
+} OperandKind;
+
+// Define struct Operand
+// A value the compiled instructions have (or will have) computed, waiting for the operation that uses it
+typedef struct Operand {
+    OperandKind kind;
+    uint32_t left;
+    uint32_t right;
+    uint32_t position;  // Position of the operation that isn't done yet
+} Operand;
+
+// State of compiling a tree
+// Registers below numConstants hold constants, and the next numShared ones hold repeated
+// subexpressions. The others are temporaries, used like a stack: the operands waiting on the
+// operand stack hold the temporaries below nextRegister, in order.
+typedef struct Compiler {
+    const Ast *ast;
+    RegisterProgram *program;
+    Operand *operands;     // Operand stack
+    int numOperands;
+    uint32_t nextConstant; // Register of the next constant
+    uint32_t nextRegister; // First temporary that isn't in use
+    uint32_t temporaries;  // First temporary
+    int maxTerms;          // Most terms of a sum or product
+} Compiler;
+
+// Returns the first temporary an operand holds (nextRegister if it holds none)
+static uint32_t firstTemporary(const Compiler *compiler, const Operand *operand) {
+  uint32_t first = compiler->nextRegister;
+  if (operand->left >= compiler->temporaries && operand->left < first) {
+    first = operand->left;
+  }
+  if (operand->kind == OPERAND_PRODUCT && operand->right >= compiler->temporaries && operand->right < first) {
+    first = operand->right;
+  }
+  return first;
+}
+
+// Returns a new temporary
+static uint32_t allocate(Compiler *compiler) {
+  RegisterProgram *program = compiler->program;
+  uint32_t reg = compiler->nextRegister++;
+  if ((int) compiler->nextRegister > program->numRegisters) {
+    program->numRegisters = (int) compiler->nextRegister;
+  }
+  return reg;
+}
+
+// Frees the temporaries held by the top count operands, pops them and returns the register for
+// the result of the operation that uses them
+static uint32_t popOperands(Compiler *compiler, int count) {
+  uint32_t first = compiler->nextRegister;
+  for (int i = compiler->numOperands - count; i < compiler->numOperands; i++) {
+    uint32_t temporary = firstTemporary(compiler, &compiler->operands[i]);
+    if (temporary < first) {
+      first = temporary;
+    }
+  }
+  compiler->numOperands -= count;
+  compiler->nextRegister = first;
+  return allocate(compiler);
+}
+
+// Appends an instruction
+static void emit(Compiler *compiler, RegisterOpcode opcode, uint32_t result, uint32_t left, uint32_t right,
+                 uint32_t extra, uint32_t position) {
+  RegisterProgram *program = compiler->program;
+  program->code[program->length] = (RegisterInstruction) {(unsigned char) opcode, result, left, right, extra};
+  program->positions[program->length] = position;
+  program->length++;
+}
+
+// Does the multiplication of a pending product (or the conversion of pending radians), so that
+// its value is in a register
+// The result goes in a temporary the product already holds if there is one, so it is freed
+// with the operand.
+static void materialize(Compiler *compiler, Operand *operand) {
+  if (operand->kind == OPERAND_VALUE) {
+    return;
+  }
+  uint32_t result = firstTemporary(compiler, operand);
+  if (result == compiler->nextRegister) {
+    result = allocate(compiler);
+  }
+  if (operand->kind == OPERAND_PRODUCT) {
+    emit(compiler, REG_MULTIPLY, result, operand->left, operand->right, 0, operand->position);
+  } else {
+    emit(compiler, REG_DEGTORAD, result, operand->left, 0, 0, operand->position);
+  }
+  *operand = (Operand) {OPERAND_VALUE, result, 0, 0};
+}
+
+// Returns whether a register holds a constant with a value
+static bool isConstant(const Compiler *compiler, uint32_t reg, double value) {
+  return reg < (uint32_t) compiler->program->numConstants && compiler->program->registers[reg] == value;
+}
+
+// Pushes a value in a register
+static void pushValue(Compiler *compiler, uint32_t reg) {
+  compiler->operands[compiler->numOperands++] = (Operand) {OPERAND_VALUE, reg, 0, 0};
+}
+
+// Returns the opcode of a binary operator or function
+static RegisterOpcode opcodeOf(Symbol type) {
+  switch (type) {
+    case ADD: return REG_ADD;
+    case MINUS: return REG_SUBTRACT;
+    case MULTIPLY: return REG_MULTIPLY;
+    case DIVIDE: return REG_DIVIDE;
+    case MODULO: return REG_MODULO;
+    case POWER: return REG_POWER;
+    case HYPOT: return REG_HYPOT;
+    case NEGATE: return REG_NEGATE;
+    case FACTORIAL: return REG_FACTORIAL;
+    case SQRT: return REG_SQRT;
+    case CBRT: return REG_CBRT;
+    case LOG: return REG_LOG;
+    case LN: return REG_LN;
+    case SIN: return REG_SIN;
+    case COS: return REG_COS;
+    case TAN: return REG_TAN;
+    case ASIN: return REG_ASIN;
+    case ACOS: return REG_ACOS;
+    case ATAN: return REG_ATAN;
+    case SINH: return REG_SINH;
+    case COSH: return REG_COSH;
+    case TANH: return REG_TANH;
+    case ASINH: return REG_ASINH;
+    case ACOSH: return REG_ACOSH;
+    case ATANH: return REG_ATANH;
+    case ABS: return REG_ABS;
+    case DEGTORAD: return REG_DEGTORAD;
+    case RADTODEG: return REG_RADTODEG;
+    case FLOOR: return REG_FLOOR;
+    case CEIL: return REG_CEIL;
+    case ROUND: return REG_ROUND;
+    case INV: return REG_INV;
+    case LOG1P: return REG_LOG1P;
+    case EXPM1: return REG_EXPM1;
+    default: return REG_EXP;
+  }
+}
+
+// Compiles an addition or subtraction, fusing it with a pending product of either operand
+// Addition is commutative (with the same rounding), so 'c + a * b' is done as 'a * b + c'.
+static void compileAddition(Compiler *compiler, Symbol type, uint32_t position) {
+  Operand *left = &compiler->operands[compiler->numOperands - 2];
+  Operand *right = &compiler->operands[compiler->numOperands - 1];
+  if (left->kind == OPERAND_RADIANS) { // Only products are fused here
+    materialize(compiler, left);
+  }
+  if (right->kind == OPERAND_RADIANS) {
+    materialize(compiler, right);
+  }
+  if (left->kind == OPERAND_PRODUCT && right->kind == OPERAND_PRODUCT) {
+    materialize(compiler, left);
+  }
+
+  Operand a = *left, b = *right;
+  uint32_t result = popOperands(compiler, 2);
+  if (a.kind == OPERAND_PRODUCT) {
+    emit(compiler, type == ADD ? REG_MULTIPLY_ADD : REG_MULTIPLY_SUBTRACT, result, a.left, a.right, b.left, position);
+  } else if (b.kind == OPERAND_PRODUCT) {
+    emit(compiler, type == ADD ? REG_MULTIPLY_ADD : REG_SUBTRACT_MULTIPLY, result, b.left, b.right, a.left, position);
+  } else {
+    emit(compiler, opcodeOf(type), result, a.left, b.left, 0, position);
+  }
+  pushValue(compiler, result);
+}
+
+// Compiles a fused multiply-add on the top three operands, x, y and z (see applyFused())
+static void compileFused(Compiler *compiler, Symbol type, uint32_t position) {
+  for (int i = compiler->numOperands - 3; i < compiler->numOperands; i++) {
+    materialize(compiler, &compiler->operands[i]);
+  }
+  uint32_t x = compiler->operands[compiler->numOperands - 3].left;
+  uint32_t y = compiler->operands[compiler->numOperands - 2].left;
+  uint32_t z = compiler->operands[compiler->numOperands - 1].left;
+  uint32_t result = popOperands(compiler, 3);
+  switch (type) {
+    case FUSED_MULTIPLY_ADD: emit(compiler, REG_FUSED_MULTIPLY_ADD, result, x, y, z, position); break;
+    case FUSED_MULTIPLY_SUBTRACT: emit(compiler, REG_FUSED_MULTIPLY_SUBTRACT, result, x, y, z, position); break;
+    case FUSED_ADD_MULTIPLY: emit(compiler, REG_FUSED_MULTIPLY_ADD, result, y, z, x, position); break;
+    default: emit(compiler, REG_FUSED_SUBTRACT_MULTIPLY, result, y, z, x, position); break;
+  }
+  pushValue(compiler, result);
+}
+
+// Compiles a sum or product of the top count operands, listing their registers in program->terms
+static void compileReduction(Compiler *compiler, Symbol type, int count, uint32_t position) {
+  RegisterProgram *program = compiler->program;
+  uint32_t first = (uint32_t) program->numTerms;
+  for (int i = compiler->numOperands - count; i < compiler->numOperands; i++) {
+    materialize(compiler, &compiler->operands[i]);
+    program->terms[program->numTerms++] = compiler->operands[i].left;
+  }
+  if (count > compiler->maxTerms) {
+    compiler->maxTerms = count;
+  }
+  uint32_t result = popOperands(compiler, count);
+  RegisterOpcode opcode = type == SUM ? REG_SUM : type == COMPENSATED_SUM ? REG_COMPENSATED_SUM : REG_PRODUCT;
+  emit(compiler, opcode, result, first, (uint32_t) count, 0, position);
+  pushValue(compiler, result);
+}
+
+// Compiles the operation of a node (its operands have to be compiled already)
+static void compileNode(Compiler *compiler, int index) {
+  const AstNode *node = &compiler->ast->nodes[index];
+  uint32_t position = compiler->ast->positions[index];
+  switch (node->type) {
+    case NUMBER: case MATH_PI: case MATH_E: // Constants are in the registers they were numbered with
+      pushValue(compiler, compiler->nextConstant++);
+      return;
+    case RAND_NUM: {
+      uint32_t result = allocate(compiler);
+      emit(compiler, REG_RANDOM, result, 0, 0, 0, position);
+      pushValue(compiler, result);
+      return;
+    }
+    case STORE_SHARED: { // The value goes in its shared register, instead of a temporary
+      Operand *operand = &compiler->operands[compiler->numOperands - 1];
+      materialize(compiler, operand);
+      uint32_t shared = (uint32_t) compiler->program->numConstants + (uint32_t) node->right;
+      RegisterProgram *program = compiler->program;
+      if (operand->left >= compiler->temporaries && program->code[program->length - 1].result == operand->left) {
+        program->code[program->length - 1].result = shared; // A temporary is the result of the last instruction
+      } else {
+        emit(compiler, REG_COPY, shared, operand->left, 0, 0, position);
+      }
+      compiler->nextRegister = firstTemporary(compiler, operand);
+      compiler->numOperands--;
+      pushValue(compiler, shared);
+      return;
+    }
+    case LOAD_SHARED:
+      pushValue(compiler, (uint32_t) compiler->program->numConstants + (uint32_t) node->right);
+      return;
+    case INTEGER_POWER: case ROOT_POWER: { // The exponent is part of the instruction
+      Operand *operand = &compiler->operands[compiler->numOperands - 1];
+      materialize(compiler, operand);
+      uint32_t base = operand->left;
+      uint32_t result = popOperands(compiler, 1);
+      if (node->type == ROOT_POWER) {
+        emit(compiler, node->right == 2 ? REG_SQRT_POWER : REG_CBRT_POWER, result, base, 0, 0, position);
+      } else if (node->right == 2) {
+        emit(compiler, REG_SQUARE, result, base, 0, 0, position);
+      } else {
+        emit(compiler, REG_INTEGER_POWER, result, base, 0, (uint32_t) node->right, position);
+      }
+      pushValue(compiler, result);
+      return;
+    }
+    case MULTIPLY: { // Done by the operation that uses it if it can
+      Operand *left = &compiler->operands[compiler->numOperands - 2];
+      Operand *right = &compiler->operands[compiler->numOperands - 1];
+      materialize(compiler, left);
+      materialize(compiler, right);
+      Operand product = {OPERAND_PRODUCT, left->left, right->left, position};
+      compiler->numOperands -= 2;
+      compiler->operands[compiler->numOperands++] = product;
+      return;
+    }
+    case ADD: case MINUS:
+      compileAddition(compiler, node->type, position);
+      return;
+    case OPERAND_PAIR: // Both operands wait for the fused operation (or the sum)
+      return;
+    case FUSED_MULTIPLY_ADD: case FUSED_MULTIPLY_SUBTRACT: case FUSED_ADD_MULTIPLY: case FUSED_SUBTRACT_MULTIPLY:
+      compileFused(compiler, node->type, position);
+      return;
+    case SUM: case COMPENSATED_SUM: case PRODUCT:
+      compileReduction(compiler, node->type, node->right, position);
+      return;
+    case DIVIDE: case MODULO: case POWER: case HYPOT: {
+      Operand *left = &compiler->operands[compiler->numOperands - 2];
+      Operand *right = &compiler->operands[compiler->numOperands - 1];
+      materialize(compiler, left);
+      materialize(compiler, right);
+      uint32_t a = left->left, b = right->left;
+      uint32_t result = popOperands(compiler, 2);
+      if (node->type == POWER && isConstant(compiler, b, 2)) { // x^2 is x * x (see power())
+        emit(compiler, REG_SQUARE, result, a, 0, 0, position);
+      } else {
+        emit(compiler, opcodeOf(node->type), result, a, b, 0, position);
+      }
+      pushValue(compiler, result);
+      return;
+    }
+    case DEGTORAD: { // Done by sin(), cos() or tan() if one of them uses it
+      Operand *operand = &compiler->operands[compiler->numOperands - 1];
+      materialize(compiler, operand);
+      *operand = (Operand) {OPERAND_RADIANS, operand->left, 0, position};
+      return;
+    }
+    default: { // Unary operators and functions
+      Operand *operand = &compiler->operands[compiler->numOperands - 1];
+      RegisterOpcode opcode = opcodeOf(node->type);
+      if (operand->kind == OPERAND_RADIANS && (node->type == SIN || node->type == COS || node->type == TAN)) {
+        opcode = node->type == SIN ? REG_SIN_DEGTORAD : node->type == COS ? REG_COS_DEGTORAD : REG_TAN_DEGTORAD;
+      } else {
+        materialize(compiler, operand);
+      }
+      uint32_t argument = operand->left;
+      uint32_t result = popOperands(compiler, 1);
+      emit(compiler, opcode, result, argument, 0, 0, position);
+      pushValue(compiler, result);
+      return;
+    }
+  }
+}
+
+// Returns whether a node is a constant (which gets a register of its own)
+static bool isConstantNode(const AstNode *node) {
+  return node->type == NUMBER || node->type == MATH_PI || node->type == MATH_E;
+}
+
+bool compileRegisters(const Ast *ast, int root, RegisterProgram *program, Arena *arena) {
+  // Each node produces at most one instruction (a product is either fused into the operation
+  // that uses it or done on its own, and an OPERAND_PAIR produces none), plus the REG_RETURN
+  program->code = arenaAllocate(arena, (ast->numNodes + 1) * sizeof(RegisterInstruction));
+  program->positions = arenaAllocate(arena, (ast->numNodes + 1) * sizeof(uint32_t));
+  int32_t *order = arenaAllocate(arena, ast->numNodes * sizeof(int32_t));
+  int32_t *work = arenaAllocate(arena, 2 * ast->numNodes * sizeof(int32_t));
+  Operand *operands = arenaAllocate(arena, ast->numNodes * sizeof(Operand));
+  program->terms = arenaAllocate(arena, ast->numNodes * sizeof(uint32_t));
+  program->length = 0;
+  program->numTerms = 0;
+  if (program->code == NULL || program->positions == NULL || order == NULL || work == NULL || operands == NULL ||
+      program->terms == NULL) {
+    return false;
+  }
+
+  // Number the constants in the order they are compiled, then the temporaries come after them
+  int numNodes = astPostOrder(ast, root, order, work);
+  program->numConstants = 0;
+  for (int i = 0; i < numNodes; i++) {
+    program->numConstants += isConstantNode(&ast->nodes[order[i]]);
+  }
+  program->numShared = ast->numShared;
+  program->numRegisters = program->numConstants + program->numShared;
+  program->registers = arenaAllocate(arena, (ast->numNodes + ast->numShared) * sizeof(double));
+  if (program->registers == NULL) {
+    return false;
+  }
+  for (int i = 0, constant = 0; i < numNodes; i++) {
+    const AstNode *node = &ast->nodes[order[i]];
+    if (isConstantNode(node)) {
+      program->registers[constant++] = node->type == NUMBER ? ast->literals[node->left] :
+                                       node->type == MATH_PI ? M_PI : M_E;
+    }
+  }
+
+  Compiler compiler = {ast, program, operands, 0, 0, (uint32_t) program->numRegisters, (uint32_t) program->numRegisters, 0};
+  for (int i = 0; i < numNodes; i++) {
+    compileNode(&compiler, order[i]);
+  }
+  Operand *result = &compiler.operands[0];
+  materialize(&compiler, result);
+  emit(&compiler, REG_RETURN, 0, result->left, 0, 0, ast->positions[root]);
+  program->termValues = arenaAllocate(arena, compiler.maxTerms * sizeof(double));
+  return compiler.maxTerms == 0 || program->termValues != NULL;
+}
+
+// Copies the values of the terms of a sum or product into program->termValues and returns it
+static const double *gatherTerms(const RegisterProgram *program, const RegisterInstruction *instruction) {
+  const uint32_t *terms = &program->terms[instruction->left];
+  for (uint32_t i = 0; i < instruction->right; i++) {
+    program->termValues[i] = program->registers[terms[i]];
+  }
+  return program->termValues;
+}
+
+double runRegisters(const RegisterProgram *program, const AstEvaluation *evaluation) {
+  const RegisterInstruction *ip = program->code;  // Next instruction
+  const RegisterInstruction *instruction;         // Current instruction
+  double *r = program->registers;
+
+#ifdef COMPUTED_GOTO
+  static const void *labels[] = {
+      [REG_RANDOM] = &&op_RANDOM,
+      [REG_ADD] = &&op_ADD, [REG_SUBTRACT] = &&op_SUBTRACT, [REG_MULTIPLY] = &&op_MULTIPLY,
+      [REG_DIVIDE] = &&op_DIVIDE, [REG_MODULO] = &&op_MODULO, [REG_POWER] = &&op_POWER,
+      [REG_NEGATE] = &&op_NEGATE, [REG_FACTORIAL] = &&op_FACTORIAL,
+      [REG_SQRT] = &&op_SQRT, [REG_CBRT] = &&op_CBRT, [REG_LOG] = &&op_LOG, [REG_LN] = &&op_LN,
+      [REG_SIN] = &&op_SIN, [REG_COS] = &&op_COS, [REG_TAN] = &&op_TAN,
+      [REG_ASIN] = &&op_ASIN, [REG_ACOS] = &&op_ACOS, [REG_ATAN] = &&op_ATAN,
+      [REG_SINH] = &&op_SINH, [REG_COSH] = &&op_COSH, [REG_TANH] = &&op_TANH,
+      [REG_ASINH] = &&op_ASINH, [REG_ACOSH] = &&op_ACOSH, [REG_ATANH] = &&op_ATANH,
+      [REG_ABS] = &&op_ABS, [REG_DEGTORAD] = &&op_DEGTORAD, [REG_RADTODEG] = &&op_RADTODEG,
+      [REG_FLOOR] = &&op_FLOOR, [REG_CEIL] = &&op_CEIL, [REG_ROUND] = &&op_ROUND,
+      [REG_INV] = &&op_INV, [REG_EXP] = &&op_EXP, [REG_LOG1P] = &&op_LOG1P, [REG_EXPM1] = &&op_EXPM1,
+      [REG_FUSED_MULTIPLY_ADD] = &&op_FUSED_MULTIPLY_ADD, [REG_FUSED_MULTIPLY_SUBTRACT] = &&op_FUSED_MULTIPLY_SUBTRACT,
+      [REG_FUSED_SUBTRACT_MULTIPLY] = &&op_FUSED_SUBTRACT_MULTIPLY, [REG_HYPOT] = &&op_HYPOT, [REG_COPY] = &&op_COPY,
+      [REG_SUM] = &&op_SUM, [REG_COMPENSATED_SUM] = &&op_COMPENSATED_SUM, [REG_PRODUCT] = &&op_PRODUCT,
+      [REG_SQUARE] = &&op_SQUARE, [REG_INTEGER_POWER] = &&op_INTEGER_POWER,
+      [REG_SQRT_POWER] = &&op_SQRT_POWER, [REG_CBRT_POWER] = &&op_CBRT_POWER, [REG_MULTIPLY_ADD] = &&op_MULTIPLY_ADD,
+      [REG_MULTIPLY_SUBTRACT] = &&op_MULTIPLY_SUBTRACT, [REG_SUBTRACT_MULTIPLY] = &&op_SUBTRACT_MULTIPLY,
+      [REG_SIN_DEGTORAD] = &&op_SIN_DEGTORAD, [REG_COS_DEGTORAD] = &&op_COS_DEGTORAD,
+      [REG_TAN_DEGTORAD] = &&op_TAN_DEGTORAD,
+      [REG_RETURN] = &&op_RETURN,
+  };
+#define CASE(opcode) op_##opcode:
+#define DISPATCH() instruction = ip++; goto *labels[instruction->opcode]
+  DISPATCH();
+#else
+#define CASE(opcode) case REG_##opcode:
+#define DISPATCH() continue
+  for (;;) {
+    instruction = ip++;
+    switch (instruction->opcode) {
+#endif
+
+// Registers of the current instruction
+#define RESULT r[instruction->result]
+#define LEFT r[instruction->left]
+#define RIGHT r[instruction->right]
+#define EXTRA r[instruction->extra]
+
+  CASE(RANDOM) RESULT = randomNumber(evaluation->randomState); DISPATCH();
+
+  // Binary operators (the same operations as applyOperator())
+  CASE(ADD) RESULT = LEFT + RIGHT; DISPATCH();
+  CASE(SUBTRACT) RESULT = LEFT - RIGHT; DISPATCH();
+  CASE(MULTIPLY) RESULT = LEFT * RIGHT; DISPATCH();
+  CASE(DIVIDE) RESULT = LEFT / RIGHT; DISPATCH();
+  CASE(MODULO) RESULT = fmod(LEFT, RIGHT); DISPATCH();
+  CASE(POWER) RESULT = power(LEFT, RIGHT); DISPATCH();
+  CASE(HYPOT) RESULT = hypot(LEFT, RIGHT); DISPATCH();
+
+  // Superinstructions (each operation is rounded on its own, as if done by separate instructions)
+  CASE(SQUARE) RESULT = LEFT * LEFT; DISPATCH();
+  CASE(INTEGER_POWER) RESULT = integerPower(LEFT, (int) instruction->extra); DISPATCH();
+  CASE(SQRT_POWER) RESULT = rootPower(LEFT, 2); DISPATCH();
+  CASE(CBRT_POWER) RESULT = rootPower(LEFT, 3); DISPATCH();
+  CASE(MULTIPLY_ADD) RESULT = LEFT * RIGHT + EXTRA; DISPATCH();
+  CASE(MULTIPLY_SUBTRACT) RESULT = LEFT * RIGHT - EXTRA; DISPATCH();
+  CASE(SUBTRACT_MULTIPLY) RESULT = EXTRA - LEFT * RIGHT; DISPATCH();
+  CASE(SIN_DEGTORAD) RESULT = sin(degtorad(degtorad(LEFT))); DISPATCH(); // Both conversions, as in applyFunction()
+  CASE(COS_DEGTORAD) RESULT = cos(degtorad(degtorad(LEFT))); DISPATCH();
+  CASE(TAN_DEGTORAD) RESULT = tan(degtorad(degtorad(LEFT))); DISPATCH();
+
+  // Fused operations (rounded once, the same operations as applyFused())
+  CASE(FUSED_MULTIPLY_ADD) RESULT = fma(LEFT, RIGHT, EXTRA); DISPATCH();
+  CASE(FUSED_MULTIPLY_SUBTRACT) RESULT = fma(LEFT, RIGHT, -EXTRA); DISPATCH();
+  CASE(FUSED_SUBTRACT_MULTIPLY) RESULT = fma(-LEFT, RIGHT, EXTRA); DISPATCH();
+
+  // Sums and products (the same operations as applyReduction())
+  CASE(SUM) RESULT = sumTerms(gatherTerms(program, instruction), (int) instruction->right); DISPATCH();
+  CASE(COMPENSATED_SUM) RESULT = compensatedSum(gatherTerms(program, instruction), (int) instruction->right); DISPATCH();
+  CASE(PRODUCT) RESULT = multiplyTerms(gatherTerms(program, instruction), (int) instruction->right); DISPATCH();
+
+  // Unary operators
+  CASE(NEGATE) RESULT = -LEFT; DISPATCH();
+  CASE(FACTORIAL)
+    if (LEFT < 0) {
+      evaluation->domainError(evaluation->context, program->positions[instruction - program->code]);
+      RESULT = 0;
+    } else {
+      RESULT = factorial(LEFT);
+    }
+    DISPATCH();
+
+  // Functions (the same operations as applyFunction())
+  CASE(SQRT) RESULT = sqrt(LEFT); DISPATCH();
+  CASE(CBRT) RESULT = cbrt(LEFT); DISPATCH();
+  CASE(LOG) RESULT = log10(LEFT); DISPATCH();
+  CASE(LN) RESULT = log(LEFT); DISPATCH();
+  CASE(SIN) RESULT = sin(degtorad(LEFT)); DISPATCH();
+  CASE(COS) RESULT = cos(degtorad(LEFT)); DISPATCH();
+  CASE(TAN) RESULT = tan(degtorad(LEFT)); DISPATCH();
+  CASE(ASIN) RESULT = radtodeg(asin(LEFT)); DISPATCH();
+  CASE(ACOS) RESULT = radtodeg(acos(LEFT)); DISPATCH();
+  CASE(ATAN) RESULT = radtodeg(atan(LEFT)); DISPATCH();
+  CASE(SINH) RESULT = radtodeg(sinh(degtorad(LEFT))); DISPATCH();
+  CASE(COSH) RESULT = radtodeg(cosh(degtorad(LEFT))); DISPATCH();
+  CASE(TANH) RESULT = radtodeg(tanh(degtorad(LEFT))); DISPATCH();
+  CASE(ASINH) RESULT = radtodeg(asinh(degtorad(LEFT))); DISPATCH();
+  CASE(ACOSH) RESULT = radtodeg(acosh(degtorad(LEFT))); DISPATCH();
+  CASE(ATANH) RESULT = radtodeg(atanh(degtorad(LEFT))); DISPATCH();
+  CASE(ABS) RESULT = fabs(LEFT); DISPATCH();
+  CASE(DEGTORAD) RESULT = degtorad(LEFT); DISPATCH();
+  CASE(RADTODEG) RESULT = radtodeg(LEFT); DISPATCH();
+  CASE(FLOOR) RESULT = floor(LEFT); DISPATCH();
+  CASE(CEIL) RESULT = ceil(LEFT); DISPATCH();
+  CASE(ROUND) RESULT = round(LEFT); DISPATCH();
+  CASE(INV) RESULT = 1.0 / LEFT; DISPATCH();
+  CASE(EXP) RESULT = exp(LEFT); DISPATCH();
+  CASE(LOG1P) RESULT = log1p(LEFT); DISPATCH();
+  CASE(EXPM1) RESULT = expm1(LEFT); DISPATCH();
+
+  CASE(COPY) RESULT = LEFT; DISPATCH();
+
+  CASE(RETURN) return LEFT;
+
+#ifndef COMPUTED_GOTO
+    }
+  }
+#endif
+#undef RESULT
+#undef LEFT
+#undef RIGHT
+#undef EXTRA
+#undef CASE
+#undef DISPATCH
+}
@@ -0,0 +1,81 @@
+// Justin Chen
+// Register-machine code compiled from syntax trees, and its interpreter
+
+#ifndef CALCULATOR_REGISTERS_H
+#define CALCULATOR_REGISTERS_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include <stdint.h>   // Fixed-width integers (uint32_t)
+#include "ast.h"      // Syntax trees (Ast, AstEvaluation)
+#include "arena.h"    // Memory of the program (Arena)
+
+// Define enumeration of instructions
+// Each instruction reads its operands from registers and writes its result to a register.
+// The first registers hold the constants of the expression, so constants never need to be loaded,
+// and the next ones hold the values of repeated subexpressions (see shareSubexpressions()).
+typedef enum RegisterOpcode {
+    REG_RANDOM,                    // result = random number ('rand')
+    REG_ADD, REG_SUBTRACT,         // result = left (operator) right
+    REG_MULTIPLY, REG_DIVIDE,
+    REG_MODULO, REG_POWER, REG_HYPOT,
+    REG_NEGATE, REG_FACTORIAL,     // result = (operator) left
+    REG_SQRT, REG_CBRT, REG_LOG, REG_LN,   // result = function(left)
+    REG_SIN, REG_COS, REG_TAN, REG_ASIN, REG_ACOS, REG_ATAN,
+    REG_SINH, REG_COSH, REG_TANH, REG_ASINH, REG_ACOSH, REG_ATANH,
+    REG_ABS, REG_DEGTORAD, REG_RADTODEG, REG_FLOOR, REG_CEIL, REG_ROUND, REG_INV, REG_EXP, REG_LOG1P, REG_EXPM1,
+    REG_FUSED_MULTIPLY_ADD,        // result = left * right + extra, rounded once (fma())
+    REG_FUSED_MULTIPLY_SUBTRACT,   // result = left * right - extra, rounded once
+    REG_FUSED_SUBTRACT_MULTIPLY,   // result = extra - left * right, rounded once
+    REG_SUM, REG_COMPENSATED_SUM,  // result = sum (or product) of the right registers listed in terms from index left
+    REG_PRODUCT,
+    REG_COPY,                      // result = left
+
+    // Superinstructions: common patterns of operations done by one instruction
+    REG_SQUARE,                    // result = left ^ 2
+    REG_INTEGER_POWER,             // result = left ^ extra (an integer exponent, see integerPower())
+    REG_SQRT_POWER, REG_CBRT_POWER, // result = left ^ 0.5 or left ^ (1/3) (see rootPower())
+    REG_MULTIPLY_ADD,              // result = left * right + extra
+    REG_MULTIPLY_SUBTRACT,         // result = left * right - extra
+    REG_SUBTRACT_MULTIPLY,         // result = extra - left * right
+    REG_SIN_DEGTORAD,              // result = sin(degtorad(left)) as written in an expression (sin() takes degrees)
+    REG_COS_DEGTORAD, REG_TAN_DEGTORAD,
+
+    REG_RETURN                     // Return left
+} RegisterOpcode;
+
+// Define struct RegisterInstruction
+// An instruction and the registers it uses (the ones it doesn't use are 0)
+typedef struct RegisterInstruction {
+    unsigned char opcode;  // RegisterOpcode
+    uint32_t result;
+    uint32_t left;
+    uint32_t right;
+    uint32_t extra;
+} RegisterInstruction;
+
+// Define struct RegisterProgram
+// A compiled expression for the register machine. The arrays are allocated from an arena.
+typedef struct RegisterProgram {
+    RegisterInstruction *code;  // Instructions, ending with REG_RETURN
+    uint32_t *positions;        // Position of the token of each instruction (for error messages)
+    int length;                 // Number of instructions
+    double *registers;          // Registers, starting with the constants (their values are set by the compiler)
+    int numConstants;
+    int numShared;              // Number of registers after the constants that hold repeated subexpressions
+    int numRegisters;
+    uint32_t *terms;            // Registers of the terms of the REG_SUM, REG_COMPENSATED_SUM and REG_PRODUCT instructions
+    int numTerms;
+    double *termValues;         // Where those instructions gather the values of their terms (as many as the longest has)
+} RegisterProgram;
+
+// Compiles the tree with its root at index into a register program allocated from arena.
+// Returns false if out of memory.
+bool compileRegisters(const Ast *ast, int root, RegisterProgram *program, Arena *arena);
+
+// Runs a register program and returns the result.
+// The operations are done in the same order as evaluateAst() does the ones that matter (drawing
+// random numbers and reporting errors), and each one is rounded the same way, so the results
+// are the same.
+double runRegisters(const RegisterProgram *program, const AstEvaluation *evaluation);
+
+#endif // CALCULATOR_REGISTERS_H
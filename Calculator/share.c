@@ -0,0 +1,234 @@
+// Justin Chen
+// Common subexpression elimination of syntax trees
+// Identical subtrees are found by hash-consing: the nodes are visited in order (operands first)
+// and looked up in a hash table by their type and their operands' canonical nodes (the first
+// node found with the same structure), which turns the tree into a DAG where each distinct
+// subexpression is one node. The DAG is then written out as a tree again, in evaluation order,
+// with the later occurrences of a repeated subexpression replaced by LOAD_SHARED nodes, so that
+// every backend still evaluates a tree (and draws random numbers in the same order).
+
+#include <stdlib.h>   // Standard library (malloc(), calloc(), free())
+#include <string.h>   // String functions (memcpy(), memset())
+#include <stdint.h>   // Fixed-width integers (int32_t, uint64_t)
+#include "share.h"
+
+// Work items of the stack in writeTree() (as in ast.c)
+#define VISIT(index) ((index) * 2)
+#define FINISH(index) ((index) * 2 + 1)
+
+// Scratch memory of finding the repeated subexpressions (freed when done, so that it doesn't stay
+// with the compiled expression)
+typedef struct Sharing {
+    const Ast *ast;
+    int32_t *canonical;   // First node with the same structure as each node
+    unsigned char *pure;  // Whether each node's subtree can be shared (doesn't depend on 'rand', can't fail)
+    unsigned char *reached; // Whether each node is in the tree (or, later, in the DAG)
+    int32_t *uses;        // Number of nodes of the DAG that use each node
+    int32_t *table;       // Hash table of canonical nodes (NO_NODE if empty)
+    uint64_t tableMask;   // Number of entries of the table - 1 (a power of 2)
+} Sharing;
+
+// Returns the canonical node of a node's operand
+static int32_t operandOf(const Sharing *sharing, int32_t operand) {
+  return operand == NO_NODE ? NO_NODE : sharing->canonical[operand];
+}
+
+// Returns the hash of a node's structure: its type and its operands' canonical nodes, or the
+// value of a number
+static uint64_t hashNode(const Sharing *sharing, const AstNode *node) {
+  uint64_t key;
+  if (node->type == NUMBER) {
+    memcpy(&key, &sharing->ast->literals[node->left], sizeof(key));
+  } else {
+    key = (uint64_t) (uint32_t) operandOf(sharing, node->left) << 32 | (uint32_t) operandOf(sharing, node->right);
+  }
+  key ^= node->type * 0x9E3779B97F4A7C15ULL;
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// Returns whether two nodes have the same structure
+static bool sameNode(const Sharing *sharing, const AstNode *a, const AstNode *b) {
+  if (a->type != b->type) {
+    return false;
+  } else if (a->type == NUMBER) {
+    return memcmp(&sharing->ast->literals[a->left], &sharing->ast->literals[b->left], sizeof(double)) == 0;
+  }
+  return operandOf(sharing, a->left) == operandOf(sharing, b->left) &&
+         operandOf(sharing, a->right) == operandOf(sharing, b->right);
+}
+
+// Returns whether a node can be shared, given that its operands have been looked at
+static bool isPure(const Sharing *sharing, const AstNode *node) {
+  const Ast *ast = sharing->ast;
+  if (node->type == RAND_NUM) { // Each occurrence draws its own number
+    return false;
+  } else if (node->type == FACTORIAL) { // Each occurrence reports its own error
+    const AstNode *operand = &ast->nodes[node->left];
+    return operand->type == NUMBER && ast->literals[operand->left] >= 0;
+  } else if (!astHasLeftOperand(node)) {
+    return true;
+  }
+  return sharing->pure[node->left] && (!astHasRightOperand(node) || sharing->pure[node->right]);
+}
+
+// Finds the canonical node of every node in the tree (in order, so operands come first)
+static void findCanonicalNodes(Sharing *sharing, int root) {
+  const Ast *ast = sharing->ast;
+
+  // Nodes left over from folding aren't in the tree
+  sharing->reached[root] = 1;
+  for (int i = root; i >= 0; i--) {
+    const AstNode *node = &ast->nodes[i];
+    if (sharing->reached[i] && astHasLeftOperand(node)) {
+      sharing->reached[node->left] = 1;
+      if (astHasRightOperand(node)) {
+        sharing->reached[node->right] = 1;
+      }
+    }
+  }
+
+  for (int i = 0; i <= root; i++) {
+    const AstNode *node = &ast->nodes[i];
+    sharing->canonical[i] = i;
+    if (!sharing->reached[i] || !(sharing->pure[i] = isPure(sharing, node))) {
+      continue;
+    }
+    uint64_t entry = hashNode(sharing, node) & sharing->tableMask;
+    while (sharing->table[entry] != NO_NODE && !sameNode(sharing, &ast->nodes[sharing->table[entry]], node)) {
+      entry = (entry + 1) & sharing->tableMask;
+    }
+    if (sharing->table[entry] == NO_NODE) {
+      sharing->table[entry] = i;
+    } else {
+      sharing->canonical[i] = sharing->table[entry];
+    }
+  }
+}
+
+// Counts the uses of the nodes of the DAG, and returns the number of nodes of the tree it is
+// written out as (see writeTree()). Stores the number of repeated subexpressions in numRepeated.
+static int countUses(Sharing *sharing, int root, int *numRepeated) {
+  const Ast *ast = sharing->ast;
+  memset(sharing->reached, 0, ast->numNodes);
+  sharing->reached[sharing->canonical[root]] = 1;
+  int numNodes = 0;
+  *numRepeated = 0;
+  for (int i = root; i >= 0; i--) {
+    const AstNode *node = &ast->nodes[i];
+    if (!sharing->reached[i]) {
+      continue;
+    }
+    if (!astHasLeftOperand(node)) { // Written out for every use
+      numNodes += sharing->uses[i] > 1 ? sharing->uses[i] : 1;
+      continue;
+    }
+    // Written out once, then a STORE_SHARED and a LOAD_SHARED for every other use if repeated
+    if (sharing->uses[i] > 1) {
+      numNodes += sharing->uses[i];
+      (*numRepeated)++;
+    }
+    numNodes++;
+    int32_t left = sharing->canonical[node->left];
+    sharing->uses[left]++;
+    sharing->reached[left] = 1;
+    if (astHasRightOperand(node)) {
+      int32_t right = sharing->canonical[node->right];
+      sharing->uses[right]++;
+      sharing->reached[right] = 1;
+    }
+  }
+  return numNodes;
+}
+
+// Writes the DAG out as a tree into output (in evaluation order). The first occurrence of a
+// repeated subexpression is written out and saved in a slot, and the others load it.
+// Returns false if out of memory.
+static bool writeTree(const Sharing *sharing, int root, Ast *output) {
+  const Ast *ast = sharing->ast;
+  int32_t *slots = malloc(ast->numNodes * sizeof(int32_t));
+  int32_t *work = malloc(2 * (size_t) output->numNodes * sizeof(int32_t));
+  int32_t *values = malloc((size_t) output->numNodes * sizeof(int32_t));
+  bool written = slots != NULL && work != NULL && values != NULL;
+  if (written) {
+    memset(slots, 0xFF, ast->numNodes * sizeof(int32_t));
+    int total = output->numNodes;
+    int numWork = 0, numValues = 0;
+    output->numNodes = 0;
+    output->numShared = 0;
+    work[numWork++] = VISIT(sharing->canonical[root]);
+    while (numWork > 0) {
+      int32_t item = work[--numWork];
+      int index = item / 2;
+      const AstNode *node = &ast->nodes[index];
+      uint32_t position = ast->positions[index];
+      if (slots[index] != NO_NODE) { // Evaluated before
+        values[numValues++] = astAddNode(output, LOAD_SHARED, NO_NODE, slots[index], position);
+      } else if (!astHasLeftOperand(node)) {
+        values[numValues++] = astAddNode(output, node->type, node->left, NO_NODE, position);
+      } else if (item == VISIT(index)) {
+        work[numWork++] = FINISH(index);
+        if (astHasRightOperand(node)) {
+          work[numWork++] = VISIT(sharing->canonical[node->right]);
+        }
+        work[numWork++] = VISIT(sharing->canonical[node->left]);
+      } else {
+        int right = astHasRightOperand(node) ? values[--numValues] : NO_NODE;
+        int left = values[--numValues];
+        int value = astAddNode(output, node->type, left, right, position);
+        if (sharing->uses[index] > 1) {
+          slots[index] = output->numShared++;
+          value = astAddNode(output, STORE_SHARED, value, slots[index], position);
+        }
+        values[numValues++] = value;
+      }
+    }
+    written = output->numNodes == total;
+  }
+  free(slots);
+  free(work);
+  free(values);
+  return written;
+}
+
+bool shareSubexpressions(Ast *ast, int *root, Arena *arena) {
+  Sharing sharing = {ast, NULL, NULL, NULL, NULL, NULL, 0};
+  uint64_t tableSize = 1;
+  while (tableSize < 2 * (uint64_t) ast->numNodes) {
+    tableSize *= 2;
+  }
+  sharing.tableMask = tableSize - 1;
+  sharing.canonical = malloc(ast->numNodes * sizeof(int32_t));
+  sharing.pure = calloc(ast->numNodes, 1);
+  sharing.reached = calloc(ast->numNodes, 1);
+  sharing.uses = calloc(ast->numNodes, sizeof(int32_t));
+  sharing.table = malloc(tableSize * sizeof(int32_t));
+  bool shared = sharing.canonical != NULL && sharing.pure != NULL && sharing.reached != NULL &&
+                sharing.uses != NULL && sharing.table != NULL;
+  if (shared) {
+    memset(sharing.table, 0xFF, tableSize * sizeof(int32_t));
+    findCanonicalNodes(&sharing, *root);
+    int numRepeated;
+    Ast output = {NULL, NULL, countUses(&sharing, *root, &numRepeated), ast->literals, 0};
+
+    // Only rebuild the tree if something is repeated (each repeated subtree has at least 2
+    // nodes, so loading it instead is never larger, even with the node that saves it)
+    if (numRepeated > 0) {
+      output.nodes = arenaAllocate(arena, output.numNodes * sizeof(AstNode));
+      output.positions = arenaAllocate(arena, output.numNodes * sizeof(uint32_t));
+      shared = output.nodes != NULL && output.positions != NULL && writeTree(&sharing, *root, &output);
+      if (shared) {
+        *ast = output;
+        *root = output.numNodes - 1;
+      }
+    }
+  }
+  free(sharing.canonical);
+  free(sharing.pure);
+  free(sharing.reached);
+  free(sharing.uses);
+  free(sharing.table);
+  return shared;
+}
@@ -0,0 +1,19 @@
+// Justin Chen
+// Common subexpression elimination of syntax trees
+
+#ifndef CALCULATOR_SHARE_H
+#define CALCULATOR_SHARE_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+#include "arena.h"    // Memory of the new tree (Arena)
+
+// Finds the subexpressions that are repeated in the tree with its root at *root, so that each is
+// evaluated once per evaluation: the first occurrence saves its value (STORE_SHARED) and the
+// others reuse it (LOAD_SHARED). Subexpressions that depend on 'rand' aren't shared (each
+// occurrence draws its own numbers), and neither are factorials that may fail (each occurrence
+// reports its own error). If there are repeated subexpressions, the tree is rebuilt from arena
+// (with fewer nodes) and *root is updated. Returns false if out of memory.
+bool shareSubexpressions(Ast *ast, int *root, Arena *arena);
+
+#endif // CALCULATOR_SHARE_H
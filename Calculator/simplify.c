@@ -0,0 +1,680 @@
+// Justin Chen
+// Equality saturation of syntax trees: rewriting expressions into their cheapest equivalent form
+// The tree is loaded into an e-graph, a set of classes of equivalent nodes where the operands of
+// a node are classes rather than nodes, so that one node stands for every combination of the
+// forms of its operands. Rewrite rules add the forms they find to the class of the node they
+// match (nothing is ever removed), and classes that turn out to hold the same node are merged
+// (see rebuild()). Once no rule finds anything new (or the rounds or the node budget run out),
+// the cheapest form is extracted according to a cost model of the backends' operations.
+//
+// Random numbers and factorials that may fail are never merged with anything that looks the
+// same, since each occurrence has a value (or an error) of its own. Rules keep their order:
+// operands are only swapped if at most one of them draws random numbers or reports errors, and
+// no rule copies or drops such an operand, so the extracted tree evaluates them in the same order.
+
+#include <stdlib.h>   // Standard library (malloc(), calloc(), free())
+#include <string.h>   // String functions (memcpy(), memset())
+#include <stdint.h>   // Fixed-width integers (int32_t, uint64_t)
+#include <math.h>     // Math library (INFINITY, frexp())
+#include "simplify.h"
+#include "operations.h"  // Operators and functions (applyOperator(), applyFunction(), factorial())
+
+// Most rounds of rewriting, and most nodes the e-graph may grow to
+#define MAX_ROUNDS 8
+#define MAX_NODES(numNodes) (4 * (numNodes) + 256)
+
+// Most nodes of a class that a rule looks at (a class that deep nesting collapses into one, e.g.
+// all of 'abs(abs(...abs(x)))', would otherwise make every node's rules look at all of them)
+#define MAX_MATCHES 64
+
+// Work items of the stack in writeTree() (as in ast.c)
+#define VISIT(index) ((index) * 2)
+#define FINISH(index) ((index) * 2 + 1)
+
+// Define struct ENode
+// A node of the e-graph. Its operands are classes (and every constant is a NUMBER with its value).
+typedef struct ENode {
+    unsigned char type;   // Symbol of the operation
+    int32_t left;         // Classes of the operands (NO_NODE if none)
+    int32_t right;
+    int32_t unique;       // NO_NODE, or the node itself for nodes that are never merged ('rand' and factorials that may fail)
+    double value;         // Value of a NUMBER
+    uint32_t position;    // Position of the token it came from (for errors)
+} ENode;
+
+// Define struct EGraph
+// Classes are numbered after the node that created them, and merged classes are kept in a
+// union-find forest (the root is the class they are merged into).
+typedef struct EGraph {
+    ENode *nodes;
+    int numNodes;
+    int maxNodes;
+    int32_t *parent;          // Union-find parent of each class
+    unsigned char *pure;      // Whether evaluating a class draws no random numbers and reports no errors
+    unsigned char *constant;  // Whether the value of a class is known
+    double *value;
+    int32_t *table;           // Hash table of the nodes that can be merged (NO_NODE if empty)
+    uint64_t tableMask;
+    int32_t *memberStart;     // Nodes of each class as of the last rebuild (indices into members)
+    int32_t *members;
+    int numMembered;          // Number of classes memberStart covers
+    bool fastMath;
+    bool changed;             // Whether a node was added or classes were merged
+} EGraph;
+
+// Returns the class a class has been merged into
+static int32_t find(EGraph *graph, int32_t c) {
+  while (graph->parent[c] != c) {
+    graph->parent[c] = graph->parent[graph->parent[c]];
+    c = graph->parent[c];
+  }
+  return c;
+}
+
+// Returns the hash of a node (its operands have to be the roots of their classes)
+static uint64_t hashNode(const ENode *node) {
+  uint64_t key;
+  memcpy(&key, &node->value, sizeof(key));
+  key ^= (uint64_t) (uint32_t) node->left << 32 | (uint32_t) node->right;
+  key ^= node->type * 0x9E3779B97F4A7C15ULL;
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// Returns whether two nodes are the same (with their operands' classes as they are now)
+static bool sameNode(EGraph *graph, const ENode *a, const ENode *b) {
+  return a->type == b->type && memcmp(&a->value, &b->value, sizeof(double)) == 0 &&
+         (a->left == NO_NODE ? b->left == NO_NODE : b->left != NO_NODE && find(graph, a->left) == find(graph, b->left)) &&
+         (a->right == NO_NODE ? b->right == NO_NODE : b->right != NO_NODE && find(graph, a->right) == find(graph, b->right));
+}
+
+// Returns the entry of the hash table a node is in, or the empty one it would go in
+static uint64_t lookup(EGraph *graph, const ENode *node) {
+  uint64_t entry = hashNode(node) & graph->tableMask;
+  while (graph->table[entry] != NO_NODE && !sameNode(graph, &graph->nodes[graph->table[entry]], node)) {
+    entry = (entry + 1) & graph->tableMask;
+  }
+  return entry;
+}
+
+// Merges two classes (does nothing if either is NO_NODE, for nodes that didn't fit the budget)
+static void merge(EGraph *graph, int32_t a, int32_t b) {
+  if (a == NO_NODE || b == NO_NODE || (a = find(graph, a)) == (b = find(graph, b))) {
+    return;
+  }
+  if (b < a) { // The older class is kept, so that roots are stable
+    int32_t swap = a;
+    a = b;
+    b = swap;
+  }
+  graph->parent[b] = a;
+  graph->pure[a] = graph->pure[a] && graph->pure[b];
+  if (!graph->constant[a] && graph->constant[b]) {
+    graph->constant[a] = 1;
+    graph->value[a] = graph->value[b];
+  }
+  graph->changed = true;
+}
+
+// Returns whether a class has a known value of exactly value (bit for bit, so -0 isn't 0)
+static bool isValue(EGraph *graph, int32_t c, double value) {
+  c = find(graph, c);
+  return graph->constant[c] && memcmp(&graph->value[c], &value, sizeof(double)) == 0;
+}
+
+// Returns whether a class has a known value equal to value (-0 is 0)
+static bool isEqual(EGraph *graph, int32_t c, double value) {
+  c = find(graph, c);
+  return graph->constant[c] && graph->value[c] == value;
+}
+
+// Computes the value of a pure node whose operands have known values (the same operations as
+// evaluateAst()). Returns false if it can't be computed at compile time.
+static bool evaluateNode(EGraph *graph, const ENode *node, double *value) {
+  int32_t left = node->left != NO_NODE ? find(graph, node->left) : NO_NODE;
+  int32_t right = node->right != NO_NODE ? find(graph, node->right) : NO_NODE;
+  if (left == NO_NODE || !graph->constant[left] || (right != NO_NODE && !graph->constant[right])) {
+    return false;
+  }
+  double operand = graph->value[left];
+  switch (node->type) {
+    case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER:
+      *value = applyOperator(node->type, operand, graph->value[right]);
+      return true;
+    case NEGATE:
+      *value = -operand;
+      return true;
+    case FACTORIAL:
+      if (operand < 0) { // Reported when evaluated
+        return false;
+      }
+      *value = factorial(operand);
+      return true;
+    default:
+      *value = applyFunction(node->type, operand);
+      return true;
+  }
+}
+
+// Adds a node (if there isn't the same one already) and returns its class, or NO_NODE if the
+// e-graph is full. A pure node with operands of known values gets its value as well.
+static int32_t addNode(EGraph *graph, ENode node) {
+  node.left = node.left != NO_NODE ? find(graph, node.left) : NO_NODE;
+  node.right = node.right != NO_NODE ? find(graph, node.right) : NO_NODE;
+  uint64_t entry = 0;
+  if (node.unique == NO_NODE) {
+    entry = lookup(graph, &node);
+    if (graph->table[entry] != NO_NODE) {
+      return find(graph, graph->table[entry]);
+    }
+  }
+  if (graph->numNodes == graph->maxNodes) {
+    return NO_NODE;
+  }
+
+  int32_t id = graph->numNodes++;
+  graph->parent[id] = id;
+  graph->constant[id] = 0;
+  if (node.type == RAND_NUM) {
+    graph->pure[id] = 0;
+  } else if (node.type == FACTORIAL) { // Only factorials of non-negative numbers can't fail
+    graph->pure[id] = graph->pure[node.left] && graph->constant[node.left] && !(graph->value[node.left] < 0);
+  } else {
+    graph->pure[id] = (node.left == NO_NODE || graph->pure[node.left]) && (node.right == NO_NODE || graph->pure[node.right]);
+  }
+  if (node.unique != NO_NODE || (node.type == FACTORIAL && !graph->pure[id])) {
+    node.unique = id;
+  } else {
+    graph->table[entry] = id;
+  }
+  graph->nodes[id] = node;
+  graph->changed = true;
+
+  double value;
+  if (node.type == NUMBER) {
+    graph->constant[id] = 1;
+    graph->value[id] = node.value;
+  } else if (graph->pure[id] && evaluateNode(graph, &node, &value)) {
+    merge(graph, id, addNode(graph, (ENode) {NUMBER, NO_NODE, NO_NODE, NO_NODE, value, node.position}));
+  }
+  return find(graph, id);
+}
+
+// Adds a node of an operation and returns its class (NO_NODE if it doesn't fit, or if an operand
+// didn't fit)
+static int32_t add(EGraph *graph, Symbol type, int32_t left, int32_t right, uint32_t position) {
+  if (left == NO_NODE || (right == NO_NODE && (type == ADD || type == MINUS || type == MULTIPLY || type == DIVIDE ||
+                                               type == MODULO || type == POWER))) {
+    return NO_NODE;
+  }
+  return addNode(graph, (ENode) {(unsigned char) type, left, right, NO_NODE, 0, position});
+}
+
+// Adds a number and returns its class
+static int32_t number(EGraph *graph, double value, uint32_t position) {
+  return addNode(graph, (ENode) {NUMBER, NO_NODE, NO_NODE, NO_NODE, value, position});
+}
+
+// Restores the invariants after merging classes: every node's operands are the roots of their
+// classes, and nodes that have become the same are in the same class (which may make more
+// nodes the same, so it is repeated until nothing more is merged). Nodes whose operands now have
+// known values get them. Then the members of each class are listed for the rules to match.
+static void rebuild(EGraph *graph) {
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    memset(graph->table, 0xFF, (graph->tableMask + 1) * sizeof(int32_t));
+    for (int id = 0; id < graph->numNodes; id++) {
+      ENode *node = &graph->nodes[id];
+      node->left = node->left != NO_NODE ? find(graph, node->left) : NO_NODE;
+      node->right = node->right != NO_NODE ? find(graph, node->right) : NO_NODE;
+      int32_t c = find(graph, id);
+      double value;
+      int32_t known;
+      if (!graph->constant[c] && graph->pure[c] && node->type != NUMBER && evaluateNode(graph, node, &value) &&
+          (known = number(graph, value, node->position)) != NO_NODE) {
+        merge(graph, c, known);
+        merged = true;
+      }
+      if (node->unique != NO_NODE) {
+        continue;
+      }
+      uint64_t entry = lookup(graph, node);
+      if (graph->table[entry] == NO_NODE) {
+        graph->table[entry] = id;
+      } else if (find(graph, graph->table[entry]) != find(graph, id)) {
+        merge(graph, graph->table[entry], id);
+        merged = true;
+      }
+    }
+  }
+
+  // List the nodes of each class (counting sort by class)
+  graph->numMembered = graph->numNodes;
+  memset(graph->memberStart, 0, (graph->numNodes + 1) * sizeof(int32_t));
+  for (int id = 0; id < graph->numNodes; id++) {
+    graph->memberStart[find(graph, id) + 1]++;
+  }
+  for (int c = 0; c < graph->numNodes; c++) {
+    graph->memberStart[c + 1] += graph->memberStart[c];
+  }
+  for (int id = 0; id < graph->numNodes; id++) {
+    graph->members[graph->memberStart[find(graph, id)]++] = id;
+  }
+  for (int c = graph->numNodes; c > 0; c--) {
+    graph->memberStart[c] = graph->memberStart[c - 1];
+  }
+  graph->memberStart[0] = 0;
+}
+
+// Returns the nodes of a class as of the last rebuild (*count of them, at most MAX_MATCHES)
+static const int32_t *membersOf(const EGraph *graph, int32_t c, int *count) {
+  if (c == NO_NODE || c >= graph->numMembered) { // A class added since
+    *count = 0;
+    return NULL;
+  }
+  *count = graph->memberStart[c + 1] - graph->memberStart[c];
+  if (*count > MAX_MATCHES) { // The oldest ones, which include the nodes loaded from the tree
+    *count = MAX_MATCHES;
+  }
+  return &graph->members[graph->memberStart[c]];
+}
+
+// Returns whether two operands can be evaluated in either order (at most one of them draws
+// random numbers or reports errors)
+static bool canSwap(EGraph *graph, int32_t a, int32_t b) {
+  return graph->pure[find(graph, a)] || graph->pure[find(graph, b)];
+}
+
+// Returns whether x / value is exactly x * (1 / value) (value is a power of 2 whose reciprocal
+// is a double too)
+static bool hasExactReciprocal(double value) {
+  int exponent;
+  return isfinite(value) && value != 0 && fabs(frexp(value, &exponent)) == 0.5 && isfinite(1 / value) &&
+         (1 / value) * value == 1;
+}
+
+// Adds the forms that the rules find for a node to its class
+// The rules that aren't exact in floating point are only used with fastMath.
+static void applyRules(EGraph *graph, int32_t id) {
+  const ENode node = graph->nodes[id];
+  int32_t c = find(graph, id);
+  int32_t l = node.left, r = node.right;
+  uint32_t p = node.position;
+  bool fast = graph->fastMath;
+  int count = 0;
+  const int32_t *members = NULL;
+  const ENode *nodes = graph->nodes;
+
+// Loops over the nodes of a class, with m pointing at each
+#define FOR_MEMBERS(c, m) \
+  members = membersOf(graph, (c), &count); \
+  for (int i = 0; i < count; i++) \
+    for (const ENode *m = &nodes[members[i]]; m != NULL; m = NULL)
+
+  switch (node.type) {
+    case ADD:
+      if (isValue(graph, r, -0.0) || (fast && isEqual(graph, r, 0))) { // x + -0 is x (x + 0 isn't for -0)
+        merge(graph, c, l);
+      }
+      if (canSwap(graph, l, r)) {
+        merge(graph, c, add(graph, ADD, r, l, p));
+      }
+      FOR_MEMBERS(r, m) if (m->type == NEGATE) { // a + -b is a - b
+        merge(graph, c, add(graph, MINUS, l, m->left, p));
+      }
+      FOR_MEMBERS(l, m) if (m->type == NEGATE && canSwap(graph, m->left, r)) { // -a + b is b - a
+        merge(graph, c, add(graph, MINUS, r, m->left, p));
+      }
+      if (fast) { // (a + b) + c is a + (b + c), and the other way around
+        FOR_MEMBERS(l, m) if (m->type == ADD) {
+          merge(graph, c, add(graph, ADD, m->left, add(graph, ADD, m->right, r, p), p));
+        }
+        FOR_MEMBERS(r, m) if (m->type == ADD) {
+          merge(graph, c, add(graph, ADD, add(graph, ADD, l, m->left, p), m->right, p));
+        }
+      }
+      break;
+    case MINUS:
+      if (graph->constant[find(graph, r)]) { // a - b is a + -b
+        merge(graph, c, add(graph, ADD, l, number(graph, -graph->value[find(graph, r)], p), p));
+      }
+      FOR_MEMBERS(r, m) if (m->type == NEGATE) { // a - -b is a + b
+        merge(graph, c, add(graph, ADD, l, m->left, p));
+      }
+      if (fast && find(graph, l) == find(graph, r) && graph->pure[find(graph, l)]) {
+        merge(graph, c, number(graph, 0, p));
+      }
+      if (fast) { // (a + b) - b is a
+        FOR_MEMBERS(l, m) if (m->type == ADD && find(graph, m->right) == find(graph, r)) {
+          merge(graph, c, m->left);
+        }
+      }
+      break;
+    case MULTIPLY:
+      if (isEqual(graph, r, 1)) {
+        merge(graph, c, l);
+      }
+      if (fast && isEqual(graph, r, 0) && graph->pure[find(graph, l)]) {
+        merge(graph, c, number(graph, 0, p));
+      }
+      if (canSwap(graph, l, r)) {
+        merge(graph, c, add(graph, MULTIPLY, r, l, p));
+      }
+      FOR_MEMBERS(l, m) if (m->type == NEGATE) { // -a * b is -(a * b) (rounding is symmetric)
+        merge(graph, c, add(graph, NEGATE, add(graph, MULTIPLY, m->left, r, p), NO_NODE, p));
+      }
+      FOR_MEMBERS(r, m) if (m->type == NEGATE) {
+        merge(graph, c, add(graph, NEGATE, add(graph, MULTIPLY, l, m->left, p), NO_NODE, p));
+      }
+      if (fast) { // (a * b) * c is a * (b * c), and the other way around
+        FOR_MEMBERS(l, m) if (m->type == MULTIPLY) {
+          merge(graph, c, add(graph, MULTIPLY, m->left, add(graph, MULTIPLY, m->right, r, p), p));
+        }
+        FOR_MEMBERS(r, m) if (m->type == MULTIPLY) {
+          merge(graph, c, add(graph, MULTIPLY, add(graph, MULTIPLY, l, m->left, p), m->right, p));
+        }
+      }
+      break;
+    case DIVIDE:
+      if (isEqual(graph, r, 1)) {
+        merge(graph, c, l);
+      } else if (graph->constant[find(graph, r)] && (fast || hasExactReciprocal(graph->value[find(graph, r)]))) {
+        merge(graph, c, add(graph, MULTIPLY, l, number(graph, 1 / graph->value[find(graph, r)], p), p));
+      }
+      FOR_MEMBERS(l, m) if (m->type == NEGATE) { // -a / b is -(a / b)
+        merge(graph, c, add(graph, NEGATE, add(graph, DIVIDE, m->left, r, p), NO_NODE, p));
+      }
+      FOR_MEMBERS(r, m) if (m->type == NEGATE) {
+        merge(graph, c, add(graph, NEGATE, add(graph, DIVIDE, l, m->left, p), NO_NODE, p));
+      }
+      if (fast && find(graph, l) == find(graph, r) && graph->pure[find(graph, l)]) {
+        merge(graph, c, number(graph, 1, p));
+      }
+      break;
+    case POWER:
+      if (isEqual(graph, r, 1)) { // x^1 is 1 * x (see integerPower())
+        merge(graph, c, l);
+      } else if (isEqual(graph, r, 0) && graph->pure[find(graph, l)]) { // Even for NaN
+        merge(graph, c, number(graph, 1, p));
+      }
+      if (fast && isEqual(graph, l, M_E)) {
+        merge(graph, c, add(graph, EXP, r, NO_NODE, p));
+      }
+      if (fast && (isEqual(graph, r, 2) || isEqual(graph, r, 3))) { // sqrt(x)^2 and cbrt(x)^3 are x
+        FOR_MEMBERS(l, m) if (m->type == (isEqual(graph, r, 2) ? SQRT : CBRT)) {
+          merge(graph, c, m->left);
+        }
+      }
+      break;
+    case NEGATE:
+      FOR_MEMBERS(l, m) if (m->type == NEGATE) {
+        merge(graph, c, m->left);
+      } else if (fast && m->type == MINUS && canSwap(graph, m->left, m->right)) { // -(a - b) is b - a
+        merge(graph, c, add(graph, MINUS, m->right, m->left, p));
+      }
+      break;
+    case ABS:
+      FOR_MEMBERS(l, m) if (m->type == NEGATE) {
+        merge(graph, c, add(graph, ABS, m->left, NO_NODE, p));
+      } else if (m->type == ABS) {
+        merge(graph, c, l);
+      }
+      break;
+    case FLOOR: case CEIL: case ROUND: // Their results are already whole numbers
+      FOR_MEMBERS(l, m) if (m->type == FLOOR || m->type == CEIL || m->type == ROUND) {
+        merge(graph, c, l);
+      }
+      break;
+    case EXP: case LN: case DEGTORAD: case RADTODEG: case INV: { // Inverse functions
+      if (!fast) {
+        break;
+      }
+      Symbol inverse = node.type == EXP ? LN : node.type == LN ? EXP : node.type == DEGTORAD ? RADTODEG :
+                       node.type == RADTODEG ? DEGTORAD : INV;
+      FOR_MEMBERS(l, m) if (m->type == inverse) {
+        merge(graph, c, m->left);
+      }
+      break;
+    }
+    case SQRT: // sqrt(x * x) and sqrt(x^2) are abs(x)
+      if (fast) {
+        FOR_MEMBERS(l, m) if ((m->type == MULTIPLY && find(graph, m->left) == find(graph, m->right) &&
+                               graph->pure[find(graph, m->left)]) ||
+                              (m->type == POWER && isEqual(graph, m->right, 2))) {
+          merge(graph, c, add(graph, ABS, m->left, NO_NODE, p));
+        }
+      }
+      break;
+    default:
+      break;
+  }
+#undef FOR_MEMBERS
+}
+
+// Returns the cost of evaluating a node on its own (roughly in cycles of the backends), given the
+// classes of its operands
+static double costOf(EGraph *graph, const ENode *node) {
+  switch (node->type) {
+    case NUMBER: case ADD: case MINUS: case MULTIPLY: case NEGATE: case ABS:
+      return 1;
+    case FLOOR: case CEIL: case ROUND: case DEGTORAD: case RADTODEG:
+      return 2;
+    case RAND_NUM: case DIVIDE: case INV: case SQRT:
+      return 4;
+    case MODULO:
+      return 16;
+    case POWER: { // Constant exponents that reducePowers() turns into multiplications and roots are cheap
+      int32_t exponent = find(graph, node->right);
+      double value = graph->value[exponent];
+      if (graph->constant[exponent] && ((value >= -MAX_INTEGER_EXPONENT && value <= MAX_INTEGER_EXPONENT &&
+                                         value == (int) value) || value == 0.5 || value == 1.0 / 3)) {
+        return 4;
+      }
+      return 48;
+    }
+    default: // Calls of libm
+      return 24;
+  }
+}
+
+// Finds the cheapest node of every class (best) and its cost (the cost of its whole tree)
+// Costs only go down, so it is repeated until nothing changes.
+static void extract(EGraph *graph, double *cost, int32_t *best) {
+  for (int c = 0; c < graph->numNodes; c++) {
+    cost[c] = INFINITY;
+    best[c] = NO_NODE;
+  }
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    for (int id = 0; id < graph->numNodes; id++) {
+      const ENode *node = &graph->nodes[id];
+      double total = costOf(graph, node);
+      if (node->left != NO_NODE) {
+        total += cost[find(graph, node->left)];
+      }
+      if (node->right != NO_NODE) {
+        total += cost[find(graph, node->right)];
+      }
+      int32_t c = find(graph, id);
+      if (total < cost[c]) {
+        cost[c] = total;
+        best[c] = id;
+        improved = true;
+      }
+    }
+  }
+}
+
+// Writes the cheapest tree of a class into output (in evaluation order), with the values of its
+// numbers in literals. Returns the number of nodes it has (without writing anything if output
+// is NULL), or -1 if out of memory.
+static int writeTree(EGraph *graph, const int32_t *best, int32_t root, Ast *output, double *literals) {
+  int capacity = 64;
+  int32_t *work = malloc(capacity * sizeof(int32_t));
+  int32_t *values = malloc(capacity * sizeof(int32_t));
+  int numWork = 0, numValues = 0, numNodes = 0, numLiterals = 0;
+  if (work == NULL || values == NULL) {
+    free(work);
+    free(values);
+    return -1;
+  }
+  work[numWork++] = VISIT(root);
+  while (numWork > 0) {
+    int32_t item = work[--numWork];
+    int32_t c = item / 2;
+    const ENode *node = &graph->nodes[best[c]];
+    if (numWork + 3 > capacity || numValues + 1 > capacity) { // The stacks are as deep as the tree
+      capacity *= 2;
+      int32_t *newWork = realloc(work, capacity * sizeof(int32_t));
+      work = newWork != NULL ? newWork : work;
+      int32_t *newValues = realloc(values, capacity * sizeof(int32_t));
+      values = newValues != NULL ? newValues : values;
+      if (newWork == NULL || newValues == NULL) {
+        free(work);
+        free(values);
+        return -1;
+      }
+    }
+    if (item == VISIT(c) && node->left != NO_NODE) {
+      work[numWork++] = FINISH(c);
+      if (node->right != NO_NODE) {
+        work[numWork++] = VISIT(find(graph, node->right));
+      }
+      work[numWork++] = VISIT(find(graph, node->left));
+      continue;
+    }
+    numNodes++;
+    if (output == NULL) {
+      continue;
+    }
+    int right = node->right != NO_NODE ? values[--numValues] : NO_NODE;
+    int left = node->left != NO_NODE ? values[--numValues] : NO_NODE;
+    if (node->type == NUMBER) {
+      literals[numLiterals] = node->value;
+      left = numLiterals++;
+    }
+    values[numValues++] = astAddNode(output, node->type, left, right, node->position);
+  }
+  free(work);
+  free(values);
+  return numNodes;
+}
+
+// Loads the tree into the e-graph, with each node added in evaluation order so that its
+// operands are already there. Returns the class of the root and stores the cost of the tree in
+// *cost, or returns NO_NODE if a node can't be loaded.
+static int32_t loadTree(EGraph *graph, const Ast *ast, int root, double *cost) {
+  int32_t *order = malloc(ast->numNodes * sizeof(int32_t));
+  int32_t *work = malloc(2 * (size_t) ast->numNodes * sizeof(int32_t));
+  int32_t *classes = malloc(ast->numNodes * sizeof(int32_t));
+  int32_t rootClass = NO_NODE;
+  if (order != NULL && work != NULL && classes != NULL) {
+    int numNodes = astPostOrder(ast, root, order, work);
+    *cost = 0;
+    for (int i = 0; i < numNodes; i++) {
+      int index = order[i];
+      const AstNode *node = &ast->nodes[index];
+      ENode enode = {node->type, NO_NODE, NO_NODE, NO_NODE, 0, ast->positions[index]};
+      switch (node->type) {
+        case NUMBER: enode.value = ast->literals[node->left]; break;
+        case MATH_PI: enode = (ENode) {NUMBER, NO_NODE, NO_NODE, NO_NODE, M_PI, enode.position}; break;
+        case MATH_E: enode = (ENode) {NUMBER, NO_NODE, NO_NODE, NO_NODE, M_E, enode.position}; break;
+        case RAND_NUM: enode.unique = 0; break; // Set to the node by addNode()
+        case ADD: case MINUS: case MULTIPLY: case DIVIDE: case MODULO: case POWER:
+          enode.left = classes[node->left];
+          enode.right = classes[node->right];
+          break;
+        case STORE_SHARED: case LOAD_SHARED: case INTEGER_POWER: case ROOT_POWER: // Only made by later passes
+          rootClass = NO_NODE;
+          goto done;
+        default:
+          enode.left = classes[node->left];
+          break;
+      }
+      *cost += costOf(graph, &enode);
+      if ((classes[index] = addNode(graph, enode)) == NO_NODE) {
+        goto done;
+      }
+    }
+    rootClass = classes[root];
+  }
+done:
+  free(order);
+  free(work);
+  free(classes);
+  return rootClass;
+}
+
+bool simplifyExpression(Ast *ast, int *root, bool fastMath, Arena *arena) {
+  EGraph graph = {NULL, 0, MAX_NODES(ast->numNodes), NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, 0, fastMath, false};
+  uint64_t tableSize = 1;
+  while (tableSize < 2 * (uint64_t) graph.maxNodes) {
+    tableSize *= 2;
+  }
+  graph.tableMask = tableSize - 1;
+  graph.nodes = malloc(graph.maxNodes * sizeof(ENode));
+  graph.parent = malloc(graph.maxNodes * sizeof(int32_t));
+  graph.pure = malloc(graph.maxNodes);
+  graph.constant = malloc(graph.maxNodes);
+  graph.value = malloc(graph.maxNodes * sizeof(double));
+  graph.table = malloc(tableSize * sizeof(int32_t));
+  graph.memberStart = malloc((graph.maxNodes + 1) * sizeof(int32_t));
+  graph.members = malloc(graph.maxNodes * sizeof(int32_t));
+  double *cost = malloc(graph.maxNodes * sizeof(double));
+  int32_t *best = malloc(graph.maxNodes * sizeof(int32_t));
+  bool simplified = graph.nodes != NULL && graph.parent != NULL && graph.pure != NULL && graph.constant != NULL &&
+                    graph.value != NULL && graph.table != NULL && graph.memberStart != NULL &&
+                    graph.members != NULL && cost != NULL && best != NULL;
+
+  double treeCost = 0;
+  int32_t rootClass = NO_NODE;
+  if (simplified) {
+    memset(graph.table, 0xFF, tableSize * sizeof(int32_t));
+    rootClass = loadTree(&graph, ast, *root, &treeCost);
+  }
+  if (rootClass != NO_NODE) {
+    // Rewrite until nothing new is found (the e-graph is saturated) or the budget runs out
+    for (int round = 0; round < MAX_ROUNDS && graph.changed && graph.numNodes < graph.maxNodes; round++) {
+      rebuild(&graph);
+      graph.changed = false;
+      int numNodes = graph.numNodes;
+      for (int id = 0; id < numNodes; id++) {
+        applyRules(&graph, id);
+      }
+    }
+    rebuild(&graph);
+
+    // Replace the tree if a cheaper one was found
+    extract(&graph, cost, best);
+    rootClass = find(&graph, rootClass);
+    if (cost[rootClass] < treeCost) {
+      int numNodes = writeTree(&graph, best, rootClass, NULL, NULL);
+      Ast output = {arenaAllocate(arena, numNodes * sizeof(AstNode)), arenaAllocate(arena, numNodes * sizeof(uint32_t)),
+                    0, NULL, 0};
+      double *literals = arenaAllocate(arena, numNodes * sizeof(double));
+      output.literals = literals;
+      simplified = numNodes > 0 && output.nodes != NULL && output.positions != NULL && literals != NULL &&
+                   writeTree(&graph, best, rootClass, &output, literals) == numNodes;
+      if (simplified) {
+        *ast = output;
+        *root = output.numNodes - 1;
+      }
+    }
+  }
+
+  free(graph.nodes);
+  free(graph.parent);
+  free(graph.pure);
+  free(graph.constant);
+  free(graph.value);
+  free(graph.table);
+  free(graph.memberStart);
+  free(graph.members);
+  free(cost);
+  free(best);
+  return simplified;
+}
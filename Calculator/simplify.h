@@ -0,0 +1,21 @@
+// Justin Chen
+// Equality saturation of syntax trees: rewriting expressions into their cheapest equivalent form
+
+#ifndef CALCULATOR_SIMPLIFY_H
+#define CALCULATOR_SIMPLIFY_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "ast.h"      // Syntax trees (Ast)
+#include "arena.h"    // Memory of the new tree (Arena)
+
+// Finds the forms of the tree with its root at *root that the rewrite rules of simplify.c make
+// equivalent (e.g., 'x * 1' and 'x', '--x' and 'x', 'a + -b' and 'a - b') and replaces the tree
+// by the cheapest one. Only rules that give exactly the same results are used unless fastMath
+// is set, which adds rules that may change results by rounding or for special values (e.g.,
+// 'ln(exp(x))' is 'x', and sums and products are reassociated). Random numbers are drawn in the
+// same order and errors are reported by the same factorials either way. If a cheaper form is
+// found, the tree is rebuilt from arena and *root is updated. This has to be run before
+// shareSubexpressions() and reducePowers(). Returns false if out of memory.
+bool simplifyExpression(Ast *ast, int *root, bool fastMath, Arena *arena);
+
+#endif // CALCULATOR_SIMPLIFY_H
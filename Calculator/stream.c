@@ -0,0 +1,467 @@
+// Justin Chen
+// Streaming evaluation of expressions of any length
+// The expression is read in chunks and tokenized the same way tokenize() does (including the
+// implicit '*' tokens), but each token is evaluated as soon as it is complete instead of being
+// stored. The parser is the same Pratt parser as expression()/nud()/led(), with the same
+// explicit stack of frames: a frame is an operator (or function, or '(') that is waiting for its
+// right operand, together with the binding power that operand is parsed at. A frame is applied
+// once a token with a binding power no larger than the frame's arrives, which is exactly when
+// the corresponding call of a recursive expression() would have returned.
+
+#include <stdio.h>    // I/O functions (vsnprintf())
+#include <stdlib.h>   // Standard library (malloc(), realloc(), free())
+#include <stdarg.h>   // Variable arguments (va_list) for error messages
+#include <string.h>   // String functions (memset(), memcpy())
+#include <errno.h>    // Error numbers (errno, EINTR)
+#include "stream.h"
+#include "classify.h"    // Character classification (classifyCharacters(), skipClass())
+#include "number.h"      // Numeric literal conversion (parseNumber())
+#include "identifiers.h" // Reserved identifiers (lookupIdentifier())
+#include "operations.h"  // Operators and functions (applyOperator(), applyFunction(), factorial())
+
+#if defined(WIN32)
+#include <io.h>       // File descriptor I/O (_read())
+#define read _read
+#else
+#include <unistd.h>   // File descriptor I/O (read())
+#endif
+
+// Number of characters read from the file descriptor at once
+#define CHUNK_SIZE 65536
+
+// Number of characters of an identifier that are kept (reserved identifiers are much shorter,
+// so longer identifiers are only needed for error messages)
+#define MAX_IDENTIFIER_LENGTH 32
+
+// Define struct Frame
+// An operator, function or '(' that is waiting for its right operand.
+typedef struct Frame {
+    Symbol type;        // Operator/function, or START_BRACKET for '('
+    bool binary;        // Whether the frame holds a left operand (binary operators)
+    int bindingPower;   // Binding power the right operand is parsed at
+    double left;        // Left operand of binary operators
+    long long offset;   // Index of the operator's character
+} Frame;
+
+// Kind of token that is being read when a chunk ends (numbers and identifiers may span chunks)
+typedef enum Pending {
+    PENDING_NONE,
+    PENDING_NUMBER,
+    PENDING_IDENTIFIER
+} Pending;
+
+// Define struct StreamState
+// Holds the state of the lexer and parser between chunks
+typedef struct StreamState {
+    StreamResult *result;
+
+    // Parser state
+    Frame *frames;        // Stack of frames waiting for an operand
+    int numFrames;
+    int capacity;
+    bool expectOperand;   // Whether the next token starts an operand (nud) or follows one (led)
+    double operand;       // Value of the last complete operand
+    Symbol operandType;   // Type of the token that ended the last operand
+    bool omitMultiply;    // Whether a '*' right after a function should be dropped (see tokenizeFunction())
+    long long numTokens;
+    uint64_t randomState; // State of the random number generator used by 'rand'
+
+    // Lexer state
+    Symbol previous;      // Type of the previous token (IDENTIFIER for all identifiers), for implicit '*'
+    Pending pending;      // Kind of token being read
+    long long tokenStart; // Index of the first character of the token being read
+    char *text;           // Characters of the token being read
+    int textLength;       // Number of characters in the token being read
+    int textCapacity;
+    bool seenDecimalPoint;
+} StreamState;
+
+// Records an error (only the first one is kept, as the rest of the input can't be evaluated)
+static void fail(StreamState *s, CalcErrorType type, long long offset, const char *format, ...) {
+  if (s->result->hadError) {
+    return;
+  }
+  s->result->hadError = true;
+  s->result->errorType = type;
+  s->result->offset = offset;
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(s->result->message, sizeof(s->result->message), format, arguments);
+  va_end(arguments);
+}
+
+// Returns the character of an operator token (for error messages)
+static char operatorCharacter(Symbol type) {
+  switch (type) {
+    case ADD: return '+';
+    case MINUS: return '-';
+    case MULTIPLY: return '*';
+    case DIVIDE: return '/';
+    case MODULO: return '%';
+    case POWER: return '^';
+    case FACTORIAL: return '!';
+    default: return '?';
+  }
+}
+
+// Checks if a token type is a function (applied to the operand after it)
+static bool isFunction(Symbol type) {
+  return type == EXP || (type >= SQRT && type <= INV);
+}
+
+static void pushFrame(StreamState *s, Symbol type, bool binary, int bindingPower, long long offset) {
+  if (s->numFrames == s->capacity) {
+    int capacity = s->capacity == 0 ? 64 : s->capacity * 2;
+    Frame *frames = realloc(s->frames, capacity * sizeof(Frame));
+    if (frames == NULL) {
+      fail(s, CALC_MEMORY_ERROR, offset, "Expression is nested too deeply (out of memory).");
+      return;
+    }
+    s->frames = frames;
+    s->capacity = capacity;
+  }
+  Frame frame = {type, binary, bindingPower, s->operand, offset};
+  s->frames[s->numFrames++] = frame;
+  if (s->numFrames > s->result->maxDepth) {
+    s->result->maxDepth = s->numFrames;
+  }
+  s->expectOperand = true;
+}
+
+// Applies the frame on top of the stack to the current operand (its right operand)
+static void applyFrame(StreamState *s) {
+  Frame *frame = &s->frames[--s->numFrames];
+  if (frame->binary) {
+    s->operand = applyOperator(frame->type, frame->left, s->operand);
+  } else if (frame->type == MINUS) {
+    s->operand = -s->operand;
+  } else {
+    s->operand = applyFunction(frame->type, s->operand);
+  }
+}
+
+// Evaluates the next token of the expression (the equivalent of one step of expression())
+static void processToken(StreamState *s, Symbol type, double number, long long offset) {
+  if (s->result->hadError) {
+    return;
+  }
+
+  // Functions take the operand after them, so a '*' right after one is dropped
+  if (s->omitMultiply) {
+    s->omitMultiply = false;
+    if (type == MULTIPLY) {
+      return;
+    }
+  }
+  s->numTokens++;
+
+  if (s->expectOperand) { // Null denotation
+    switch (type) {
+      case NUMBER:
+        s->operand = number;
+        break;
+      case MATH_PI:
+        s->operand = M_PI;
+        break;
+      case MATH_E:
+        s->operand = M_E;
+        break;
+      case RAND_NUM:
+        s->operand = randomNumber(&s->randomState);
+        break;
+      case MINUS: // Negation binds tighter than subtraction
+        pushFrame(s, MINUS, false, 25, offset);
+        return;
+      case START_BRACKET:
+        pushFrame(s, START_BRACKET, false, 0, offset);
+        return;
+      case END_BRACKET:
+        fail(s, CALC_SYNTAX_ERROR, offset, "Parsed unexpected ')' token.");
+        return;
+      case END_OF_EXPRESSION:
+        fail(s, CALC_SYNTAX_ERROR, offset, "Unexpected end of expression.");
+        return;
+      default:
+        if (isFunction(type)) {
+          pushFrame(s, type, false, 40, offset);
+        } else {
+          fail(s, CALC_SYNTAX_ERROR, offset, "Unexpected token '%c'.", operatorCharacter(type));
+        }
+        return;
+    }
+    s->operandType = type;
+    s->expectOperand = false;
+    return;
+  }
+
+  // Left denotation
+  // Throw exception for input like '1 1'
+  if (type == NUMBER && s->operandType == NUMBER) {
+    fail(s, CALC_SYNTAX_ERROR, offset, "Not expecting a number after a number (with no valid operator in between).");
+    return;
+  }
+
+  // Apply every frame whose right operand ends here
+  int bindingPower = bindingPowers[type];
+  while (s->numFrames > 0 && s->frames[s->numFrames - 1].type != START_BRACKET &&
+         s->frames[s->numFrames - 1].bindingPower >= bindingPower) {
+    applyFrame(s);
+  }
+
+  switch (type) {
+    case ADD:
+    case MINUS:
+    case MULTIPLY:
+    case DIVIDE:
+    case MODULO:
+      pushFrame(s, type, true, bindingPower, offset);
+      break;
+    case POWER: // Exponents are right-associative, so the right operand is parsed at 30 - 1
+      pushFrame(s, type, true, bindingPower - 1, offset);
+      break;
+    case FACTORIAL:
+      if (s->operand < 0) {
+        fail(s, CALC_DOMAIN_ERROR, offset, "Factorial is only defined for non-negative numbers.");
+        return;
+      }
+      s->operand = factorial(s->operand);
+      s->operandType = FACTORIAL;
+      break;
+    case END_BRACKET: // The frame on top (if any) is the matching '('
+      if (s->numFrames == 0) {
+        fail(s, CALC_SYNTAX_ERROR, offset, "Unmatched parentheses.");
+        return;
+      }
+      s->numFrames--;
+      s->operandType = END_BRACKET;
+      break;
+    case END_OF_EXPRESSION:
+      if (s->numFrames > 0) {
+        fail(s, CALC_SYNTAX_ERROR, s->frames[s->numFrames - 1].offset, "Unmatched parentheses.");
+      }
+      break;
+    default:
+      fail(s, CALC_SYNTAX_ERROR, offset, "Unable to parse expression.");
+      break;
+  }
+}
+
+// Inserts the implicit '*' tokenize() inserts before a token of the given type (e.g., '2pi', '(1)(2)')
+static void insertMultiply(StreamState *s, Symbol type, long long offset) {
+  Symbol previous = s->previous;
+  bool multiply;
+  switch (type) {
+    case NUMBER:
+      multiply = previous == END_BRACKET || previous == FACTORIAL || previous == IDENTIFIER;
+      break;
+    case IDENTIFIER:
+    case START_BRACKET:
+      multiply = previous == END_BRACKET || previous == FACTORIAL || previous == NUMBER || previous == IDENTIFIER;
+      break;
+    default:
+      multiply = false;
+      break;
+  }
+  if (multiply) {
+    processToken(s, MULTIPLY, 0, offset);
+  }
+}
+
+// Appends characters to the text of the token being read
+static void appendText(StreamState *s, const char *str, int length) {
+  if (s->textLength + length > s->textCapacity) {
+    int capacity = s->textCapacity == 0 ? 64 : s->textCapacity;
+    while (capacity < s->textLength + length) {
+      capacity *= 2;
+    }
+    char *text = realloc(s->text, capacity);
+    if (text == NULL) {
+      fail(s, CALC_MEMORY_ERROR, s->tokenStart, "Number is too long (out of memory).");
+      return;
+    }
+    s->text = text;
+    s->textCapacity = capacity;
+  }
+  memcpy(s->text + s->textLength, str, length);
+  s->textLength += length;
+}
+
+// Appends letters to the identifier being read (in lowercase)
+static void appendLetters(StreamState *s, const char *str, int length) {
+  for (int i = 0; i < length; i++) {
+    if (s->textLength < MAX_IDENTIFIER_LENGTH) {
+      s->text[s->textLength] = (char) (str[i] | 0x20); // c | 0x20 is lowercase for letters
+    }
+    s->textLength++;
+  }
+}
+
+static void finishNumber(StreamState *s) {
+  s->pending = PENDING_NONE;
+  processToken(s, NUMBER, parseNumber(s->text, s->textLength), s->tokenStart);
+  s->previous = NUMBER;
+}
+
+static void finishIdentifier(StreamState *s) {
+  s->pending = PENDING_NONE;
+  const Identifier *identifier = s->textLength <= MAX_IDENTIFIER_LENGTH ? lookupIdentifier(s->text, s->textLength) : NULL;
+  if (identifier == NULL) {
+    int length = s->textLength <= MAX_IDENTIFIER_LENGTH ? s->textLength : MAX_IDENTIFIER_LENGTH;
+    fail(s, CALC_SYNTAX_ERROR, s->tokenStart, "Unexpected identifier '%.*s%s'.", length, s->text,
+         s->textLength > MAX_IDENTIFIER_LENGTH ? "..." : "");
+    return;
+  }
+  processToken(s, identifier->type, 0, s->tokenStart);
+  if (identifier->isFunction) {
+    s->omitMultiply = true;
+  }
+  s->previous = IDENTIFIER;
+}
+
+// Tokenizes and evaluates a chunk of the expression
+// base is the index of the first character of the chunk in the whole expression.
+static void processChunk(StreamState *s, const char *chunk, int length, long long base, CharClasses classes) {
+  classifyCharacters(chunk, length, classes);
+
+  int current = 0;
+  while (current < length && !s->result->hadError) {
+    char c = chunk[current];
+
+    // Continue the number/identifier left over from the previous character (or chunk)
+    if (s->pending == PENDING_NUMBER) {
+      if (inClass(classes.digits, current)) {
+        int end = skipClass(classes.digits, current, length);
+        appendText(s, chunk + current, end - current);
+        current = end;
+        continue;
+      } else if (c == '.' && !s->seenDecimalPoint) {
+        appendText(s, ".", 1);
+        s->seenDecimalPoint = true;
+        current++;
+        continue;
+      }
+      finishNumber(s);
+    } else if (s->pending == PENDING_IDENTIFIER) {
+      if (inClass(classes.letters, current)) {
+        int end = skipClass(classes.letters, current, length);
+        appendLetters(s, chunk + current, end - current);
+        current = end;
+        continue;
+      }
+      finishIdentifier(s);
+    }
+    if (s->result->hadError) {
+      break;
+    }
+
+    long long offset = base + current;
+    if (inClass(classes.digits, current)) { // Start a number
+      insertMultiply(s, NUMBER, offset);
+      s->pending = PENDING_NUMBER;
+      s->tokenStart = offset;
+      s->textLength = 0;
+      s->seenDecimalPoint = false;
+      continue;
+    } else if (inClass(classes.letters, current)) { // Start an identifier
+      insertMultiply(s, IDENTIFIER, offset);
+      s->pending = PENDING_IDENTIFIER;
+      s->tokenStart = offset;
+      s->textLength = 0;
+      continue;
+    } else if (inClass(classes.spaces, current)) { // Skip the whole run of whitespace
+      current = skipClass(classes.spaces, current, length);
+      continue;
+    }
+
+    switch (c) {
+      case '\n': // line breaks are ignored
+      case '\r':
+        break;
+      case '(':
+        insertMultiply(s, START_BRACKET, offset);
+        processToken(s, START_BRACKET, 0, offset);
+        s->previous = START_BRACKET;
+        break;
+      case ')':
+        processToken(s, END_BRACKET, 0, offset);
+        s->previous = END_BRACKET;
+        break;
+      case '+':
+      case '-':
+      case '*':
+      case '/':
+      case '%':
+      case '^':
+      case '!': {
+        Symbol type = c == '+' ? ADD : c == '-' ? MINUS : c == '*' ? MULTIPLY : c == '/' ? DIVIDE :
+                      c == '%' ? MODULO : c == '^' ? POWER : FACTORIAL;
+        processToken(s, type, 0, offset);
+        s->previous = type;
+        break;
+      }
+      case '.':
+        fail(s, CALC_SYNTAX_ERROR, offset, "Unexpected '.', please have digits before '.' (e.g., 0.1 instead of .1).");
+        break;
+      default:
+        fail(s, CALC_SYNTAX_ERROR, offset, "Unknown character: '%c'.", c);
+        break;
+    }
+    current++;
+  }
+}
+
+bool streamEvaluate(int fd, StreamResult *result) {
+  memset(result, 0, sizeof(*result));
+  result->offset = -1;
+
+  StreamState s;
+  memset(&s, 0, sizeof(s));
+  s.result = result;
+  s.expectOperand = true;
+  s.randomState = RANDOM_SEED;
+  s.previous = END_OF_EXPRESSION;
+  s.text = malloc(MAX_IDENTIFIER_LENGTH);
+  s.textCapacity = MAX_IDENTIFIER_LENGTH;
+
+  // The chunk and its class masks are allocated once and reused for every chunk
+  char *chunk = malloc(CHUNK_SIZE);
+  uint64_t *masks = malloc(4 * MASK_WORDS(CHUNK_SIZE) * sizeof(uint64_t));
+  CharClasses classes = {masks, masks + MASK_WORDS(CHUNK_SIZE), masks + 2 * MASK_WORDS(CHUNK_SIZE),
+                         masks + 3 * MASK_WORDS(CHUNK_SIZE)};
+  if (s.text == NULL || chunk == NULL || masks == NULL) {
+    fail(&s, CALC_MEMORY_ERROR, -1, "Out of memory.");
+  }
+
+  long long base = 0;
+  while (!result->hadError) {
+    long count = (long) read(fd, chunk, CHUNK_SIZE);
+    if (count < 0 && errno == EINTR) { // Interrupted before anything was read, try again
+      continue;
+    } else if (count < 0) {
+      fail(&s, CALC_INPUT_ERROR, base, "Unable to read the expression.");
+    } else if (count == 0) { // End of the file
+      break;
+    }
+    processChunk(&s, chunk, (int) count, base, classes);
+    base += count;
+  }
+  result->length = base;
+
+  // Finish the last token and the expression
+  if (s.pending == PENDING_NUMBER) {
+    finishNumber(&s);
+  } else if (s.pending == PENDING_IDENTIFIER) {
+    finishIdentifier(&s);
+  }
+  if (!result->hadError && s.numTokens == 0) {
+    fail(&s, CALC_SYNTAX_ERROR, -1, "The expression is empty.");
+  }
+  processToken(&s, END_OF_EXPRESSION, 0, base);
+  result->value = s.operand;
+
+  free(s.frames);
+  free(s.text);
+  free(chunk);
+  free(masks);
+  return !result->hadError;
+}
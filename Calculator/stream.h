@@ -0,0 +1,31 @@
+// Justin Chen
+// Streaming evaluation of expressions of any length
+
+#ifndef CALCULATOR_STREAM_H
+#define CALCULATOR_STREAM_H
+
+#include <stdbool.h>  // Define booleans (bool, true, false)
+#include "calc.h"     // Kinds of errors (CalcErrorType)
+
+// Define struct StreamResult
+// Holds the outcome of evaluating an expression with streamEvaluate().
+// If there was an error, message describes it and offset is the index of the character
+// where it was found (or -1 if it isn't about a particular character).
+typedef struct StreamResult {
+    double value;         // Result of the expression (only meaningful if hadError is false)
+    bool hadError;        // Whether the expression couldn't be evaluated
+    CalcErrorType errorType; // Kind of error
+    char message[128];    // Error message
+    long long offset;     // Index of the character where the error occurred
+    long long length;     // Number of characters read
+    int maxDepth;         // Largest number of operators waiting for their right operand at once
+} StreamResult;
+
+// Reads an expression from a file descriptor until the end of the file and evaluates it.
+// The input is read in fixed-size chunks and evaluated as it is tokenized, so only operators
+// that are still waiting for an operand are kept. Memory use is proportional to the deepest
+// nesting of the expression (and the length of the longest number), not the length of the input.
+// Newlines are treated as whitespace. Returns false if there was an error.
+bool streamEvaluate(int fd, StreamResult *result);
+
+#endif // CALCULATOR_STREAM_H
@@ -0,0 +1,53 @@
+// Justin Chen
+// Token types of the calculator
+
+#ifndef CALCULATOR_SYMBOL_H
+#define CALCULATOR_SYMBOL_H
+
+// Define enumeration containing labels for various different token types
+typedef enum Symbol {
+    NUMBER,                     // Numerical values (RegExp [0-9.])
+    ADD, MINUS,                 // Addition [+] and subtraction [-]
+    DIVIDE, MULTIPLY,           // Division [/] and multiplication [*]
+    MODULO,                     // Modulo (%)
+    POWER, FACTORIAL,           // Exponentiation [^] and factorials [!]
+    MATH_PI, MATH_E,            // π and e
+    EXP,                        // e^x
+    RAND_NUM,                   // obtain random number
+    SQRT,                       // performs square root ('sqrt')
+    CBRT,                       // performs cube root ('cbrt')
+    LOG,                        // performs logarithm ('log')
+    LN,                         // performs natural logarithm ('ln')
+    SIN, COS, TAN,              // performs trigonometric functions ('sin', 'cos', 'tan') IN DEGREES
+    ASIN, ACOS, ATAN,           // performs inverse trigonometric functions ('asin', 'acos', 'atan')
+    SINH, COSH, TANH,           // performs hyperbolic trigonometric functions ('sinh', 'cosh', 'tanh')
+    ASINH, ACOSH, ATANH,        // performs inverse hyperbolic trigonometric functions ('asinh', 'acosh', 'atanh')
+    ABS,                        // performs absolute value ('abs')
+    DEGTORAD, RADTODEG,         // performs conversion between degrees and radians ('degtorad', 'radtodeg')
+    FLOOR, CEIL, ROUND,         // performs floor, ceil and round functions ('floor', 'ceil', 'round')
+    INV,                        // performs 1/x ('inv')
+    NEGATE,                     // Negation [-] (only in syntax trees, the tokenizer emits MINUS for both)
+    STORE_SHARED, LOAD_SHARED,  // Saving and reusing the value of a repeated subexpression (only in syntax trees)
+    INTEGER_POWER, ROOT_POWER,  // Powers with a constant integer exponent, and square and cube roots (only in syntax trees)
+    OPERAND_PAIR,               // Two operands of a fused multiply-add or terms of a sum (only in syntax trees)
+    FUSED_MULTIPLY_ADD, FUSED_MULTIPLY_SUBTRACT, // x * y + z and x * y - z rounded once (only in syntax trees)
+    FUSED_ADD_MULTIPLY, FUSED_SUBTRACT_MULTIPLY, // x + y * z and x - y * z rounded once (only in syntax trees)
+    HYPOT, LOG1P, EXPM1,        // sqrt(x^2 + y^2), ln(1 + x) and e^x - 1 rounded once (only in syntax trees)
+    SUM, COMPENSATED_SUM, PRODUCT, // Sums and products of any number of terms (only in syntax trees)
+    PASS_TOKEN,                 // Ignore this token space
+    START_BRACKET, END_BRACKET, // Parentheses [(], [)]
+    IDENTIFIER,                 // Function/constant names
+    END_OF_EXPRESSION           // End of user expression
+} Symbol;
+
+// Binding power of each token type when it follows an operand (0 if it doesn't continue one).
+// The larger the binding power, the higher the precedence the operator has.
+// Note that binding power is only assigned to operator tokens.
+static const unsigned char bindingPowers[END_OF_EXPRESSION + 1] = {
+    [ADD] = 10, [MINUS] = 10,
+    [MULTIPLY] = 20, [DIVIDE] = 20, [MODULO] = 20,
+    [POWER] = 30,
+    [FACTORIAL] = 40,
+};
+
+#endif // CALCULATOR_SYMBOL_H